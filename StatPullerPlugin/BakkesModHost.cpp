@@ -0,0 +1,358 @@
+#include "pch.h"
+#include "BakkesModHost.h"
+#include "HookNames.h"
+#include "SampleRing.h"
+
+#include "bakkesmod/wrappers/MMRWrapper.h"
+
+#include <windows.h>
+#include <shellapi.h>
+#include <thread>
+
+BakkesModHost::BakkesModHost(std::shared_ptr<GameWrapper> gameWrapper,
+	std::shared_ptr<CVarManagerWrapper> cvarManager,
+	std::string scriptDirectory)
+	: gameWrapper(std::move(gameWrapper)),
+	cvarManager(std::move(cvarManager)),
+	scriptDirectory(std::move(scriptDirectory))
+{
+	postProcess = std::make_unique<PostProcessHost>(this->scriptDirectory, [this](std::string msg) {
+		LogAsync(msg);
+	});
+	postProcess->Start();
+}
+
+BakkesModHost::~BakkesModHost()
+{
+	postProcess->Stop();
+}
+
+void BakkesModHost::HookEvent(const std::string& eventName, Callback callback)
+{
+	// the rest have some other caller (LeaveMatch is on the GFxShell), and
+	// wrapping that as a server would hand out garbage
+	if (eventName.rfind(HOOK_SERVER_PREFIX, 0) != 0)
+	{
+		gameWrapper->HookEvent(eventName, [callback = std::move(callback)](std::string) {
+			callback();
+		});
+		return;
+	}
+
+	gameWrapper->HookEventWithCaller<ServerWrapper>(eventName,
+		[this, callback = std::move(callback)](ServerWrapper caller, void*, std::string) {
+			currentServer = caller;
+			callback();
+			currentServer = ServerWrapper(0);
+		});
+}
+
+void BakkesModHost::HookStatTicker(const std::string& eventName, StatTickerCallback callback)
+{
+	gameWrapper->HookEventWithCallerPost<ServerWrapper>(eventName,
+		[callback = std::move(callback)](ServerWrapper, void* params, std::string) {
+			StatTickerParams* pStruct = (StatTickerParams*)params;
+
+			StatTickerEvent event;
+			event.statEvent = pStruct->StatEvent;
+			event.receiver = ToPlayerRef(pStruct->Receiver);
+			event.victim = ToPlayerRef(pStruct->Victim);
+			callback(event);
+		});
+}
+
+PlayerRef BakkesModHost::ToPlayerRef(uintptr_t priAddress)
+{
+	PlayerRef player;
+
+	PriWrapper pri = PriWrapper(priAddress);
+	if (!pri || pri.IsNull()) return player;
+
+	player.key = pri.memory_address;
+	player.team = pri.GetTeamNum();
+	player.isLocal = pri.IsLocalPlayerPRI();
+	return player;
+}
+
+void BakkesModHost::SetTimeout(Callback callback, float delaySeconds)
+{
+	gameWrapper->SetTimeout([callback](GameWrapper*) {
+		callback();
+	}, delaySeconds);
+}
+
+IGameHost::TimePoint BakkesModHost::ClockNow()
+{
+	return std::chrono::steady_clock::now();
+}
+
+int64_t BakkesModHost::WallClockMs()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool BakkesModHost::IsInOnlineGame()
+{
+	return gameWrapper->IsInOnlineGame();
+}
+
+bool BakkesModHost::IsInReplay()
+{
+	return gameWrapper->IsInReplay();
+}
+
+OnlineGameInfo BakkesModHost::GetOnlineGame()
+{
+	OnlineGameInfo info;
+
+	ServerWrapper game = gameWrapper->GetOnlineGame();
+	if (game.IsNull()) return info;
+
+	info.isValid = true;
+	info.playlistId = game.GetPlaylist().GetPlaylistId();
+	return info;
+}
+
+MatchClockState BakkesModHost::GetClockState()
+{
+	MatchClockState state;
+
+	ServerWrapper server = GetServer();
+	if (server.IsNull()) return state;
+
+	state.isValid = true;
+	state.secondsRemaining = server.GetSecondsRemaining();
+	state.isOvertime = server.GetbOverTime() != 0;
+	state.gameLength = server.GetGameTime();
+	return state;
+}
+
+size_t BakkesModHost::CapturePlayerStats(PlayerStatRow* rows, size_t capacity)
+{
+	ServerWrapper server = GetServer();
+	if (server.IsNull()) return 0;
+
+	ArrayWrapper<PriWrapper> pris = server.GetPRIs();
+	const int priCount = pris.Count();
+
+	size_t count = 0;
+	for (int i = 0; i < priCount && count < capacity; i++)
+	{
+		PriWrapper pri = pris.Get(i);
+		if (pri.IsNull()) continue;
+
+		// spectators and players who haven't picked a team
+		const uint8_t team = pri.GetTeamNum();
+		if (team > 1) continue;
+
+		PlayerStatRow& row = rows[count++];
+		row = PlayerStatRow();
+		row.key = pri.memory_address;
+		row.team = team;
+		row.isLocal = pri.IsLocalPlayerPRI();
+		row.isMvp = pri.GetbMatchMVP() != 0;
+		row.score = pri.GetMatchScore();
+		row.goals = pri.GetMatchGoals();
+		row.ownGoals = pri.GetMatchOwnGoals();
+		row.assists = pri.GetMatchAssists();
+		row.saves = pri.GetMatchSaves();
+		row.shots = pri.GetMatchShots();
+		row.demolishes = pri.GetMatchDemolishes();
+		row.ballTouches = pri.GetBallTouches();
+		row.carTouches = pri.GetCarTouches();
+		row.boostPickups = pri.GetBoostPickups();
+	}
+	return count;
+}
+
+bool BakkesModHost::CaptureSample(uint32_t fields, SampleFrame& frame)
+{
+	ServerWrapper server = GetServer();
+	if (server.IsNull()) return false;
+
+	ArrayWrapper<PriWrapper> pris = server.GetPRIs();
+	const int priCount = pris.Count();
+
+	frame.playerCount = 0;
+	for (int i = 0; i < priCount && frame.playerCount < MAX_STAT_PLAYERS; i++)
+	{
+		PriWrapper pri = pris.Get(i);
+		if (pri.IsNull() || pri.GetTeamNum() > 1) continue;
+
+		const size_t p = frame.playerCount++;
+		frame.keys[p] = pri.memory_address;
+		frame.scores[p] = (fields & SampleScore) ? pri.GetMatchScore() : 0;
+		frame.boost[p] = 0;
+		frame.cars[p] = SamplePosition();
+
+		// no car while demolished or before kickoff
+		CarWrapper car = pri.GetCar();
+		if (car.IsNull()) continue;
+
+		if (fields & SampleBoost)
+		{
+			BoostWrapper boost = car.GetBoostComponent();
+			if (!boost.IsNull()) {
+				frame.boost[p] = static_cast<uint8_t>(boost.GetCurrentBoostAmount() * 100.0f + 0.5f);
+			}
+		}
+		if (fields & SampleCarPosition)
+		{
+			const Vector location = car.GetLocation();
+			frame.cars[p] = { location.X, location.Y, location.Z };
+		}
+	}
+
+	if (fields & (SampleBallPosition | SamplePossession))
+	{
+		BallWrapper ball = server.GetBall();
+		if (!ball.IsNull())
+		{
+			const Vector location = ball.GetLocation();
+			frame.ball = { location.X, location.Y, location.Z };
+
+			const unsigned char hitTeam = ball.GetHitTeamNum();
+			frame.possession = hitTeam <= 1 ? static_cast<int8_t>(hitTeam) : -1;
+		}
+	}
+	return true;
+}
+
+ServerWrapper BakkesModHost::GetServer()
+{
+	return currentServer.IsNull() ? gameWrapper->GetOnlineGame() : currentServer;
+}
+
+float BakkesModHost::GetPlayerMMR(int playlistId)
+{
+	return gameWrapper->GetMMRWrapper().GetPlayerMMR(gameWrapper->GetUniqueID(), playlistId);
+}
+
+bool BakkesModHost::IsMMRSynced(int playlistId)
+{
+	return gameWrapper->GetMMRWrapper().IsSynced(gameWrapper->GetUniqueID(), playlistId);
+}
+
+void BakkesModHost::OnMMRChanged(Callback callback)
+{
+	// fires for everyone whose MMR syncs, the tracker only wants ours
+	mmrNotifier = gameWrapper->GetMMRWrapper().RegisterMMRNotifier([this, callback = std::move(callback)](UniqueIDWrapper id) {
+		if (id.GetIdString() == gameWrapper->GetUniqueID().GetIdString()) {
+			callback();
+		}
+	});
+}
+
+std::string BakkesModHost::GetPlayerName(uintptr_t player)
+{
+	return PriWrapper(player).GetPlayerName().ToString();
+}
+
+std::string BakkesModHost::GetStatEventName(uintptr_t statEvent)
+{
+	return StatEventWrapper(statEvent).GetEventName();
+}
+
+bool BakkesModHost::StopReplayRecording()
+{
+	ReplaySoccarWrapper soccarReplay = GetReplay();
+	if (soccarReplay.memory_address == NULL) return false;
+
+	soccarReplay.StopRecord();
+	return true;
+}
+
+IGameHost::ReplayHandle BakkesModHost::TakeReplay()
+{
+	ReplaySoccarWrapper soccarReplay = GetReplay();
+	if (soccarReplay.memory_address == NULL) return nullptr;
+
+	soccarReplay.StopRecord();
+	return std::make_shared<ReplaySoccarWrapper>(soccarReplay);
+}
+
+bool BakkesModHost::WriteReplay(const ReplayHandle& replay, const std::string& path)
+{
+	if (!replay) return false;
+
+	static_cast<ReplaySoccarWrapper*>(replay.get())->ExportReplay(path);
+	return true;
+}
+
+ReplaySoccarWrapper BakkesModHost::GetReplay()
+{
+	ServerWrapper server = GetServer();
+	if (server.IsNull()) {
+		Log("TrySaveReplay: Server is null, skipping replay save.");
+		return ReplaySoccarWrapper(0);
+	}
+
+	ReplayDirectorWrapper replayDirector = server.GetReplayDirector();
+	if (replayDirector.IsNull()) {
+		Log("TrySaveReplay: ReplayDirector is null.");
+		return ReplaySoccarWrapper(0);
+	}
+
+	ReplaySoccarWrapper soccarReplay = replayDirector.GetReplay();
+	if (soccarReplay.memory_address == NULL) {
+		Log("TrySaveReplay: Replay object is null.");
+	}
+	return soccarReplay;
+}
+
+// quotes one command line argument the way CommandLineToArgvW splits it
+static std::string QuoteArgument(const std::string& argument)
+{
+	std::string quoted = "\"";
+	size_t backslashes = 0;
+
+	for (char c : argument)
+	{
+		if (c == '\\') {
+			backslashes++;
+			continue;
+		}
+
+		quoted.append(c == '"' ? backslashes * 2 + 1 : backslashes, '\\');
+		quoted.push_back(c);
+		backslashes = 0;
+	}
+
+	quoted.append(backslashes * 2, '\\');
+	quoted.push_back('"');
+	return quoted;
+}
+
+void BakkesModHost::RunScript(const std::string& scriptFileName, const json& args) {
+	if (postProcess->Send(scriptFileName, args)) return;
+
+	// worker unavailable, fall back to a one-off interpreter
+	std::string scriptPath = "\"" + scriptDirectory + scriptFileName + "\"";
+	std::string commandLine = scriptPath + " " + QuoteArgument(args.dump());
+	std::wstring wScriptPath(commandLine.begin(), commandLine.end());
+	LogAsync("Calling Python script: " + scriptPath);
+
+	std::thread([wScriptPath] {
+
+		ShellExecute(
+			nullptr,
+			L"open",
+			L"pythonw.exe",
+			wScriptPath.c_str(),
+			nullptr,
+			SW_HIDE
+		);
+		}).detach();
+}
+
+void BakkesModHost::Log(const std::string& msg) {
+	cvarManager->log(msg);
+}
+
+// safe to call from any thread, the message is logged on the game thread
+void BakkesModHost::LogAsync(const std::string& msg) {
+	gameWrapper->Execute([cvar = cvarManager, msg](GameWrapper*) {
+		cvar->log(msg);
+	});
+}
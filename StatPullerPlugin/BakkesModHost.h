@@ -0,0 +1,78 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "bakkesmod/plugin/bakkesmodplugin.h"
+#include "bakkesmod/wrappers/GameObject/Stats/StatEventWrapper.h"
+
+#include "GameHost.h"
+#include "PostProcessHost.h"
+
+struct StatTickerParams {
+    uintptr_t Receiver;
+    uintptr_t Victim;
+    uintptr_t StatEvent;
+};
+
+struct StatEventParams {
+    uintptr_t PRI;
+    uintptr_t StatEvent;
+};
+
+// IGameHost on top of the BakkesMod SDK.
+class BakkesModHost : public IGameHost
+{
+public:
+    BakkesModHost(std::shared_ptr<GameWrapper> gameWrapper,
+        std::shared_ptr<CVarManagerWrapper> cvarManager,
+        std::string scriptDirectory);
+    ~BakkesModHost() override;
+
+    void HookEvent(const std::string& eventName, Callback callback) override;
+    void HookStatTicker(const std::string& eventName, StatTickerCallback callback) override;
+
+    void SetTimeout(Callback callback, float delaySeconds) override;
+    TimePoint ClockNow() override;
+    int64_t WallClockMs() override;
+
+    bool IsInOnlineGame() override;
+    bool IsInReplay() override;
+    OnlineGameInfo GetOnlineGame() override;
+    MatchClockState GetClockState() override;
+    size_t CapturePlayerStats(PlayerStatRow* rows, size_t capacity) override;
+    bool CaptureSample(uint32_t fields, SampleFrame& frame) override;
+
+    float GetPlayerMMR(int playlistId) override;
+    bool IsMMRSynced(int playlistId) override;
+    void OnMMRChanged(Callback callback) override;
+
+    std::string GetPlayerName(uintptr_t player) override;
+    std::string GetStatEventName(uintptr_t statEvent) override;
+
+    bool StopReplayRecording() override;
+    ReplayHandle TakeReplay() override;
+    bool WriteReplay(const ReplayHandle& replay, const std::string& path) override;
+
+    void RunScript(const std::string& scriptFileName, const json& args = json::object()) override;
+
+    void Log(const std::string& msg) override;
+    void LogAsync(const std::string& msg) override;
+
+private:
+    static PlayerRef ToPlayerRef(uintptr_t priAddress);
+    ServerWrapper GetServer();
+    ReplaySoccarWrapper GetReplay();
+
+    std::shared_ptr<GameWrapper> gameWrapper;
+    std::shared_ptr<CVarManagerWrapper> cvarManager;
+    const std::string scriptDirectory;
+
+    std::unique_ptr<PostProcessHost> postProcess;
+
+    // the notifier is unregistered when the token is destroyed
+    std::unique_ptr<MMRNotifierToken> mmrNotifier;
+
+    // caller of the hook being dispatched, used for the replay export
+    ServerWrapper currentServer = ServerWrapper(0);
+};
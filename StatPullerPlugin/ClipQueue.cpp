@@ -0,0 +1,66 @@
+#include "pch.h"
+#include "ClipQueue.h"
+
+#include <algorithm>
+
+using Seconds = std::chrono::duration<float>;
+
+void ClipQueue::SetWindow(float seconds)
+{
+	window = std::max(0.0f, seconds);
+}
+
+void ClipQueue::Add(ClipGoal goal, TimePoint now)
+{
+	if (goals.empty()) {
+		batchStart = now;
+	}
+
+	goal.scoredAt = now;
+	goals.push_back(std::move(goal));
+}
+
+void ClipQueue::CloseBatch()
+{
+	if (!goals.empty()) isClosed = true;
+}
+
+ClipQueue::TimePoint ClipQueue::DueAt() const
+{
+	const TimePoint windowEnd = batchStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(Seconds(window));
+	const TimePoint footageEnd = goals.back().scoredAt + std::chrono::duration_cast<std::chrono::steady_clock::duration>(Seconds(CLIP_DELAY));
+	return isClosed ? footageEnd : std::max(windowEnd, footageEnd);
+}
+
+bool ClipQueue::IsDue(TimePoint now) const
+{
+	return !goals.empty() && now >= DueAt();
+}
+
+float ClipQueue::SecondsUntilDue(TimePoint now) const
+{
+	if (goals.empty()) return 0.0f;
+	return std::max(0.0f, std::chrono::duration_cast<Seconds>(DueAt() - now).count());
+}
+
+json ClipQueue::TakeRequest(TimePoint now)
+{
+	json clips = json::array();
+	for (const ClipGoal& goal : goals)
+	{
+		clips.push_back({
+			{ "ScorerName", goal.scorerName },
+			{ "GoalTimeSeconds", goal.clockSeconds },
+			{ "IsOvertime", goal.isOvertime },
+			{ "MatchTimeMs", goal.matchTimeMs },
+			{ "WallClockMs", goal.wallClockMs },
+			{ "AgeSeconds", std::chrono::duration_cast<Seconds>(now - goal.scoredAt).count() },
+		});
+	}
+	goals.clear();
+	isClosed = false;
+
+	json request;
+	request["Goals"] = std::move(clips);
+	return request;
+}
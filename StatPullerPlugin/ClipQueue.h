@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "json.hpp"
+using json = nlohmann::json;
+
+// seconds of footage after a goal before it can be clipped
+#define CLIP_DELAY 2.0f
+#define DEFAULT_CLIP_WINDOW 10.0f
+
+struct ClipGoal {
+    std::string scorerName;
+    int16_t clockSeconds = 0;
+    bool isOvertime = false;
+    uint32_t matchTimeMs = 0;
+    int64_t wallClockMs = 0;
+    std::chrono::steady_clock::time_point scoredAt;
+};
+
+// Local goals waiting for clip.py. Goals that come in while a batch is open
+// join it, so a burst of goals is one script run that cuts every segment in
+// a single pass. A batch is due once it has been open for the window and
+// its last goal is at least CLIP_DELAY old.
+class ClipQueue
+{
+public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    // 0 clips each goal on its own, as soon as CLIP_DELAY has passed
+    void SetWindow(float seconds);
+    float Window() const { return window; }
+
+    void Add(ClipGoal goal, TimePoint now);
+
+    // No more goals are coming, the match ended. The batch is due as soon
+    // as its last goal is CLIP_DELAY old, without waiting out the window.
+    void CloseBatch();
+
+    bool IsEmpty() const { return goals.empty(); }
+    bool IsDue(TimePoint now) const;
+
+    // seconds from now until the batch is due, 0 if it already is
+    float SecondsUntilDue(TimePoint now) const;
+
+    // Arguments for clip.py with every queued goal, then empties the queue.
+    // AgeSeconds is how long before now each goal was scored.
+    json TakeRequest(TimePoint now);
+
+private:
+    TimePoint DueAt() const;
+
+    std::vector<ClipGoal> goals;
+    TimePoint batchStart;
+    bool isClosed = false;
+    float window = DEFAULT_CLIP_WINDOW;
+};
@@ -0,0 +1,177 @@
+#include "pch.h"
+#include "EventPoller.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define POLLER_MAX_EVENTS 256
+
+bool InitSockets()
+{
+#ifdef _WIN32
+	// reference counted by winsock, one per caller is fine
+	WSADATA data;
+	return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+	return true;
+#endif
+}
+
+bool SetNonBlocking(SocketHandle socket)
+{
+#ifdef _WIN32
+	u_long isNonBlocking = 1;
+	return ioctlsocket(socket, FIONBIO, &isNonBlocking) == 0;
+#else
+	const int flags = fcntl(socket, F_GETFL, 0);
+	return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+void CloseSocket(SocketHandle socket)
+{
+#ifdef _WIN32
+	closesocket(socket);
+#else
+	close(socket);
+#endif
+}
+
+bool IsWouldBlock()
+{
+#ifdef _WIN32
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+	return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+#ifdef _WIN32
+
+EventPoller::EventPoller() = default;
+EventPoller::~EventPoller() = default;
+
+bool EventPoller::IsValid() const
+{
+	return true;
+}
+
+bool EventPoller::Add(SocketHandle socket, bool wantWrite)
+{
+	WSAPOLLFD entry{};
+	entry.fd = socket;
+	entry.events = POLLRDNORM | (wantWrite ? POLLWRNORM : 0);
+	sockets.push_back(entry);
+	return true;
+}
+
+bool EventPoller::Modify(SocketHandle socket, bool wantWrite)
+{
+	for (WSAPOLLFD& entry : sockets)
+	{
+		if (entry.fd == socket) {
+			entry.events = POLLRDNORM | (wantWrite ? POLLWRNORM : 0);
+			return true;
+		}
+	}
+	return false;
+}
+
+void EventPoller::Remove(SocketHandle socket)
+{
+	sockets.erase(std::remove_if(sockets.begin(), sockets.end(), [socket](const WSAPOLLFD& entry) {
+		return entry.fd == socket;
+	}), sockets.end());
+}
+
+bool EventPoller::Wait(std::vector<PollEvent>& events, int timeoutMs)
+{
+	events.clear();
+	if (sockets.empty())
+	{
+		Sleep(timeoutMs < 0 ? 0 : timeoutMs);
+		return true;
+	}
+
+	const int count = WSAPoll(sockets.data(), static_cast<ULONG>(sockets.size()), timeoutMs);
+	if (count < 0) return false;
+
+	for (const WSAPOLLFD& entry : sockets)
+	{
+		if (!entry.revents) continue;
+
+		PollEvent event;
+		event.socket = entry.fd;
+		event.isReadable = (entry.revents & POLLRDNORM) != 0;
+		event.isWritable = (entry.revents & POLLWRNORM) != 0;
+		event.isClosed = (entry.revents & (POLLHUP | POLLERR | POLLNVAL)) != 0;
+		events.push_back(event);
+	}
+	return true;
+}
+
+#else
+
+EventPoller::EventPoller()
+	: epollFd(epoll_create1(EPOLL_CLOEXEC)), ready(POLLER_MAX_EVENTS)
+{
+}
+
+EventPoller::~EventPoller()
+{
+	if (epollFd >= 0) close(epollFd);
+}
+
+bool EventPoller::IsValid() const
+{
+	return epollFd >= 0;
+}
+
+bool EventPoller::Add(SocketHandle socket, bool wantWrite)
+{
+	epoll_event event{};
+	event.events = EPOLLIN | EPOLLRDHUP | (wantWrite ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+	event.data.fd = socket;
+	return epoll_ctl(epollFd, EPOLL_CTL_ADD, socket, &event) == 0;
+}
+
+bool EventPoller::Modify(SocketHandle socket, bool wantWrite)
+{
+	epoll_event event{};
+	event.events = EPOLLIN | EPOLLRDHUP | (wantWrite ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+	event.data.fd = socket;
+	return epoll_ctl(epollFd, EPOLL_CTL_MOD, socket, &event) == 0;
+}
+
+void EventPoller::Remove(SocketHandle socket)
+{
+	epoll_ctl(epollFd, EPOLL_CTL_DEL, socket, nullptr);
+}
+
+bool EventPoller::Wait(std::vector<PollEvent>& events, int timeoutMs)
+{
+	events.clear();
+
+	const int count = epoll_wait(epollFd, ready.data(), static_cast<int>(ready.size()), timeoutMs);
+	if (count < 0) return errno == EINTR;
+
+	for (int i = 0; i < count; i++)
+	{
+		PollEvent event;
+		event.socket = ready[i].data.fd;
+		event.isReadable = (ready[i].events & EPOLLIN) != 0;
+		event.isWritable = (ready[i].events & EPOLLOUT) != 0;
+		event.isClosed = (ready[i].events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP)) != 0;
+		events.push_back(event);
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+using SocketHandle = SOCKET;
+#define INVALID_SOCKET_HANDLE INVALID_SOCKET
+#else
+#include <sys/epoll.h>
+using SocketHandle = int;
+#define INVALID_SOCKET_HANDLE (-1)
+#endif
+
+struct PollEvent {
+    SocketHandle socket;
+    bool isReadable;
+    bool isWritable;
+    bool isClosed;          // hang up or error, reading will say which
+};
+
+// Readiness notifications for non-blocking sockets: epoll on Linux,
+// WSAPoll on Windows. Owned by one thread.
+class EventPoller
+{
+public:
+    EventPoller();
+    ~EventPoller();
+
+    EventPoller(const EventPoller&) = delete;
+    EventPoller& operator=(const EventPoller&) = delete;
+
+    bool IsValid() const;
+
+    // always watches for readable, writable only when asked
+    bool Add(SocketHandle socket, bool wantWrite);
+    bool Modify(SocketHandle socket, bool wantWrite);
+    void Remove(SocketHandle socket);
+
+    // waits up to timeoutMs (-1 forever), events is overwritten; false on
+    // error
+    bool Wait(std::vector<PollEvent>& events, int timeoutMs);
+
+private:
+#ifdef _WIN32
+    std::vector<WSAPOLLFD> sockets;
+#else
+    int epollFd = -1;
+    std::vector<epoll_event> ready;
+#endif
+};
+
+// socket helpers shared by the server and its clients
+bool InitSockets();
+bool SetNonBlocking(SocketHandle socket);
+void CloseSocket(SocketHandle socket);
+// the last send/recv failed only because it would have blocked
+bool IsWouldBlock();
@@ -0,0 +1,62 @@
+#include "pch.h"
+#include "ExportFormat.h"
+
+struct ExportFormatInfo {
+	ExportFormat format;
+	const char* name;
+	const char* extension;
+};
+
+static const ExportFormatInfo EXPORT_FORMATS[EXPORT_FORMAT_COUNT] = {
+	{ ExportFormat::Json, "json", ".json" },
+	{ ExportFormat::JsonCompact, "json-compact", ".json" },
+	{ ExportFormat::Cbor, "cbor", ".cbor" },
+	{ ExportFormat::MessagePack, "msgpack", ".msgpack" },
+	{ ExportFormat::Bson, "bson", ".bson" },
+};
+
+bool ParseExportFormat(const std::string& name, ExportFormat& format)
+{
+	for (const ExportFormatInfo& info : EXPORT_FORMATS)
+	{
+		if (name == info.name) {
+			format = info.format;
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* ExportFormatName(ExportFormat format)
+{
+	return EXPORT_FORMATS[static_cast<size_t>(format)].name;
+}
+
+const char* ExportFormatExtension(ExportFormat format)
+{
+	return EXPORT_FORMATS[static_cast<size_t>(format)].extension;
+}
+
+std::vector<uint8_t> EncodeMatchDocument(const json& document, ExportFormat format)
+{
+	switch (format)
+	{
+	case ExportFormat::Cbor:
+		return json::to_cbor(document);
+	case ExportFormat::MessagePack:
+		return json::to_msgpack(document);
+	case ExportFormat::Bson:
+		return json::to_bson(document);
+	case ExportFormat::JsonCompact:
+	{
+		const std::string text = document.dump();
+		return std::vector<uint8_t>(text.begin(), text.end());
+	}
+	case ExportFormat::Json:
+	default:
+	{
+		const std::string text = document.dump(4);
+		return std::vector<uint8_t>(text.begin(), text.end());
+	}
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "json.hpp"
+using json = nlohmann::json;
+
+// Encodings for the last-match file, all produced by the vendored json.hpp.
+// Consumers tell them apart by the file extension.
+enum class ExportFormat : uint8_t {
+    Json,           // indented text, the original format
+    JsonCompact,
+    Cbor,
+    MessagePack,
+    Bson,
+};
+
+#define EXPORT_FORMAT_COUNT 5
+
+bool ParseExportFormat(const std::string& name, ExportFormat& format);
+const char* ExportFormatName(ExportFormat format);
+const char* ExportFormatExtension(ExportFormat format);
+
+std::vector<uint8_t> EncodeMatchDocument(const json& document, ExportFormat format);
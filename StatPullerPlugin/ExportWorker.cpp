@@ -0,0 +1,74 @@
+#include "pch.h"
+#include "ExportWorker.h"
+
+#include <exception>
+
+ExportWorker::ExportWorker(Logger& logger, size_t capacity)
+	: logger(logger), capacity(capacity)
+{
+}
+
+ExportWorker::~ExportWorker()
+{
+	Stop();
+}
+
+void ExportWorker::Start(Handler newHandler)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (isRunning) return;
+
+	handler = std::move(newHandler);
+	isRunning = true;
+	thread = std::thread(&ExportWorker::Run, this);
+}
+
+void ExportWorker::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!isRunning) return;
+		isRunning = false;
+	}
+	wake.notify_one();
+
+	if (thread.joinable()) {
+		thread.join();
+	}
+}
+
+bool ExportWorker::Submit(MatchSnapshot&& snapshot)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!isRunning || queue.size() >= capacity) return false;
+		queue.push_back(std::move(snapshot));
+	}
+	wake.notify_one();
+	return true;
+}
+
+void ExportWorker::Run()
+{
+	for (;;)
+	{
+		MatchSnapshot snapshot;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return !queue.empty() || !isRunning; });
+
+			// drain whatever is left before honoring a stop request
+			if (queue.empty()) return;
+
+			snapshot = std::move(queue.front());
+			queue.pop_front();
+		}
+
+		try {
+			handler(snapshot);
+		}
+		catch (const std::exception& e) {
+			SP_LOG_ERROR(logger, "Could not export match {}: {}", snapshot.matchId, e.what());
+		}
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "Logger.h"
+#include "MatchSnapshot.h"
+
+// Background thread that serializes and writes finished matches so the
+// game thread only pays for filling a MatchSnapshot and queueing it.
+// A handler that throws is logged and the worker moves on to the next
+// match, an exception must not escape the thread.
+class ExportWorker
+{
+public:
+    using Handler = std::function<void(MatchSnapshot&)>;
+
+    explicit ExportWorker(Logger& logger, size_t capacity = 8);
+    ~ExportWorker();
+
+    void Start(Handler handler);
+
+    // Finishes every queued match, then joins the thread.
+    void Stop();
+
+    // Returns false if the worker isn't running or the queue is full.
+    bool Submit(MatchSnapshot&& snapshot);
+
+private:
+    void Run();
+
+    Logger& logger;
+    const size_t capacity;
+    Handler handler;
+
+    std::deque<MatchSnapshot> queue;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread thread;
+
+    bool isRunning = false;
+};
@@ -0,0 +1,330 @@
+#include "pch.h"
+#include "FakeGameHost.h"
+#include "SampleRing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+using Clock = std::chrono::steady_clock;
+
+ScriptStep ScriptStep::Hook(double time, std::string eventName)
+{
+	ScriptStep step;
+	step.time = time;
+	step.eventName = std::move(eventName);
+	return step;
+}
+
+ScriptStep ScriptStep::Ticker(double time, std::string eventName, const StatTickerEvent& ticker)
+{
+	ScriptStep step;
+	step.time = time;
+	step.kind = Kind::StatTicker;
+	step.eventName = std::move(eventName);
+	step.ticker = ticker;
+	return step;
+}
+
+ScriptStep ScriptStep::Clock(double time, const MatchClockState& clock)
+{
+	ScriptStep step;
+	step.time = time;
+	step.kind = Kind::SetClock;
+	step.clock = clock;
+	return step;
+}
+
+ScriptStep ScriptStep::MMR(double time, int playlistId, float mmr)
+{
+	ScriptStep step;
+	step.time = time;
+	step.kind = Kind::SetMMR;
+	step.playlistId = playlistId;
+	step.mmr = mmr;
+	return step;
+}
+
+void FakeGameHost::HookEvent(const std::string& eventName, Callback callback)
+{
+	hooks[eventName].push_back(std::move(callback));
+}
+
+void FakeGameHost::HookStatTicker(const std::string& eventName, StatTickerCallback callback)
+{
+	tickerHooks[eventName].push_back(std::move(callback));
+}
+
+void FakeGameHost::SetTimeout(Callback callback, float delaySeconds)
+{
+	timers.push(Timer{ now + delaySeconds, timerOrder++, std::move(callback) });
+}
+
+OnlineGameInfo FakeGameHost::GetOnlineGame()
+{
+	OnlineGameInfo info;
+	info.isValid = inOnlineGame;
+	info.playlistId = playlistId;
+	return info;
+}
+
+float FakeGameHost::GetPlayerMMR(int playlist)
+{
+	auto it = mmr.find(playlist);
+	return it == mmr.end() ? -1.0f : it->second;
+}
+
+void FakeGameHost::OnMMRChanged(Callback callback)
+{
+	mmrCallbacks.push_back(std::move(callback));
+}
+
+IGameHost::TimePoint FakeGameHost::ClockNow()
+{
+	return TimePoint() + std::chrono::duration_cast<TimePoint::duration>(std::chrono::duration<double>(now));
+}
+
+int64_t FakeGameHost::WallClockMs()
+{
+	return wallClockStartMs + static_cast<int64_t>(std::llround(now * 1000.0));
+}
+
+void FakeGameHost::SetMMR(int playlistId, float value)
+{
+	mmr[playlistId] = value;
+	for (const Callback& callback : mmrCallbacks) {
+		callback();
+	}
+}
+
+std::string FakeGameHost::GetPlayerName(uintptr_t player)
+{
+	auto it = playerNames.find(player);
+	return it == playerNames.end() ? std::string() : it->second;
+}
+
+std::string FakeGameHost::GetStatEventName(uintptr_t statEvent)
+{
+	auto it = statEventNames.find(statEvent);
+	return it == statEventNames.end() ? std::string() : it->second;
+}
+
+bool FakeGameHost::StopReplayRecording()
+{
+	return true;
+}
+
+IGameHost::ReplayHandle FakeGameHost::TakeReplay()
+{
+	return std::make_shared<int>(0);
+}
+
+bool FakeGameHost::WriteReplay(const ReplayHandle& replay, const std::string& path)
+{
+	if (!replay) return false;
+
+	if (onWriteReplay) onWriteReplay();
+	replaysExported++;
+	if (replayBytes == 0) return true;
+
+	std::ofstream file(path, std::ofstream::binary | std::ofstream::trunc);
+
+	std::vector<char> chunk(64 * 1024);
+	for (size_t i = 0; i < chunk.size(); i++) {
+		chunk[i] = static_cast<char>(i * 31);
+	}
+
+	for (size_t written = 0; written < replayBytes; written += chunk.size()) {
+		file.write(chunk.data(), std::min(chunk.size(), replayBytes - written));
+	}
+	return file.good();
+}
+
+void FakeGameHost::RunScript(const std::string& scriptFileName, const json& args)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	scriptsRun.push_back(scriptFileName);
+	scriptArgs.push_back(args);
+}
+
+void FakeGameHost::Log(const std::string& msg)
+{
+	LogAsync(msg);
+}
+
+void FakeGameHost::LogAsync(const std::string& msg)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	logs.push_back(msg);
+}
+
+PlayerRef FakeGameHost::AddPlayer(const std::string& name, uint8_t team, bool isLocal)
+{
+	PlayerRef player;
+	player.key = nextKey++;
+	player.team = team;
+	player.isLocal = isLocal;
+
+	playerNames[player.key] = name;
+
+	PlayerStatRow row;
+	row.key = player.key;
+	row.team = team;
+	row.isLocal = isLocal;
+	playerStats.push_back(row);
+	return player;
+}
+
+size_t FakeGameHost::CapturePlayerStats(PlayerStatRow* rows, size_t capacity)
+{
+	const size_t count = std::min(capacity, playerStats.size());
+	std::copy(playerStats.begin(), playerStats.begin() + count, rows);
+	return count;
+}
+
+bool FakeGameHost::CaptureSample(uint32_t fields, SampleFrame& frame)
+{
+	if (!inOnlineGame) return false;
+
+	// made up but repeatable: boost and positions drift with the virtual clock
+	const double t = now;
+
+	frame.playerCount = std::min(playerStats.size(), frame.keys.size());
+	for (size_t p = 0; p < frame.playerCount; p++)
+	{
+		const PlayerStatRow& row = playerStats[p];
+		const double phase = t * 0.3 + p;
+
+		frame.keys[p] = row.key;
+		frame.scores[p] = (fields & SampleScore) ? row.score : 0;
+		frame.boost[p] = static_cast<uint8_t>(50 + 50 * std::sin(phase));
+		frame.cars[p] = { static_cast<float>(3000 * std::cos(phase)), static_cast<float>(4000 * std::sin(phase)), 17.0f };
+	}
+
+	frame.ball = { static_cast<float>(2000 * std::sin(t * 0.2)), static_cast<float>(3000 * std::cos(t * 0.1)), 93.0f };
+	frame.possession = static_cast<int8_t>(static_cast<int>(t / 7) % 2);
+	return true;
+}
+
+uintptr_t FakeGameHost::StatEventKey(const std::string& eventName)
+{
+	auto it = statEventKeys.find(eventName);
+	if (it != statEventKeys.end()) return it->second;
+
+	const uintptr_t key = nextKey++;
+	statEventKeys[eventName] = key;
+	statEventNames[key] = eventName;
+	return key;
+}
+
+StatTickerEvent FakeGameHost::MakeTicker(const std::string& eventName, const PlayerRef& receiver, const PlayerRef& victim)
+{
+	StatTickerEvent event;
+	event.statEvent = StatEventKey(eventName);
+	event.receiver = receiver;
+	event.victim = victim;
+	return event;
+}
+
+void FakeGameHost::Fire(const std::string& eventName)
+{
+	auto it = hooks.find(eventName);
+	if (it == hooks.end()) return;
+
+	const Clock::time_point start = Clock::now();
+
+	for (const Callback& callback : it->second) {
+		callback();
+	}
+
+	if (onDispatch) {
+		onDispatch(eventName, Clock::now() - start);
+	}
+}
+
+// keeps the scoreboard in step with the tickers, roughly the way the game scores them
+static void ScoreStatEvent(PlayerStatRow& row, const std::string& statEvent)
+{
+	if (statEvent == "Goal") { row.goals++; row.score += 100; }
+	else if (statEvent == "OwnGoal") { row.ownGoals++; }
+	else if (statEvent == "Assist") { row.assists++; row.score += 50; }
+	else if (statEvent == "Save") { row.saves++; row.score += 50; }
+	else if (statEvent == "EpicSave") { row.saves++; row.score += 75; }
+	else if (statEvent == "Shot") { row.shots++; row.score += 20; }
+	else if (statEvent == "Demolish") { row.demolishes++; row.score += 10; }
+	else if (statEvent == "FirstTouch" || statEvent == "AerialHit" || statEvent == "Clear") { row.ballTouches++; row.score += 2; }
+}
+
+void FakeGameHost::FireStatTicker(const std::string& eventName, const StatTickerEvent& event)
+{
+	auto name = statEventNames.find(event.statEvent);
+	if (name != statEventNames.end())
+	{
+		for (PlayerStatRow& row : playerStats) {
+			if (row.key == event.receiver.key) ScoreStatEvent(row, name->second);
+		}
+	}
+
+	auto it = tickerHooks.find(eventName);
+	if (it == tickerHooks.end()) return;
+
+	const Clock::time_point start = Clock::now();
+
+	for (const StatTickerCallback& callback : it->second) {
+		callback(event);
+	}
+
+	if (onDispatch) {
+		onDispatch(eventName, Clock::now() - start);
+	}
+}
+
+void FakeGameHost::Advance(double seconds)
+{
+	const double target = now + seconds;
+
+	// callbacks may schedule more timeouts, so pop one at a time
+	while (!timers.empty() && timers.top().due <= target)
+	{
+		Timer timer = timers.top();
+		timers.pop();
+
+		now = timer.due;
+
+		const Clock::time_point start = Clock::now();
+		timer.callback();
+
+		if (onDispatch) {
+			onDispatch("SetTimeout", Clock::now() - start);
+		}
+	}
+	now = target;
+}
+
+void FakeGameHost::Run(const std::vector<ScriptStep>& steps)
+{
+	const double origin = now;
+
+	for (const ScriptStep& step : steps)
+	{
+		if (origin + step.time > now) {
+			Advance(origin + step.time - now);
+		}
+
+		switch (step.kind)
+		{
+		case ScriptStep::Kind::Hook:
+			Fire(step.eventName);
+			break;
+		case ScriptStep::Kind::StatTicker:
+			FireStatTicker(step.eventName, step.ticker);
+			break;
+		case ScriptStep::Kind::SetClock:
+			clockState = step.clock;
+			break;
+		case ScriptStep::Kind::SetMMR:
+			SetMMR(step.playlistId, step.mmr);
+			break;
+		}
+	}
+}
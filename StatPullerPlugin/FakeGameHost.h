@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "GameHost.h"
+
+// One step of a scripted match, `time` seconds after the script starts:
+// fire a hook, fire a stat ticker hook with `ticker`, change the clock
+// the host reports to `clock`, or set the MMR for `playlistId` to `mmr`.
+struct ScriptStep {
+    enum class Kind {
+        Hook,
+        StatTicker,
+        SetClock,
+        SetMMR,
+    };
+
+    double time = 0.0;
+    Kind kind = Kind::Hook;
+    std::string eventName;
+    StatTickerEvent ticker;
+    MatchClockState clock;
+    int playlistId = -1;
+    float mmr = 0.0f;
+
+    static ScriptStep Hook(double time, std::string eventName);
+    static ScriptStep Ticker(double time, std::string eventName, const StatTickerEvent& ticker);
+    static ScriptStep Clock(double time, const MatchClockState& clock);
+    static ScriptStep MMR(double time, int playlistId, float mmr);
+};
+
+// In-process IGameHost with a virtual clock. Hooks fire and timeouts run
+// only when the owner calls Fire/Advance/Run, so a whole match replays as
+// fast as the handlers allow. Everything except LogAsync and RunScript is
+// expected on the "game thread", i.e. the thread driving the fake.
+class FakeGameHost : public IGameHost
+{
+public:
+    void HookEvent(const std::string& eventName, Callback callback) override;
+    void HookStatTicker(const std::string& eventName, StatTickerCallback callback) override;
+
+    void SetTimeout(Callback callback, float delaySeconds) override;
+    // both follow the virtual clock
+    TimePoint ClockNow() override;
+    int64_t WallClockMs() override;
+
+    bool IsInOnlineGame() override { return inOnlineGame; }
+    bool IsInReplay() override { return inReplay; }
+    OnlineGameInfo GetOnlineGame() override;
+    MatchClockState GetClockState() override { return clockState; }
+    size_t CapturePlayerStats(PlayerStatRow* rows, size_t capacity) override;
+    bool CaptureSample(uint32_t fields, SampleFrame& frame) override;
+
+    float GetPlayerMMR(int playlistId) override;
+    bool IsMMRSynced(int playlistId) override { return mmr.count(playlistId) != 0; }
+    void OnMMRChanged(Callback callback) override;
+
+    std::string GetPlayerName(uintptr_t player) override;
+    std::string GetStatEventName(uintptr_t statEvent) override;
+
+    bool StopReplayRecording() override;
+    ReplayHandle TakeReplay() override;
+    bool WriteReplay(const ReplayHandle& replay, const std::string& path) override;
+
+    void RunScript(const std::string& scriptFileName, const json& args = json::object()) override;
+
+    void Log(const std::string& msg) override;
+    void LogAsync(const std::string& msg) override;
+
+    // scripting
+    PlayerRef AddPlayer(const std::string& name, uint8_t team, bool isLocal = false);
+    uintptr_t StatEventKey(const std::string& eventName);
+    StatTickerEvent MakeTicker(const std::string& eventName, const PlayerRef& receiver, const PlayerRef& victim = PlayerRef());
+
+    // empties the scoreboard before the next match's players are added
+    void ClearPlayers() { playerStats.clear(); }
+
+    // sets the local player's MMR and notifies like the MMR service would
+    void SetMMR(int playlistId, float value);
+
+    void Fire(const std::string& eventName);
+    void FireStatTicker(const std::string& eventName, const StatTickerEvent& event);
+
+    // moves the virtual clock forward, running timeouts that come due
+    void Advance(double seconds);
+
+    // replays steps in order, advancing the clock to each step's time;
+    // step times count from the moment Run is called
+    void Run(const std::vector<ScriptStep>& steps);
+
+    double Now() const { return now; }
+
+    // when set, every hook dispatch and timeout is timed and reported here;
+    // timeouts are reported under the name "SetTimeout"
+    using DispatchObserver = std::function<void(const std::string& eventName, std::chrono::nanoseconds elapsed)>;
+    DispatchObserver onDispatch;
+
+    // wall clock when the virtual clock reads 0, 2026-01-01 00:00 UTC
+    int64_t wallClockStartMs = 1767225600000;
+
+    bool inOnlineGame = true;
+    bool inReplay = false;
+    int playlistId = 11;
+    MatchClockState clockState;
+    std::unordered_map<int, float> mmr;
+
+    // when nonzero WriteReplay writes a replay file of this size, standing
+    // in for the game serializing a real one
+    size_t replayBytes = 0;
+    std::atomic<size_t> replaysExported{ 0 };
+    // called on the writing thread before the replay is written
+    Callback onWriteReplay;
+
+    // filled from any thread, guarded by mutex
+    std::vector<std::string> scriptsRun;
+    std::vector<json> scriptArgs;
+    std::vector<std::string> logs;
+    mutable std::mutex mutex;
+
+private:
+    struct Timer {
+        double due;
+        uint64_t order;
+        Callback callback;
+
+        bool operator>(const Timer& other) const
+        {
+            return due != other.due ? due > other.due : order > other.order;
+        }
+    };
+
+    std::unordered_map<std::string, std::vector<Callback>> hooks;
+    std::unordered_map<std::string, std::vector<StatTickerCallback>> tickerHooks;
+    std::vector<Callback> mmrCallbacks;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+    uint64_t timerOrder = 0;
+    double now = 0.0;
+
+    std::unordered_map<uintptr_t, std::string> playerNames;
+    std::vector<PlayerStatRow> playerStats;
+    std::unordered_map<uintptr_t, std::string> statEventNames;
+    std::unordered_map<std::string, uintptr_t> statEventKeys;
+    uintptr_t nextKey = 0x1000;
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "json.hpp"
+using json = nlohmann::json;
+
+#include "PlayerStats.h"
+
+struct SampleFrame;     // SampleRing.h
+
+// Everything the stat core needs from the game, so the core builds without
+// the BakkesMod SDK or Windows headers. BakkesModHost is the real
+// implementation, FakeGameHost drives the core from scripted events.
+
+// A player as seen in a hook. key is stable for the match (the PRI address
+// in game), 0 means no player.
+struct PlayerRef {
+    uintptr_t key = 0;
+    uint8_t team = 0;       // 0 = blue, 1 = orange
+    bool isLocal = false;
+};
+
+struct StatTickerEvent {
+    uintptr_t statEvent = 0;    // pass to IGameHost::GetStatEventName
+    PlayerRef receiver;
+    PlayerRef victim;
+};
+
+struct MatchClockState {
+    bool isValid = false;
+    int secondsRemaining = 0;
+    bool isOvertime = false;
+    int gameLength = 0;     // regulation length in seconds
+};
+
+struct OnlineGameInfo {
+    bool isValid = false;
+    int playlistId = -1;
+};
+
+class IGameHost
+{
+public:
+    using Callback = std::function<void()>;
+    using StatTickerCallback = std::function<void(const StatTickerEvent&)>;
+    using TimePoint = std::chrono::steady_clock::time_point;
+    using ReplayHandle = std::shared_ptr<void>;
+
+    virtual ~IGameHost() = default;
+
+    virtual void HookEvent(const std::string& eventName, Callback callback) = 0;
+    virtual void HookStatTicker(const std::string& eventName, StatTickerCallback callback) = 0;
+
+    virtual void SetTimeout(Callback callback, float delaySeconds) = 0;
+
+    // Monotonic time that events and match durations are measured in, and
+    // the wall clock in ms since the Unix epoch. Game thread only; both
+    // move with the clock SetTimeout runs on.
+    virtual TimePoint ClockNow() = 0;
+    virtual int64_t WallClockMs() = 0;
+
+    virtual bool IsInOnlineGame() = 0;
+    virtual bool IsInReplay() = 0;
+    virtual OnlineGameInfo GetOnlineGame() = 0;
+
+    // clock of the match being played, read from the server
+    virtual MatchClockState GetClockState() = 0;
+
+    // Fills rows with the scoreboard of every player on a team, at most
+    // capacity of them, and returns how many were written.
+    virtual size_t CapturePlayerStats(PlayerStatRow* rows, size_t capacity) = 0;
+
+    // Reads the given SampleFields for every player on a team and the ball
+    // into frame. False if there's no game to read.
+    virtual bool CaptureSample(uint32_t fields, SampleFrame& frame) = 0;
+
+    // local player's MMR in the given playlist
+    virtual float GetPlayerMMR(int playlistId) = 0;
+    // false until the MMR service has the local player's value for it
+    virtual bool IsMMRSynced(int playlistId) = 0;
+    // called on the game thread whenever the MMR service updates one of the
+    // local player's values
+    virtual void OnMMRChanged(Callback callback) = 0;
+
+    virtual std::string GetPlayerName(uintptr_t player) = 0;
+    virtual std::string GetStatEventName(uintptr_t statEvent) = 0;
+
+    // Stops recording the current match replay, cheap enough for any hook.
+    virtual bool StopReplayRecording() = 0;
+
+    // Stops recording and holds on to the current match replay, cheap enough
+    // for the game thread. Null when there is no replay.
+    virtual ReplayHandle TakeReplay() = 0;
+
+    // Writes a replay from TakeReplay to path, callable from any thread. The
+    // game serializes the whole replay on the calling thread.
+    virtual bool WriteReplay(const ReplayHandle& replay, const std::string& path) = 0;
+
+    // Hands a post-processing script to the host, callable from any thread.
+    // The script gets args as JSON in sys.argv[1].
+    virtual void RunScript(const std::string& scriptFileName, const json& args = json::object()) = 0;
+
+    // Log may only be called on the game thread, LogAsync from anywhere.
+    virtual void Log(const std::string& msg) = 0;
+    virtual void LogAsync(const std::string& msg) = 0;
+};
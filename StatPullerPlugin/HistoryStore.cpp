@@ -0,0 +1,501 @@
+#include "pch.h"
+#include "HistoryStore.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#include "MatchState.h"
+#include "MatchSummary.h"
+
+#define HISTORY_MAGIC 0x43485053u          // "SPHC"
+#define HISTORY_BLOCK_MAGIC 0x42485053u    // "SPHB"
+#define HISTORY_VERSION 1u
+
+#define HISTORY_HEADER_SIZE 16
+#define HISTORY_BLOCK_HEADER_SIZE (16 + 16 * HISTORY_STAT_COUNT + 8)
+#define HISTORY_TAIL_RECORD_SIZE (8 + sizeof(HistoryRow))
+
+static uint32_t Checksum(const uint8_t* data, size_t size)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+template <typename T>
+static void Put(std::vector<uint8_t>& out, const T& value)
+{
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+	out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+static T Get(const uint8_t* p)
+{
+	T value;
+	memcpy(&value, p, sizeof(T));
+	return value;
+}
+
+static std::vector<uint8_t> ReadWholeFile(const std::string& path)
+{
+	std::vector<uint8_t> data;
+	std::ifstream in(path, std::ios::binary | std::ios::ate);
+	if (!in) return data;
+
+	data.resize(static_cast<size_t>(in.tellg()));
+	in.seekg(0);
+	in.read(reinterpret_cast<char*>(data.data()), data.size());
+	data.resize(static_cast<size_t>(in.gcount()));
+	return data;
+}
+
+int MatchMinute(bool isOvertime, int clockSeconds, int overtimeSeconds, int clockLength)
+{
+	if (isOvertime) {
+		return std::min(HISTORY_MINUTES - 1, 5 + overtimeSeconds / 60);
+	}
+	return std::clamp((clockLength - clockSeconds) / 60, 0, 4);
+}
+
+bool HistoryRowFromDocument(const json& document, HistoryRow& row)
+{
+	if (!document.is_object()) return false;
+	const auto matchId = document.find("MatchId");
+	if (matchId == document.end() || !matchId->is_number_integer()) return false;
+
+	const auto start = document.find("MatchStartWallClockMs");
+	row = SummaryFromDocument(document).ToHistoryRow(start != document.end() && start->is_number_integer() ? start->get<int64_t>() : 0);
+	return true;
+}
+
+static uint64_t PackMinutes(const uint8_t (&minutes)[HISTORY_MINUTES])
+{
+	uint64_t packed = 0;
+	for (int i = 0; i < HISTORY_MINUTES; i++) {
+		packed |= static_cast<uint64_t>(minutes[i]) << (8 * i);
+	}
+	return packed;
+}
+
+static void UnpackMinutes(uint64_t packed, uint8_t (&minutes)[HISTORY_MINUTES])
+{
+	for (int i = 0; i < HISTORY_MINUTES; i++) {
+		minutes[i] = static_cast<uint8_t>(packed >> (8 * i));
+	}
+}
+
+HistoryStore::~HistoryStore()
+{
+	Close();
+}
+
+bool HistoryStore::Open(const std::string& path, bool isWritable)
+{
+	Close();
+	this->path = path;
+	this->isWritable = isWritable;
+
+	if (!LoadBlocks(path, isWritable) || !LoadTail(isWritable))
+	{
+		Close();
+		return false;
+	}
+	isOpen = true;
+	return true;
+}
+
+void HistoryStore::Close()
+{
+	if (tail.is_open()) tail.close();
+
+	columns.ForEach([](auto& column) {
+		column.clear();
+	});
+	blocks.clear();
+	sealedRows = 0;
+	isOpen = false;
+}
+
+bool HistoryStore::LoadBlocks(const std::string& path, bool isWritable)
+{
+	const std::vector<uint8_t> file = ReadWholeFile(path);
+
+	if (file.size() < HISTORY_HEADER_SIZE)
+	{
+		if (!isWritable) return false;
+
+		std::vector<uint8_t> header;
+		Put(header, HISTORY_MAGIC);
+		Put(header, HISTORY_VERSION);
+		Put(header, static_cast<uint32_t>(HISTORY_BLOCK_ROWS));
+		Put(header, 0u);
+
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(header.data()), header.size());
+		return static_cast<bool>(out);
+	}
+
+	if (Get<uint32_t>(file.data()) != HISTORY_MAGIC || Get<uint32_t>(file.data() + 4) != HISTORY_VERSION
+		|| Get<uint32_t>(file.data() + 8) != HISTORY_BLOCK_ROWS) return false;
+
+	size_t rowBytes = 0;
+	columns.ForEach([&rowBytes](auto& column) {
+		rowBytes += sizeof(column[0]);
+	});
+	const size_t bodyBytes = rowBytes * HISTORY_BLOCK_ROWS;
+
+	size_t offset = HISTORY_HEADER_SIZE;
+	while (file.size() - offset >= HISTORY_BLOCK_HEADER_SIZE)
+	{
+		const uint8_t* header = file.data() + offset;
+		const uint8_t* body = header + HISTORY_BLOCK_HEADER_SIZE;
+		const size_t bodyOffset = 16 + 16 * HISTORY_STAT_COUNT;
+
+		if (Get<uint32_t>(header) != HISTORY_BLOCK_MAGIC
+			|| Get<uint32_t>(header + 4) != HISTORY_BLOCK_ROWS
+			|| Get<uint64_t>(header + 8) != sealedRows
+			|| Get<uint32_t>(header + bodyOffset) != bodyBytes
+			|| file.size() - offset - HISTORY_BLOCK_HEADER_SIZE < bodyBytes
+			|| Get<uint32_t>(header + bodyOffset + 4) != Checksum(body, bodyBytes)) break;
+
+		HistoryBlockStats stats;
+		stats.rows = HISTORY_BLOCK_ROWS;
+		for (int i = 0; i < HISTORY_STAT_COUNT; i++)
+		{
+			stats.min[i] = Get<int64_t>(header + 16 + 8 * i);
+			stats.max[i] = Get<int64_t>(header + 16 + 8 * (HISTORY_STAT_COUNT + i));
+		}
+		blocks.push_back(stats);
+
+		columns.ForEach([&body](auto& column) {
+			const size_t bytes = sizeof(column[0]) * HISTORY_BLOCK_ROWS;
+			const size_t size = column.size();
+			column.resize(size + HISTORY_BLOCK_ROWS);
+			memcpy(column.data() + size, body, bytes);
+			body += bytes;
+		});
+
+		sealedRows += HISTORY_BLOCK_ROWS;
+		offset += HISTORY_BLOCK_HEADER_SIZE + bodyBytes;
+	}
+
+	// a block cut short by a crash, its rows are still in the tail
+	if (offset != file.size() && isWritable)
+	{
+		std::error_code ec;
+		std::filesystem::resize_file(path, offset, ec);
+		if (ec) return false;
+	}
+	return true;
+}
+
+bool HistoryStore::LoadTail(bool isWritable)
+{
+	const std::string tailPath = path + ".tail";
+
+	const std::vector<uint8_t> file = ReadWholeFile(tailPath);
+
+	for (size_t offset = 0; file.size() - offset >= HISTORY_TAIL_RECORD_SIZE; offset += HISTORY_TAIL_RECORD_SIZE)
+	{
+		const uint64_t index = Get<uint64_t>(file.data() + offset);
+		// sealed before the tail was emptied
+		if (index < sealedRows) continue;
+		if (index != Count()) break;
+
+		PushRow(Get<HistoryRow>(file.data() + offset + 8));
+	}
+
+	if (!isWritable) return true;
+
+	// rewritten with only the rows still to seal, then appended to
+	tail.open(tailPath, std::ios::binary | std::ios::trunc);
+	for (size_t i = sealedRows; i < Count(); i++)
+	{
+		HistoryRow row{};
+		row.matchId = columns.matchIds[i];
+		row.startTimeMs = columns.startTimes[i];
+		row.playlist = columns.playlists[i];
+		row.mmrBefore = columns.mmrBefore[i];
+		row.mmrAfter = columns.mmrAfter[i];
+		row.goalsFor = columns.goalsFor[i];
+		row.goalsAgainst = columns.goalsAgainst[i];
+		row.result = columns.results[i];
+		row.outcome = columns.outcomes[i];
+		row.team = columns.teams[i];
+		row.isOvertime = columns.overtimes[i];
+		UnpackMinutes(columns.goalsForByMinute[i], row.goalsForByMinute);
+		UnpackMinutes(columns.goalsAgainstByMinute[i], row.goalsAgainstByMinute);
+
+		const uint64_t index = i;
+		tail.write(reinterpret_cast<const char*>(&index), sizeof(index));
+		tail.write(reinterpret_cast<const char*>(&row), sizeof(row));
+	}
+	tail.flush();
+
+	// a full block whose seal never made it to disk
+	if (Count() - sealedRows == HISTORY_BLOCK_ROWS && !SealBlock()) return false;
+	return static_cast<bool>(tail);
+}
+
+int64_t HistoryStore::StatValue(size_t row, HistoryStat stat) const
+{
+	switch (stat)
+	{
+	case HistoryStat::StartTime: return columns.startTimes[row];
+	case HistoryStat::Playlist: return columns.playlists[row];
+	case HistoryStat::MmrBefore: return columns.mmrBefore[row];
+	case HistoryStat::MmrAfter: return columns.mmrAfter[row];
+	case HistoryStat::GoalsFor: return columns.goalsFor[row];
+	case HistoryStat::GoalsAgainst: return columns.goalsAgainst[row];
+	}
+	return 0;
+}
+
+void HistoryStore::PushRow(const HistoryRow& row)
+{
+	columns.matchIds.push_back(row.matchId);
+	columns.startTimes.push_back(row.startTimeMs);
+	columns.playlists.push_back(row.playlist);
+	columns.mmrBefore.push_back(row.mmrBefore);
+	columns.mmrAfter.push_back(row.mmrAfter);
+	columns.goalsFor.push_back(row.goalsFor);
+	columns.goalsAgainst.push_back(row.goalsAgainst);
+	columns.results.push_back(row.result);
+	columns.outcomes.push_back(row.outcome);
+	columns.teams.push_back(row.team);
+	columns.overtimes.push_back(row.isOvertime);
+	columns.goalsForByMinute.push_back(PackMinutes(row.goalsForByMinute));
+	columns.goalsAgainstByMinute.push_back(PackMinutes(row.goalsAgainstByMinute));
+
+	const size_t index = Count() - 1;
+	if (index % HISTORY_BLOCK_ROWS == 0) {
+		blocks.emplace_back();
+	}
+
+	HistoryBlockStats& stats = blocks.back();
+	for (int i = 0; i < HISTORY_STAT_COUNT; i++)
+	{
+		const int64_t value = StatValue(index, static_cast<HistoryStat>(i));
+		stats.min[i] = stats.rows ? std::min(stats.min[i], value) : value;
+		stats.max[i] = stats.rows ? std::max(stats.max[i], value) : value;
+	}
+	stats.rows++;
+}
+
+bool HistoryStore::Append(const HistoryRow& row)
+{
+	if (!isOpen || !isWritable) return false;
+
+	const uint64_t index = Count();
+	PushRow(row);
+
+	tail.write(reinterpret_cast<const char*>(&index), sizeof(index));
+	tail.write(reinterpret_cast<const char*>(&row), sizeof(row));
+	tail.flush();
+	if (!tail) return false;
+
+	if (Count() - sealedRows == HISTORY_BLOCK_ROWS) return SealBlock();
+	return true;
+}
+
+bool HistoryStore::SealBlock()
+{
+	std::vector<uint8_t> body;
+	const size_t first = sealedRows;
+	columns.ForEach([&body, first](auto& column) {
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(column.data() + first);
+		body.insert(body.end(), bytes, bytes + sizeof(column[0]) * HISTORY_BLOCK_ROWS);
+	});
+
+	const HistoryBlockStats& stats = blocks[first / HISTORY_BLOCK_ROWS];
+
+	std::vector<uint8_t> block;
+	block.reserve(HISTORY_BLOCK_HEADER_SIZE + body.size());
+	Put(block, HISTORY_BLOCK_MAGIC);
+	Put(block, static_cast<uint32_t>(HISTORY_BLOCK_ROWS));
+	Put(block, static_cast<uint64_t>(first));
+	for (int i = 0; i < HISTORY_STAT_COUNT; i++) Put(block, stats.min[i]);
+	for (int i = 0; i < HISTORY_STAT_COUNT; i++) Put(block, stats.max[i]);
+	Put(block, static_cast<uint32_t>(body.size()));
+	Put(block, Checksum(body.data(), body.size()));
+	block.insert(block.end(), body.begin(), body.end());
+
+	std::ofstream out(path, std::ios::binary | std::ios::app);
+	out.write(reinterpret_cast<const char*>(block.data()), block.size());
+	out.flush();
+	if (!out) return false;
+
+	// only once the block is on disk, a crash in between leaves both and
+	// the tail copy is skipped on the next load
+	sealedRows += HISTORY_BLOCK_ROWS;
+	tail.close();
+	tail.open(path + ".tail", std::ios::binary | std::ios::trunc);
+	return static_cast<bool>(tail);
+}
+
+bool HistoryStore::RowMatches(size_t row, const HistoryFilter& filter) const
+{
+	if (filter.playlist >= 0 && columns.playlists[row] != filter.playlist) return false;
+	if (columns.startTimes[row] < filter.fromMs || columns.startTimes[row] >= filter.toMs) return false;
+	if (columns.mmrBefore[row] < filter.minMmr || columns.mmrBefore[row] > filter.maxMmr) return false;
+
+	if (filter.isCompletedOnly)
+	{
+		const MatchOutcome outcome = static_cast<MatchOutcome>(columns.outcomes[row]);
+		if (outcome != MatchOutcome::Completed && outcome != MatchOutcome::Forfeit) return false;
+	}
+	return true;
+}
+
+std::vector<uint32_t> HistoryStore::Select(const HistoryFilter& filter) const
+{
+	std::vector<uint32_t> rows;
+
+	// newest first so lastMatches can stop early, reversed at the end
+	for (size_t b = blocks.size(); b-- > 0;)
+	{
+		const HistoryBlockStats& stats = blocks[b];
+		const int playlist = static_cast<int>(HistoryStat::Playlist);
+		const int startTime = static_cast<int>(HistoryStat::StartTime);
+		const int mmr = static_cast<int>(HistoryStat::MmrBefore);
+
+		if (filter.playlist >= 0 && (filter.playlist < stats.min[playlist] || filter.playlist > stats.max[playlist])) continue;
+		if (stats.max[startTime] < filter.fromMs || stats.min[startTime] >= filter.toMs) continue;
+		if (stats.max[mmr] < filter.minMmr || stats.min[mmr] > filter.maxMmr) continue;
+
+		const size_t first = b * HISTORY_BLOCK_ROWS;
+		for (size_t row = first + stats.rows; row-- > first;)
+		{
+			if (!RowMatches(row, filter)) continue;
+
+			rows.push_back(static_cast<uint32_t>(row));
+			if (rows.size() == filter.lastMatches) {
+				std::reverse(rows.begin(), rows.end());
+				return rows;
+			}
+		}
+	}
+
+	std::reverse(rows.begin(), rows.end());
+	return rows;
+}
+
+HistorySummary HistoryStore::Summarize(const std::vector<uint32_t>& rows) const
+{
+	HistorySummary summary;
+	summary.matches = rows.size();
+
+	int streak = 0;
+	for (uint32_t row : rows)
+	{
+		summary.goalsFor += columns.goalsFor[row];
+		summary.goalsAgainst += columns.goalsAgainst[row];
+
+		if (summary.firstMmr < 0) summary.firstMmr = columns.mmrBefore[row];
+		if (columns.mmrAfter[row] >= 0) summary.lastMmr = columns.mmrAfter[row];
+
+		const HistoryResult result = static_cast<HistoryResult>(columns.results[row]);
+		if (result == HistoryResult::Win)
+		{
+			summary.wins++;
+			streak = streak > 0 ? streak + 1 : 1;
+			summary.longestWinStreak = std::max(summary.longestWinStreak, streak);
+		}
+		else if (result == HistoryResult::Loss)
+		{
+			summary.losses++;
+			streak = streak < 0 ? streak - 1 : -1;
+			summary.longestLossStreak = std::max(summary.longestLossStreak, -streak);
+		}
+	}
+
+	summary.currentStreak = streak;
+	const size_t decided = summary.wins + summary.losses;
+	summary.winRate = decided ? static_cast<double>(summary.wins) / decided : 0.0;
+	return summary;
+}
+
+std::vector<MmrBucket> HistoryStore::WinRateByMmr(const std::vector<uint32_t>& rows, int bucketWidth) const
+{
+	if (bucketWidth < 1) bucketWidth = 1;
+
+	int lowest = std::numeric_limits<int>::max();
+	int highest = -1;
+	for (uint32_t row : rows)
+	{
+		const int mmr = columns.mmrBefore[row];
+		if (mmr < 0) continue;
+		lowest = std::min(lowest, mmr);
+		highest = std::max(highest, mmr);
+	}
+	if (highest < 0) return std::vector<MmrBucket>();
+
+	// flat array from the lowest bucket up, empty ones dropped at the end
+	const int first = lowest / bucketWidth;
+	std::vector<MmrBucket> buckets(static_cast<size_t>(highest / bucketWidth - first + 1));
+	for (uint32_t row : rows)
+	{
+		const int mmr = columns.mmrBefore[row];
+		const HistoryResult result = static_cast<HistoryResult>(columns.results[row]);
+		if (mmr < 0 || result == HistoryResult::Unknown) continue;
+
+		MmrBucket& bucket = buckets[mmr / bucketWidth - first];
+		bucket.matches++;
+		if (result == HistoryResult::Win) bucket.wins++;
+	}
+
+	std::vector<MmrBucket> out;
+	for (size_t i = 0; i < buckets.size(); i++)
+	{
+		if (!buckets[i].matches) continue;
+		buckets[i].mmr = (first + static_cast<int>(i)) * bucketWidth;
+		out.push_back(buckets[i]);
+	}
+	return out;
+}
+
+std::vector<MmrPoint> HistoryStore::MmrTrend(const std::vector<uint32_t>& rows, size_t maxPoints) const
+{
+	std::vector<MmrPoint> points;
+	for (uint32_t row : rows)
+	{
+		if (columns.mmrAfter[row] < 0) continue;
+		points.push_back(MmrPoint{ columns.startTimes[row], columns.mmrAfter[row] });
+	}
+	if (maxPoints == 0 || points.size() <= maxPoints) return points;
+
+	// each point averages a run of matches and keeps the time of its last
+	const size_t group = (points.size() + maxPoints - 1) / maxPoints;
+	std::vector<MmrPoint> averaged;
+	for (size_t first = 0; first < points.size(); first += group)
+	{
+		const size_t last = std::min(points.size(), first + group);
+		int64_t sum = 0;
+		for (size_t i = first; i < last; i++) {
+			sum += points[i].mmr;
+		}
+		averaged.push_back(MmrPoint{ points[last - 1].startTimeMs, static_cast<int>(sum / static_cast<int64_t>(last - first)) });
+	}
+	return averaged;
+}
+
+GoalsByMinute HistoryStore::GoalsPerMinute(const std::vector<uint32_t>& rows) const
+{
+	GoalsByMinute goals;
+	for (uint32_t row : rows)
+	{
+		const uint64_t packedFor = columns.goalsForByMinute[row];
+		const uint64_t packedAgainst = columns.goalsAgainstByMinute[row];
+		for (int i = 0; i < HISTORY_MINUTES; i++)
+		{
+			goals.goalsFor[i] += (packedFor >> (8 * i)) & 0xFF;
+			goals.goalsAgainst[i] += (packedAgainst >> (8 * i)) & 0xFF;
+		}
+	}
+	return goals;
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "json.hpp"
+using json = nlohmann::json;
+
+// Columnar index of every exported match, from the local player's side,
+// for aggregate queries over a season without re-reading match files.
+//
+// Rows are sealed into blocks of HISTORY_BLOCK_ROWS. A sealed block is
+// appended to <path> with the min/max of each HistoryStat column and never
+// changes again. Rows of the block still filling up go to <path>.tail one
+// record at a time and move into <path> when the block seals.
+//
+//   file     "SPHC" u32 version u32 block rows u32 reserved
+//   block    "SPHB" u32 rows u64 first row i64 min[HISTORY_STAT_COUNT]
+//            i64 max[HISTORY_STAT_COUNT] u32 body bytes u32 FNV-1a of body
+//            body: each column's values back to back, in HistoryColumns order
+//   tail     u64 row, HistoryRow, repeated
+//
+// Everything is loaded into memory on Open; 10k matches is about half a
+// megabyte.
+
+#define HISTORY_BLOCK_ROWS 1024
+// minutes 0-4 of regulation, 5 and 6 the first two minutes of overtime,
+// 7 everything after
+#define HISTORY_MINUTES 8
+
+// which of the HISTORY_MINUTES a goal falls in
+int MatchMinute(bool isOvertime, int clockSeconds, int overtimeSeconds, int clockLength);
+
+enum class HistoryResult : uint8_t {
+    Loss,
+    Win,
+    Unknown,            // local player's team isn't known
+};
+
+struct HistoryRow {
+    uint64_t matchId;
+    int64_t startTimeMs;
+    int32_t playlist;
+    int32_t mmrBefore;                          // -1 if unknown
+    int32_t mmrAfter;
+    uint16_t goalsFor;
+    uint16_t goalsAgainst;
+    uint8_t result;                             // HistoryResult
+    uint8_t outcome;                            // MatchOutcome
+    uint8_t team;                               // 0xFF if unknown
+    uint8_t isOvertime;
+    uint8_t goalsForByMinute[HISTORY_MINUTES];
+    uint8_t goalsAgainstByMinute[HISTORY_MINUTES];
+    uint8_t reserved[4];
+};
+
+static_assert(sizeof(HistoryRow) == 56, "HistoryRow is written to the tail file as is");
+
+// Local player's row for an exported match document, built from
+// SummaryFromDocument. False if the document isn't a match or is from
+// before match ids were recorded.
+bool HistoryRowFromDocument(const json& document, HistoryRow& row);
+
+// columns with block min/max, the ones filters can skip blocks on
+enum class HistoryStat : uint8_t {
+    StartTime,
+    Playlist,
+    MmrBefore,
+    MmrAfter,
+    GoalsFor,
+    GoalsAgainst,
+};
+
+#define HISTORY_STAT_COUNT 6
+
+struct HistoryBlockStats {
+    uint32_t rows = 0;
+    int64_t min[HISTORY_STAT_COUNT];
+    int64_t max[HISTORY_STAT_COUNT];
+};
+
+struct HistoryFilter {
+    int playlist = -1;                                          // -1 for any
+    int64_t fromMs = std::numeric_limits<int64_t>::min();       // match start, inclusive
+    int64_t toMs = std::numeric_limits<int64_t>::max();         // exclusive
+    int minMmr = std::numeric_limits<int>::min();               // MMR before the match
+    int maxMmr = std::numeric_limits<int>::max();
+    bool isCompletedOnly = false;                               // no early exits or disconnects
+    size_t lastMatches = 0;                                     // newest N that pass, 0 for all
+};
+
+struct HistorySummary {
+    size_t matches = 0;
+    size_t wins = 0;
+    size_t losses = 0;
+    double winRate = 0.0;                   // of matches with a known result
+    uint64_t goalsFor = 0;
+    uint64_t goalsAgainst = 0;
+    int firstMmr = -1;                      // before the first match selected
+    int lastMmr = -1;                       // after the last one
+    int longestWinStreak = 0;
+    int longestLossStreak = 0;
+    int currentStreak = 0;                  // wins if positive, losses if negative
+};
+
+struct MmrBucket {
+    int mmr = 0;                            // matches with MMR before in [mmr, mmr + width)
+    size_t matches = 0;
+    size_t wins = 0;
+};
+
+struct MmrPoint {
+    int64_t startTimeMs = 0;
+    int mmr = 0;                            // after the match
+};
+
+struct GoalsByMinute {
+    uint64_t goalsFor[HISTORY_MINUTES] = {};
+    uint64_t goalsAgainst[HISTORY_MINUTES] = {};
+};
+
+class HistoryStore
+{
+public:
+    HistoryStore() = default;
+    ~HistoryStore();
+
+    HistoryStore(const HistoryStore&) = delete;
+    HistoryStore& operator=(const HistoryStore&) = delete;
+
+    // Loads the store. Writable creates it if missing and cuts off a block
+    // or tail record left half-written by a crash; read-only just ignores
+    // them, so it is safe while the plugin is appending.
+    bool Open(const std::string& path, bool isWritable);
+    void Close();
+
+    bool IsOpen() const { return isOpen; }
+    size_t Count() const { return columns.matchIds.size(); }
+
+    bool Append(const HistoryRow& row);
+
+    // matching rows, oldest first
+    std::vector<uint32_t> Select(const HistoryFilter& filter) const;
+
+    HistorySummary Summarize(const std::vector<uint32_t>& rows) const;
+    std::vector<MmrBucket> WinRateByMmr(const std::vector<uint32_t>& rows, int bucketWidth) const;
+    // one point per match, or averaged down to at most maxPoints
+    std::vector<MmrPoint> MmrTrend(const std::vector<uint32_t>& rows, size_t maxPoints) const;
+    GoalsByMinute GoalsPerMinute(const std::vector<uint32_t>& rows) const;
+
+    const std::vector<HistoryBlockStats>& Blocks() const { return blocks; }
+
+private:
+    struct HistoryColumns {
+        std::vector<uint64_t> matchIds;
+        std::vector<int64_t> startTimes;
+        std::vector<int32_t> playlists;
+        std::vector<int32_t> mmrBefore;
+        std::vector<int32_t> mmrAfter;
+        std::vector<uint16_t> goalsFor;
+        std::vector<uint16_t> goalsAgainst;
+        std::vector<uint8_t> results;
+        std::vector<uint8_t> outcomes;
+        std::vector<uint8_t> teams;
+        std::vector<uint8_t> overtimes;
+        // HISTORY_MINUTES counts packed one per byte
+        std::vector<uint64_t> goalsForByMinute;
+        std::vector<uint64_t> goalsAgainstByMinute;
+
+        template <typename Fn>
+        void ForEach(Fn&& fn)
+        {
+            fn(matchIds); fn(startTimes); fn(playlists); fn(mmrBefore); fn(mmrAfter);
+            fn(goalsFor); fn(goalsAgainst); fn(results); fn(outcomes); fn(teams); fn(overtimes);
+            fn(goalsForByMinute); fn(goalsAgainstByMinute);
+        }
+    };
+
+    void PushRow(const HistoryRow& row);
+    bool LoadBlocks(const std::string& path, bool isWritable);
+    bool LoadTail(bool isWritable);
+    bool SealBlock();
+    bool RowMatches(size_t row, const HistoryFilter& filter) const;
+    int64_t StatValue(size_t row, HistoryStat stat) const;
+
+    std::string path;
+    bool isOpen = false;
+    bool isWritable = false;
+
+    HistoryColumns columns;
+    // one per HISTORY_BLOCK_ROWS rows, the last one may still be filling up
+    std::vector<HistoryBlockStats> blocks;
+    size_t sealedRows = 0;
+
+    std::ofstream tail;
+};
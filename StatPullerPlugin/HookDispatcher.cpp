@@ -0,0 +1,76 @@
+#include "pch.h"
+#include "HookDispatcher.h"
+
+#include <chrono>
+#include <cstdio>
+
+#include "HookNames.h"
+
+static_assert(HOOK_COUNT == 6, "HOOK_TABLE needs an entry for every HookId");
+
+const HookSpec HOOK_TABLE[HOOK_COUNT] = {
+	{ HookId::MatchStarted, HOOK_ALL_TEAMS_CREATED, "MatchStarted", false },
+	{ HookId::MatchEnded, HOOK_MATCH_ENDED, "MatchEnded", false },
+	{ HookId::GameDestroyed, HOOK_GAME_DESTROYED, "GameDestroyed", false },
+	{ HookId::StatTicker, HOOK_STAT_TICKER, "StatTicker", true },
+	{ HookId::ClockUpdated, HOOK_GAME_TIME_UPDATED, "ClockUpdated", false },
+	{ HookId::LeaveMatch, HOOK_LEAVE_MATCH, "LeaveMatch", false },
+};
+
+void HookDispatcher::Register(IGameHost& host, IHookHandler& newHandler)
+{
+	handler = &newHandler;
+
+	for (const HookSpec& spec : HOOK_TABLE)
+	{
+		const HookId id = spec.id;
+
+		if (spec.isStatTicker)
+		{
+			host.HookStatTicker(spec.eventName, [this, id](const StatTickerEvent& event) {
+				Dispatch(id, &event);
+			});
+		}
+		else
+		{
+			host.HookEvent(spec.eventName, [this, id] {
+				Dispatch(id, nullptr);
+			});
+		}
+	}
+}
+
+void HookDispatcher::Dispatch(HookId id, const StatTickerEvent* ticker)
+{
+	const auto start = std::chrono::steady_clock::now();
+	handler->OnHook(id, ticker);
+	const uint64_t elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
+	HookCounters& counter = counters[static_cast<size_t>(id)];
+	counter.calls++;
+	counter.totalNs += elapsed;
+	if (elapsed > counter.maxNs) counter.maxNs = elapsed;
+}
+
+void HookDispatcher::ResetCounters()
+{
+	counters.fill(HookCounters());
+}
+
+std::string HookDispatcher::FormatCounters() const
+{
+	std::string report;
+	char line[160];
+
+	for (const HookSpec& spec : HOOK_TABLE)
+	{
+		const HookCounters& counter = Counters(spec.id);
+		snprintf(line, sizeof(line), "  %-14s calls %8llu  total %9.3fms  mean %8.2fus  max %8.2fus\n",
+			spec.label, static_cast<unsigned long long>(counter.calls),
+			counter.totalNs / 1e6,
+			counter.calls ? counter.totalNs / 1e3 / counter.calls : 0.0,
+			counter.maxNs / 1e3);
+		report += line;
+	}
+	return report;
+}
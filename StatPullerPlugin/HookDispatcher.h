@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "GameHost.h"
+
+// Every game event the core listens to. The host callbacks only carry the
+// id, handlers switch on it instead of comparing event names.
+enum class HookId : uint8_t {
+    MatchStarted = 0,
+    MatchEnded,
+    GameDestroyed,
+    StatTicker,
+    ClockUpdated,
+    LeaveMatch,
+    Count
+};
+
+#define HOOK_COUNT static_cast<size_t>(HookId::Count)
+
+struct HookSpec {
+    HookId id;
+    const char* eventName;
+    const char* label;          // short name for logs and stats
+    bool isStatTicker;          // hooked with IGameHost::HookStatTicker
+};
+
+// indexed by HookId
+extern const HookSpec HOOK_TABLE[HOOK_COUNT];
+
+struct HookCounters {
+    uint64_t calls = 0;
+    uint64_t totalNs = 0;
+    uint64_t maxNs = 0;
+};
+
+class IHookHandler
+{
+public:
+    virtual ~IHookHandler() = default;
+
+    // ticker is only set for HookId::StatTicker
+    virtual void OnHook(HookId id, const StatTickerEvent* ticker) = 0;
+};
+
+// Registers HOOK_TABLE with the host and times every handler call. Lives
+// on the game thread, like the hooks themselves.
+class HookDispatcher
+{
+public:
+    void Register(IGameHost& host, IHookHandler& handler);
+
+    const HookCounters& Counters(HookId id) const { return counters[static_cast<size_t>(id)]; }
+    void ResetCounters();
+
+    // one line per hook: calls, total, mean and max handler time
+    std::string FormatCounters() const;
+
+private:
+    void Dispatch(HookId id, const StatTickerEvent* ticker);
+
+    IHookHandler* handler = nullptr;
+    std::array<HookCounters, HOOK_COUNT> counters;
+};
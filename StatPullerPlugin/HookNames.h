@@ -0,0 +1,11 @@
+#pragma once
+
+// hooks on this class are called with the game's ServerWrapper
+#define HOOK_SERVER_PREFIX "Function TAGame.GameEvent_Soccar_TA."
+
+#define HOOK_ALL_TEAMS_CREATED "Function TAGame.GameEvent_Soccar_TA.OnAllTeamsCreated"
+#define HOOK_MATCH_ENDED "Function TAGame.GameEvent_Soccar_TA.EventMatchEnded"
+#define HOOK_GAME_DESTROYED "Function TAGame.GameEvent_Soccar_TA.Destroyed"
+#define HOOK_STAT_TICKER "Function TAGame.GFxHUD_TA.HandleStatTickerMessage"
+#define HOOK_GAME_TIME_UPDATED "Function TAGame.GameEvent_Soccar_TA.OnGameTimeUpdated"
+#define HOOK_LEAVE_MATCH "Function TAGame.GFxShell_TA.LeaveMatch"
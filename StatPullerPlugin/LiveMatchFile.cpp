@@ -0,0 +1,127 @@
+#include "pch.h"
+#include "LiveMatchFile.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool LiveMatchMapping::Open(const std::string& path, bool isWritable)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ | (isWritable ? GENERIC_WRITE : 0),
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+		isWritable ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) return false;
+	file = handle;
+
+	LARGE_INTEGER size;
+	if (!isWritable && (!GetFileSizeEx(handle, &size) || size.QuadPart < static_cast<LONGLONG>(LIVE_MATCH_FILE_BYTES)))
+	{
+		Close();
+		return false;
+	}
+
+	mapping = CreateFileMappingA(handle, nullptr, isWritable ? PAGE_READWRITE : PAGE_READONLY, 0, static_cast<DWORD>(LIVE_MATCH_FILE_BYTES), nullptr);
+	if (!mapping)
+	{
+		Close();
+		return false;
+	}
+
+	view = static_cast<uint8_t*>(MapViewOfFile(mapping, isWritable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, LIVE_MATCH_FILE_BYTES));
+#else
+	fd = open(path.c_str(), isWritable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+	if (fd < 0) return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0)
+	{
+		Close();
+		return false;
+	}
+	if (static_cast<size_t>(info.st_size) < LIVE_MATCH_FILE_BYTES)
+	{
+		if (!isWritable || ftruncate(fd, LIVE_MATCH_FILE_BYTES) != 0)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	void* address = mmap(nullptr, LIVE_MATCH_FILE_BYTES, isWritable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+	view = address == MAP_FAILED ? nullptr : static_cast<uint8_t*>(address);
+#endif
+	if (!view)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void LiveMatchMapping::Close()
+{
+#ifdef _WIN32
+	if (view) UnmapViewOfFile(view);
+	if (mapping) CloseHandle(mapping);
+	if (file) CloseHandle(file);
+	mapping = nullptr;
+	file = nullptr;
+#else
+	if (view) munmap(view, LIVE_MATCH_FILE_BYTES);
+	if (fd >= 0) close(fd);
+	fd = -1;
+#endif
+	view = nullptr;
+}
+
+bool LiveMatchFile::Open(const std::string& path)
+{
+	if (!mapping.Open(path, true)) return false;
+
+	// left over from a previous run or a new file, either way readers must
+	// not trust it until the header is rewritten
+	LiveMatchHeader* header = mapping.Header();
+	uint64_t sequence = header->sequence.load(std::memory_order_relaxed);
+	if (sequence & 1) sequence++;
+
+	header->sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	header->magic = LIVE_MATCH_MAGIC;
+	header->layoutVersion = LIVE_MATCH_LAYOUT_VERSION;
+	header->dataBytes = sizeof(LiveMatchData);
+	memset(mapping.Data(), 0, sizeof(LiveMatchData));
+	mapping.Data()->mmrBefore = -1;
+
+	header->sequence.store(sequence + 2, std::memory_order_release);
+	return true;
+}
+
+void LiveMatchFile::Close()
+{
+	mapping.Close();
+}
+
+void CopyLiveName(char (&out)[LIVE_NAME_BYTES], const std::string& name)
+{
+	size_t length = name.size() < LIVE_NAME_BYTES - 1 ? name.size() : LIVE_NAME_BYTES - 1;
+
+	// don't split a utf-8 sequence
+	if (length < name.size())
+	{
+		while (length > 0 && (static_cast<unsigned char>(name[length]) & 0xC0) == 0x80) length--;
+	}
+
+	memcpy(out, name.data(), length);
+	memset(out + length, 0, LIVE_NAME_BYTES - length);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "LiveMatchLayout.h"
+
+// A live-match.bin mapped into this process, read-write for the plugin,
+// read-only for readers. The platform mapping lives in LiveMatchFile.cpp
+// so no system headers leak into the layout or the reader.
+class LiveMatchMapping
+{
+public:
+    LiveMatchMapping() = default;
+    ~LiveMatchMapping() { Close(); }
+
+    LiveMatchMapping(const LiveMatchMapping&) = delete;
+    LiveMatchMapping& operator=(const LiveMatchMapping&) = delete;
+
+    // writable creates the file, or grows it to LIVE_MATCH_FILE_BYTES
+    bool Open(const std::string& path, bool isWritable);
+    void Close();
+
+    bool IsOpen() const { return view != nullptr; }
+
+    LiveMatchHeader* Header() const { return reinterpret_cast<LiveMatchHeader*>(view); }
+    LiveMatchData* Data() const { return reinterpret_cast<LiveMatchData*>(view + sizeof(LiveMatchHeader)); }
+
+private:
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+    uint8_t* view = nullptr;
+};
+
+// Writer side of live-match.bin. Game thread only, it's the seqlock's
+// single writer.
+class LiveMatchFile
+{
+public:
+    bool Open(const std::string& path);
+    void Close();
+    bool IsOpen() const { return mapping.IsOpen(); }
+
+    // Runs edit on the mapped data as one update; readers see all of it or
+    // none of it. Does nothing if the file isn't open.
+    template <typename EditFn>
+    void Update(EditFn&& edit)
+    {
+        if (!mapping.IsOpen()) return;
+
+        LiveMatchHeader* header = mapping.Header();
+        const uint64_t sequence = header->sequence.load(std::memory_order_relaxed);
+        header->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        LiveMatchData& data = *mapping.Data();
+        edit(data);
+        data.updates++;
+
+        header->sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+private:
+    LiveMatchMapping mapping;
+};
+
+// copies name into a fixed LIVE_NAME_BYTES field, cut at a character
+// boundary if it's too long
+void CopyLiveName(char (&out)[LIVE_NAME_BYTES], const std::string& name);
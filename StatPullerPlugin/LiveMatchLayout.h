@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Layout of live-match.bin, the match in progress as a fixed-size file
+// mapped into memory by the plugin and by any reader. Plain structs at
+// fixed offsets, little-endian, so readers in any language can use it:
+//
+//   0    LiveMatchHeader (128 bytes), sequence at offset 64
+//   128  LiveMatchData
+//
+// The plugin updates the data in place under a seqlock: sequence is odd
+// while an update is in progress and goes up by two per update. A reader
+// reads sequence, copies the data, then reads sequence again; the copy is
+// consistent if both reads are the same even number. See LiveMatchReader.h.
+
+#define LIVE_MATCH_MAGIC 0x4D4C5053u       // "SPLM"
+#define LIVE_MATCH_LAYOUT_VERSION 1
+#define LIVE_MAX_PLAYERS 8
+#define LIVE_MAX_GOALS 32
+#define LIVE_NAME_BYTES 32
+
+struct LiveMatchHeader {
+    uint32_t magic;
+    uint32_t layoutVersion;
+    uint32_t dataBytes;
+    uint32_t reserved[13];
+
+    // own cache line, readers poll it
+    std::atomic<uint64_t> sequence;
+    uint64_t reserved2[7];
+};
+
+struct LivePlayer {
+    char name[LIVE_NAME_BYTES];     // utf-8, null terminated
+    uint8_t team;
+    uint8_t isLocal;
+    uint16_t goals;
+    uint16_t assists;
+    uint16_t saves;
+    uint16_t shots;
+    uint16_t demolishes;
+    uint8_t reserved[4];
+};
+
+struct LiveGoal {
+    uint8_t scorer;                 // index into players
+    uint8_t team;
+    uint8_t isOvertime;
+    uint8_t reserved;
+    int16_t clockSeconds;
+    int16_t overtimeSeconds;
+    uint32_t elapsedMs;
+    uint32_t tick;
+};
+
+struct LiveMatchData {
+    uint64_t matchId;               // 0 before the first match
+    int64_t startWallClockMs;
+    uint32_t updates;
+    int32_t playlist;
+    int32_t mmrBefore;              // -1 if unknown
+    uint32_t elapsedMs;
+    uint32_t tick;
+    int16_t secondsRemaining;
+    int16_t overtimeSeconds;
+    int16_t clockLength;
+    uint8_t phase;                  // MatchPhase
+    uint8_t outcome;                // MatchOutcome, once phase is Ended
+    uint8_t isOvertime;
+    uint8_t playerCount;
+    uint8_t goalCount;
+    uint8_t reserved0;
+    uint16_t score[2];              // blue, orange
+    uint8_t reserved[12];
+
+    LivePlayer players[LIVE_MAX_PLAYERS];
+    LiveGoal goals[LIVE_MAX_GOALS];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the seqlock needs a lock-free 64-bit atomic");
+static_assert(sizeof(LiveMatchHeader) == 128, "LiveMatchHeader layout changed");
+static_assert(sizeof(LivePlayer) == 48, "LivePlayer layout changed");
+static_assert(sizeof(LiveGoal) == 16, "LiveGoal layout changed");
+static_assert(sizeof(LiveMatchData) == 64 + 48 * LIVE_MAX_PLAYERS + 16 * LIVE_MAX_GOALS, "LiveMatchData layout changed");
+
+#define LIVE_MATCH_FILE_BYTES (sizeof(LiveMatchHeader) + sizeof(LiveMatchData))
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <string>
+
+#include "LiveMatchFile.h"
+
+// Reads live-match.bin from another process. Free of plugin dependencies,
+// overlays include it and build LiveMatchFile.cpp for the mapping. After
+// Open, reads are plain memory loads, no syscalls, cheap enough to poll
+// every frame.
+//
+//   LiveMatchReader reader;
+//   LiveMatchData data;
+//   if (reader.Open(path) && reader.Read(data)) ...
+class LiveMatchReader
+{
+public:
+    // false if the file is missing, too small, or a different layout
+    bool Open(const std::string& path)
+    {
+        if (!mapping.Open(path, false)) return false;
+
+        const LiveMatchHeader* header = mapping.Header();
+        if (header->magic != LIVE_MATCH_MAGIC || header->layoutVersion != LIVE_MATCH_LAYOUT_VERSION || header->dataBytes != sizeof(LiveMatchData))
+        {
+            mapping.Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close() { mapping.Close(); }
+    bool IsOpen() const { return mapping.IsOpen(); }
+
+    // Copies a consistent snapshot into out. False if the plugin was
+    // mid-update on every attempt; updates take well under a microsecond,
+    // so that only happens if it stopped halfway.
+    bool Read(LiveMatchData& out, int attempts = 64, uint64_t* sequence = nullptr) const
+    {
+        if (!mapping.IsOpen()) return false;
+
+        const LiveMatchHeader* header = mapping.Header();
+        const LiveMatchData* data = mapping.Data();
+
+        for (int i = 0; i < attempts; i++)
+        {
+            const uint64_t before = header->sequence.load(std::memory_order_acquire);
+            if (before & 1) continue;
+
+            memcpy(&out, data, sizeof(out));
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const uint64_t after = header->sequence.load(std::memory_order_relaxed);
+
+            if (before == after)
+            {
+                if (sequence) *sequence = after;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    LiveMatchMapping mapping;
+};
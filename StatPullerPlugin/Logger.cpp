@@ -0,0 +1,354 @@
+#include "pch.h"
+#include "Logger.h"
+
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+
+#define LOG_DRAIN_INTERVAL std::chrono::milliseconds(20)
+
+static std::atomic<uint64_t> nextLoggerId{ 1 };
+
+// (logger id, ring) for every logger this thread has written to, handed
+// back when the thread exits so a later thread can reuse them
+struct ThreadRings {
+	std::vector<std::pair<uint64_t, std::shared_ptr<LogRing>>> rings;
+
+	~ThreadRings()
+	{
+		for (const auto& entry : rings) {
+			entry.second->Abandon();
+		}
+	}
+};
+
+static thread_local ThreadRings threadRings;
+
+static const char* LevelName(LogLevel level)
+{
+	switch (level)
+	{
+	case LogLevel::Debug: return "DEBUG";
+	case LogLevel::Info: return "INFO";
+	case LogLevel::Warn: return "WARN";
+	case LogLevel::Error: return "ERROR";
+	}
+	return "?";
+}
+
+LogRing::LogRing(size_t capacity)
+{
+	size_t size = 64;
+	while (size < capacity) size <<= 1;
+
+	buffer.resize(size);
+	mask = size - 1;
+}
+
+uint8_t* LogRing::Reserve(uint32_t size)
+{
+	const uint64_t bytes = RecordBytes(size);
+	const uint64_t position = head.load(std::memory_order_relaxed);
+	const uint64_t offset = position & mask;
+	const uint64_t contiguous = buffer.size() - offset;
+	const uint64_t needed = bytes <= contiguous ? bytes : contiguous + bytes;
+
+	if (bytes > buffer.size() / 2) return nullptr;
+
+	if (buffer.size() - (position - cachedTail) < needed)
+	{
+		cachedTail = tail.load(std::memory_order_acquire);
+		if (buffer.size() - (position - cachedTail) < needed) return nullptr;
+	}
+
+	reservedAt = position;
+	reservedSize = size;
+
+	if (bytes > contiguous)
+	{
+		const uint32_t skip = SKIP | static_cast<uint32_t>(contiguous);
+		memcpy(&buffer[offset], &skip, 4);
+		reservedAt = position + contiguous;
+	}
+
+	return &buffer[(reservedAt & mask) + 4];
+}
+
+void LogRing::Commit()
+{
+	memcpy(&buffer[reservedAt & mask], &reservedSize, 4);
+	head.store(reservedAt + RecordBytes(reservedSize), std::memory_order_release);
+}
+
+const uint8_t* LogRing::Peek(uint32_t& size)
+{
+	for (;;)
+	{
+		const uint64_t position = tail.load(std::memory_order_relaxed);
+		if (position == head.load(std::memory_order_acquire)) return nullptr;
+
+		uint32_t word;
+		memcpy(&word, &buffer[position & mask], 4);
+
+		if (word & SKIP)
+		{
+			tail.store(position + (word & ~SKIP), std::memory_order_release);
+			continue;
+		}
+
+		peekedSize = word;
+		size = word;
+		return &buffer[(position & mask) + 4];
+	}
+}
+
+void LogRing::Release()
+{
+	tail.store(tail.load(std::memory_order_relaxed) + RecordBytes(peekedSize), std::memory_order_release);
+}
+
+// Only once everything the old producer wrote has been drained, so its
+// records keep their order. Callers serialize claims.
+bool LogRing::TryClaim()
+{
+	if (!isAbandoned.load(std::memory_order_acquire)) return false;
+	if (tail.load(std::memory_order_acquire) != head.load(std::memory_order_relaxed)) return false;
+
+	isAbandoned.store(false, std::memory_order_relaxed);
+	return true;
+}
+
+Logger::Logger()
+	: id(nextLoggerId.fetch_add(1))
+{
+}
+
+Logger::~Logger()
+{
+	Stop();
+}
+
+void Logger::Start(Sink newConsole, std::string fileDirectory)
+{
+	if (isRunning) return;
+
+	console = std::move(newConsole);
+	steadyStart = std::chrono::steady_clock::now();
+	wallStart = std::chrono::system_clock::now();
+
+	if (!fileDirectory.empty())
+	{
+		std::error_code ec;
+		std::filesystem::create_directories(fileDirectory, ec);
+
+		filePath = fileDirectory + "statpuller.log";
+		file.open(filePath, std::ofstream::binary | std::ofstream::app);
+		fileBytes = std::filesystem::file_size(filePath, ec);
+		if (ec) fileBytes = 0;
+	}
+
+	isRunning = true;
+	thread = std::thread(&Logger::Run, this);
+}
+
+void Logger::Stop()
+{
+	if (!isRunning.exchange(false)) return;
+
+	if (thread.joinable()) {
+		thread.join();
+	}
+	file.close();
+}
+
+LogRing* Logger::RingForThread()
+{
+	for (const auto& entry : threadRings.rings) {
+		if (entry.first == id) return entry.second.get();
+	}
+
+	std::lock_guard<std::mutex> lock(ringsMutex);
+	for (const std::shared_ptr<LogRing>& ring : rings)
+	{
+		if (ring->TryClaim())
+		{
+			threadRings.rings.emplace_back(id, ring);
+			return ring.get();
+		}
+	}
+
+	rings.push_back(std::make_shared<LogRing>(LOG_RING_BYTES));
+	threadRings.rings.emplace_back(id, rings.back());
+	return rings.back().get();
+}
+
+size_t Logger::RingCount()
+{
+	std::lock_guard<std::mutex> lock(ringsMutex);
+	return rings.size();
+}
+
+void Logger::Run()
+{
+	while (isRunning)
+	{
+		if (!Drain()) {
+			std::this_thread::sleep_for(LOG_DRAIN_INTERVAL);
+		}
+	}
+
+	// whatever was logged before Stop
+	while (Drain()) {}
+}
+
+// Returns true if anything was written.
+bool Logger::Drain()
+{
+	std::vector<LogRing*> snapshot;
+	{
+		std::lock_guard<std::mutex> lock(ringsMutex);
+		for (const auto& ring : rings) snapshot.push_back(ring.get());
+	}
+
+	bool isWritten = false;
+	for (LogRing* ring : snapshot)
+	{
+		uint32_t size;
+		while (const uint8_t* record = ring->Peek(size))
+		{
+			std::chrono::system_clock::time_point loggedAt;
+			const std::string line = FormatRecord(record, size, loggedAt);
+			ring->Release();
+
+			if (console) console(line);
+			WriteFile(line, loggedAt);
+			isWritten = true;
+		}
+	}
+
+	const uint64_t droppedNow = Dropped();
+	if (droppedNow != reportedDropped)
+	{
+		const std::string line = "StatPuller: " + std::to_string(droppedNow - reportedDropped) + " log messages dropped, log ring full.";
+		reportedDropped = droppedNow;
+
+		if (console) console(line);
+		WriteFile(line, std::chrono::system_clock::now());
+	}
+
+	if (file.is_open()) file.flush();
+	return isWritten;
+}
+
+std::string Logger::FormatRecord(const uint8_t* record, uint32_t size, std::chrono::system_clock::time_point& loggedAt) const
+{
+	const uint8_t* end = record + size;
+
+	const LogSite* site;
+	int64_t timestamp;
+	memcpy(&site, record, sizeof(site));
+	memcpy(&timestamp, record + sizeof(site), sizeof(timestamp));
+	const uint8_t* arg = record + sizeof(site) + sizeof(timestamp);
+
+	const std::chrono::steady_clock::time_point steadyAt{ std::chrono::steady_clock::duration(timestamp) };
+	loggedAt = wallStart + std::chrono::duration_cast<std::chrono::system_clock::duration>(steadyAt - steadyStart);
+
+	std::string message = "StatPuller: ";
+	if (site->level != LogLevel::Info) {
+		message += std::string(LevelName(site->level)) + ": ";
+	}
+
+	for (const char* c = site->format; *c; c++)
+	{
+		if (c[0] != '{' || c[1] != '}' || arg >= end)
+		{
+			message.push_back(*c);
+			continue;
+		}
+		c++;
+
+		const LogArgType type = static_cast<LogArgType>(*arg++);
+		switch (type)
+		{
+		case LogArgType::Int: {
+			int64_t value;
+			memcpy(&value, arg, 8);
+			arg += 8;
+			message += std::to_string(value);
+			break;
+		}
+		case LogArgType::UInt: {
+			uint64_t value;
+			memcpy(&value, arg, 8);
+			arg += 8;
+			message += std::to_string(value);
+			break;
+		}
+		case LogArgType::Float: {
+			double value;
+			memcpy(&value, arg, 8);
+			arg += 8;
+			char text[32];
+			snprintf(text, sizeof(text), "%g", value);
+			message += text;
+			break;
+		}
+		case LogArgType::Bool:
+			message += *arg++ ? "true" : "false";
+			break;
+		case LogArgType::String: {
+			uint16_t length;
+			memcpy(&length, arg, 2);
+			message.append(reinterpret_cast<const char*>(arg + 2), length);
+			arg += 2 + length;
+			break;
+		}
+		}
+	}
+
+	return message;
+}
+
+void Logger::WriteFile(const std::string& line, std::chrono::system_clock::time_point loggedAt)
+{
+	if (!file.is_open()) return;
+
+	const std::time_t seconds = std::chrono::system_clock::to_time_t(loggedAt);
+	const int milliseconds = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(loggedAt.time_since_epoch()).count() % 1000);
+
+	std::tm local{};
+#ifdef _WIN32
+	localtime_s(&local, &seconds);
+#else
+	localtime_r(&seconds, &local);
+#endif
+
+	char stamp[40];
+	size_t stampLength = strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &local);
+	stampLength += snprintf(stamp + stampLength, sizeof(stamp) - stampLength, ".%03d ", milliseconds);
+
+	file.write(stamp, stampLength);
+	file.write(line.data(), line.size());
+	file.put('\n');
+	fileBytes += stampLength + line.size() + 1;
+
+	if (fileBytes >= LOG_FILE_MAX_BYTES) {
+		RotateFile();
+	}
+}
+
+// statpuller.log -> statpuller.log.1 -> ... -> statpuller.log.LOG_FILE_KEEP
+void Logger::RotateFile()
+{
+	file.close();
+
+	std::error_code ec;
+	std::filesystem::remove(filePath + "." + std::to_string(LOG_FILE_KEEP), ec);
+	for (int i = LOG_FILE_KEEP - 1; i >= 1; i--) {
+		std::filesystem::rename(filePath + "." + std::to_string(i), filePath + "." + std::to_string(i + 1), ec);
+	}
+	std::filesystem::rename(filePath, filePath + ".1", ec);
+
+	file.open(filePath, std::ofstream::binary | std::ofstream::trunc);
+	fileBytes = 0;
+}
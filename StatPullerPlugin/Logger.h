@@ -0,0 +1,277 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Structured logging that is cheap on the calling thread. A log statement
+// copies its arguments in binary into a ring owned by the calling thread,
+// a background thread formats them and writes the lines to the console
+// sink and a rotating log file.
+//
+//   SP_LOG_INFO(logger, "Goal scored by: {} on team {}", name, team);
+//
+// Format strings are literals with one {} per argument, checked at compile
+// time. Arguments can be integers, floating point numbers, bools and
+// strings; strings are copied, up to LOG_MAX_STRING bytes.
+
+enum class LogLevel : uint8_t {
+    Debug = 0,
+    Info,
+    Warn,
+    Error,
+};
+
+// statements below this level are compiled out, 0 keeps debug logging
+#ifndef STATPULLER_MIN_LOG_LEVEL
+#define STATPULLER_MIN_LOG_LEVEL 1
+#endif
+
+#define LOG_RING_BYTES (64 * 1024)
+#define LOG_MAX_STRING 256
+#define LOG_FILE_MAX_BYTES (1024 * 1024)
+#define LOG_FILE_KEEP 3
+
+// One per log statement, records only carry its address.
+struct LogSite {
+    LogLevel level;
+    const char* format;
+};
+
+constexpr size_t CountLogPlaceholders(const char* format)
+{
+    size_t count = 0;
+    for (; *format; format++) {
+        if (format[0] == '{' && format[1] == '}') count++;
+    }
+    return count;
+}
+
+template <size_t N>
+struct LogArgCount {
+    static constexpr size_t count = N;
+};
+
+// only used in decltype to count a macro's arguments
+template <typename... Args>
+LogArgCount<sizeof...(Args)> LogArgPack(const Args&...);
+
+#define SP_LOG(logger, level, format, ...) \
+    do { \
+        if constexpr (static_cast<int>(LogLevel::level) >= STATPULLER_MIN_LOG_LEVEL) { \
+            static_assert(CountLogPlaceholders(format) == decltype(LogArgPack(__VA_ARGS__))::count, \
+                "log format needs one {} per argument"); \
+            static constexpr LogSite logSite{ LogLevel::level, format }; \
+            (logger).Write(logSite, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define SP_LOG_DEBUG(logger, format, ...) SP_LOG(logger, Debug, format, ##__VA_ARGS__)
+#define SP_LOG_INFO(logger, format, ...) SP_LOG(logger, Info, format, ##__VA_ARGS__)
+#define SP_LOG_WARN(logger, format, ...) SP_LOG(logger, Warn, format, ##__VA_ARGS__)
+#define SP_LOG_ERROR(logger, format, ...) SP_LOG(logger, Error, format, ##__VA_ARGS__)
+
+// Single producer, single consumer ring of variable sized records. Records
+// never wrap, a record that doesn't fit before the end of the buffer is
+// preceded by a skip marker and starts over at the front.
+class LogRing
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit LogRing(size_t capacity);
+
+    // producer: space for size bytes, nullptr if the ring is full
+    uint8_t* Reserve(uint32_t size);
+    void Commit();
+
+    // consumer: the oldest record, nullptr if the ring is empty
+    const uint8_t* Peek(uint32_t& size);
+    void Release();
+
+    // The producer thread exited. Once drained the ring can be claimed by
+    // another thread, which becomes its producer.
+    void Abandon() { isAbandoned.store(true, std::memory_order_release); }
+    bool TryClaim();
+
+private:
+    static constexpr uint32_t SKIP = 0x80000000u;
+
+    static uint64_t RecordBytes(uint32_t size) { return (size + 4 + 7) & ~uint64_t(7); }
+
+    std::vector<uint8_t> buffer;
+    uint64_t mask = 0;
+
+    alignas(64) std::atomic<uint64_t> head{ 0 };
+    uint64_t reservedAt = 0;        // producer only
+    uint32_t reservedSize = 0;
+    uint64_t cachedTail = 0;
+
+    alignas(64) std::atomic<uint64_t> tail{ 0 };
+    uint32_t peekedSize = 0;        // consumer only
+
+    std::atomic<bool> isAbandoned{ false };
+};
+
+// Binary argument encoding: a tag byte, then the value.
+enum class LogArgType : uint8_t {
+    Int,
+    UInt,
+    Float,
+    Bool,
+    String,
+};
+
+struct LogArgEncoder {
+    template <typename T>
+    static size_t Size(const T& value)
+    {
+        if constexpr (std::is_same<T, bool>::value) return 2;
+        else if constexpr (std::is_arithmetic<T>::value || std::is_enum<T>::value) return 9;
+        else return 3 + StringView(value).second;
+    }
+
+    template <typename T>
+    static uint8_t* Put(uint8_t* out, const T& value)
+    {
+        if constexpr (std::is_same<T, bool>::value)
+        {
+            *out++ = static_cast<uint8_t>(LogArgType::Bool);
+            *out++ = value ? 1 : 0;
+        }
+        else if constexpr (std::is_floating_point<T>::value)
+        {
+            const double number = value;
+            *out++ = static_cast<uint8_t>(LogArgType::Float);
+            memcpy(out, &number, 8);
+            out += 8;
+        }
+        else if constexpr (std::is_enum<T>::value)
+        {
+            return Put(out, static_cast<typename std::underlying_type<T>::type>(value));
+        }
+        else if constexpr (std::is_integral<T>::value && std::is_signed<T>::value)
+        {
+            const int64_t number = value;
+            *out++ = static_cast<uint8_t>(LogArgType::Int);
+            memcpy(out, &number, 8);
+            out += 8;
+        }
+        else if constexpr (std::is_integral<T>::value)
+        {
+            const uint64_t number = value;
+            *out++ = static_cast<uint8_t>(LogArgType::UInt);
+            memcpy(out, &number, 8);
+            out += 8;
+        }
+        else
+        {
+            const std::pair<const char*, size_t> text = StringView(value);
+            *out++ = static_cast<uint8_t>(LogArgType::String);
+            const uint16_t length = static_cast<uint16_t>(text.second);
+            memcpy(out, &length, 2);
+            memcpy(out + 2, text.first, length);
+            out += 2 + length;
+        }
+        return out;
+    }
+
+    static std::pair<const char*, size_t> StringView(const std::string& value)
+    {
+        return { value.data(), value.size() < LOG_MAX_STRING ? value.size() : LOG_MAX_STRING };
+    }
+
+    static std::pair<const char*, size_t> StringView(const char* value)
+    {
+        if (!value) return { "", 0 };
+        const size_t length = strlen(value);
+        return { value, length < LOG_MAX_STRING ? length : LOG_MAX_STRING };
+    }
+};
+
+class Logger
+{
+public:
+    // called on the drain thread, once per line
+    using Sink = std::function<void(const std::string& line)>;
+
+    Logger();
+    ~Logger();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    // fileDirectory has a trailing separator, empty for no log file
+    void Start(Sink console, std::string fileDirectory);
+
+    // Writes everything already logged, then joins the drain thread.
+    void Stop();
+
+    // use the SP_LOG macros instead
+    template <typename... Args>
+    void Write(const LogSite& site, const Args&... args)
+    {
+        const uint32_t size = static_cast<uint32_t>(sizeof(const LogSite*) + sizeof(int64_t) + (0 + ... + LogArgEncoder::Size(args)));
+
+        LogRing* ring = RingForThread();
+        uint8_t* out = ring ? ring->Reserve(size) : nullptr;
+        if (!out)
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        const LogSite* sitePointer = &site;
+        const int64_t timestamp = std::chrono::steady_clock::now().time_since_epoch().count();
+        memcpy(out, &sitePointer, sizeof(sitePointer));
+        memcpy(out + sizeof(sitePointer), &timestamp, sizeof(timestamp));
+        out += sizeof(sitePointer) + sizeof(timestamp);
+
+        ((out = LogArgEncoder::Put(out, args)), ...);
+        ring->Commit();
+    }
+
+    uint64_t Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+    // rings allocated so far; a thread's ring is reused after it exits
+    size_t RingCount();
+
+private:
+    LogRing* RingForThread();
+
+    void Run();
+    bool Drain();
+    std::string FormatRecord(const uint8_t* record, uint32_t size, std::chrono::system_clock::time_point& loggedAt) const;
+    void WriteFile(const std::string& line, std::chrono::system_clock::time_point loggedAt);
+    void RotateFile();
+
+    // rings are looked up by id, a new logger at a dead one's address
+    // must not pick up its rings
+    const uint64_t id;
+
+    // shared with the threads writing to them, whichever goes first
+    std::mutex ringsMutex;
+    std::vector<std::shared_ptr<LogRing>> rings;
+
+    std::atomic<uint64_t> dropped{ 0 };
+    uint64_t reportedDropped = 0;
+
+    Sink console;
+    std::string filePath;
+    std::ofstream file;
+    uint64_t fileBytes = 0;
+
+    std::chrono::steady_clock::time_point steadyStart;
+    std::chrono::system_clock::time_point wallStart;
+
+    std::thread thread;
+    std::atomic<bool> isRunning{ false };
+};
@@ -0,0 +1,52 @@
+#include "pch.h"
+#include "MatchClock.h"
+
+#include <algorithm>
+
+void MatchClock::Start(int length, TimePoint now, int64_t wallClockMs)
+{
+	start = now;
+	startWallClockMs = wallClockMs;
+
+	clockLength = length;
+	secondsRemaining = length;
+	isOvertime = false;
+	ticks = 0;
+}
+
+void MatchClock::OnClockUpdated(const MatchClockState& state, TimePoint now)
+{
+	ticks++;
+
+	if (state.isValid)
+	{
+		secondsRemaining = state.secondsRemaining;
+		if (state.gameLength > 0) clockLength = state.gameLength;
+
+		if (state.isOvertime && !isOvertime) {
+			overtimeStart = now;
+		}
+		isOvertime = state.isOvertime;
+		return;
+	}
+
+	// no server to ask, assume one second passed
+	secondsRemaining = std::max(0, secondsRemaining - 1);
+}
+
+ClockReading MatchClock::Read(const MatchClockState& state, TimePoint now) const
+{
+	ClockReading reading;
+	reading.tick = ticks;
+	reading.elapsedMs = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count());
+
+	const bool overtime = state.isValid ? state.isOvertime : isOvertime;
+	reading.secondsRemaining = static_cast<int16_t>(state.isValid ? state.secondsRemaining : secondsRemaining);
+	reading.isOvertime = overtime;
+
+	// overtime that started after the last clock update begins now
+	if (overtime && isOvertime) {
+		reading.overtimeSeconds = static_cast<int16_t>(std::chrono::duration_cast<std::chrono::seconds>(now - overtimeStart).count());
+	}
+	return reading;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "GameHost.h"
+
+// Where in the match an event happened, by game clock and by real time.
+struct ClockReading {
+    int16_t secondsRemaining = 0;   // game clock, stays at 0 through overtime
+    int16_t overtimeSeconds = 0;    // time played in overtime
+    bool isOvertime = false;
+    uint32_t tick = 0;              // clock updates since the match started
+    uint32_t elapsedMs = 0;         // monotonic time since the match started
+};
+
+// Tracks the match clock from the server's own seconds-remaining and
+// overtime flag instead of counting hook calls, and timestamps events
+// against a monotonic clock anchored at match start.
+class MatchClock
+{
+public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    // now and wallClockMs are the host's clocks at match start
+    void Start(int clockLength, TimePoint now, int64_t wallClockMs);
+
+    // called for every OnGameTimeUpdated
+    void OnClockUpdated(const MatchClockState& state, TimePoint now);
+
+    // state is the server's clock at the time of the event; if it isn't
+    // valid the last known clock is used
+    ClockReading Read(const MatchClockState& state, TimePoint now) const;
+
+    int ClockLength() const { return clockLength; }
+    uint32_t Ticks() const { return ticks; }
+
+    // wall clock (ms since the Unix epoch) at match start, add elapsedMs
+    // from a reading to get the wall clock time of an event
+    int64_t StartWallClockMs() const { return startWallClockMs; }
+
+private:
+    TimePoint start;
+    int64_t startWallClockMs = 0;
+
+    int clockLength = 300;
+    int secondsRemaining = 300;
+    bool isOvertime = false;
+    TimePoint overtimeStart;
+    uint32_t ticks = 0;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+struct GoalEvent {
+    uint16_t scorerId;          // index into the match PlayerTable
+    uint8_t team;               // 0 = blue, 1 = orange
+    uint8_t isOvertime;
+    int16_t clockSeconds;       // game clock when the goal was scored
+    int16_t overtimeSeconds;
+    uint32_t tick;              // clock updates since the match started
+    uint32_t elapsedMs;         // monotonic time since the match started
+};
+
+// Fixed-capacity event storage, never allocates after construction.
+// Events past the capacity are counted and dropped.
+template <typename T, size_t Capacity>
+class EventBuffer
+{
+public:
+    bool Push(const T& event)
+    {
+        if (count == Capacity) {
+            dropped++;
+            return false;
+        }
+        items[count++] = event;
+        return true;
+    }
+
+    void Clear()
+    {
+        count = 0;
+        dropped = 0;
+    }
+
+    size_t Size() const { return count; }
+    uint32_t Dropped() const { return dropped; }
+
+    const T* begin() const { return items.data(); }
+    const T* end() const { return items.data() + count; }
+
+private:
+    std::array<T, Capacity> items;
+    size_t count = 0;
+    uint32_t dropped = 0;
+};
+
+#define MAX_GOAL_EVENTS 128
+
+using GoalBuffer = EventBuffer<GoalEvent, MAX_GOAL_EVENTS>;
@@ -0,0 +1,378 @@
+#include "pch.h"
+#include "MatchLog.h"
+
+#include <algorithm>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define MATCH_LOG_MAGIC 0x4C4D5053u    // "SPML"
+#define MATCH_INDEX_MAGIC 0x494D5053u  // "SPMI"
+#define MATCH_LOG_VERSION 2u
+
+#define HEADER_SIZE 16
+#define RECORD_HEADER_SIZE 8
+#define TRAILER_SIZE 16
+
+static void PutU32(std::vector<uint8_t>& out, uint32_t value)
+{
+	for (int i = 0; i < 4; i++) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+static void PutU64(std::vector<uint8_t>& out, uint64_t value)
+{
+	for (int i = 0; i < 8; i++) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+static uint32_t GetU32(const uint8_t* p)
+{
+	uint32_t value = 0;
+	for (int i = 3; i >= 0; i--) value = (value << 8) | p[i];
+	return value;
+}
+
+static uint64_t GetU64(const uint8_t* p)
+{
+	uint64_t value = 0;
+	for (int i = 7; i >= 0; i--) value = (value << 8) | p[i];
+	return value;
+}
+
+static uint32_t Checksum(const uint8_t* data, size_t size)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+MatchLogWriter::~MatchLogWriter()
+{
+	Close();
+}
+
+bool MatchLogWriter::Open(const std::string& path)
+{
+	Close();
+	offsets.clear();
+	indexedCount = 0;
+	lastIndex = 0;
+
+	std::error_code ec;
+	if (std::filesystem::exists(path, ec) && std::filesystem::file_size(path, ec) > 0)
+	{
+		MatchLogReader reader;
+		if (!reader.Open(path)) return false;
+
+		offsets = reader.Offsets();
+		dataEnd = reader.DataEnd();
+		lastIndex = reader.LastIndex();
+		indexedCount = std::lower_bound(offsets.begin(), offsets.end(), lastIndex) - offsets.begin();
+		reader.Close();
+
+		// drop a half-written entry or trailer so the new trailer is the file's tail
+		std::filesystem::resize_file(path, dataEnd, ec);
+		if (ec) return false;
+
+		file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+		if (!file.is_open()) return false;
+
+		// a version 1 log's records carry over, only the footer was different
+		std::vector<uint8_t> version;
+		PutU32(version, MATCH_LOG_VERSION);
+		file.seekp(4);
+		file.write(reinterpret_cast<const char*>(version.data()), version.size());
+		return WriteTrailer();
+	}
+
+	file.open(path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) return false;
+
+	std::vector<uint8_t> header;
+	PutU32(header, MATCH_LOG_MAGIC);
+	PutU32(header, MATCH_LOG_VERSION);
+	PutU64(header, 0);
+	file.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+	dataEnd = HEADER_SIZE;
+	return WriteTrailer();
+}
+
+void MatchLogWriter::Close()
+{
+	if (file.is_open()) {
+		file.close();
+	}
+}
+
+bool MatchLogWriter::Append(const std::vector<uint8_t>& payload)
+{
+	if (!file.is_open()) return false;
+
+	const uint64_t offset = dataEnd;
+	if (!WriteEntry(static_cast<uint32_t>(payload.size()), payload)) return false;
+	offsets.push_back(offset);
+
+	if (offsets.size() - indexedCount >= MATCH_INDEX_INTERVAL && !WriteIndex()) return false;
+	return WriteTrailer();
+}
+
+bool MatchLogWriter::WriteEntry(uint32_t sizeField, const std::vector<uint8_t>& payload)
+{
+	std::vector<uint8_t> entryHeader;
+	PutU32(entryHeader, sizeField);
+	PutU32(entryHeader, Checksum(payload.data(), payload.size()));
+
+	// on disk before the trailer that points past it
+	file.seekp(static_cast<std::streamoff>(dataEnd));
+	file.write(reinterpret_cast<const char*>(entryHeader.data()), entryHeader.size());
+	file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+	file.flush();
+	if (!file) return false;
+
+	dataEnd += RECORD_HEADER_SIZE + payload.size();
+	return true;
+}
+
+bool MatchLogWriter::WriteIndex()
+{
+	std::vector<uint8_t> index;
+	index.reserve(8 * (1 + offsets.size() - indexedCount));
+	PutU64(index, lastIndex);
+	for (size_t i = indexedCount; i < offsets.size(); i++) {
+		PutU64(index, offsets[i]);
+	}
+
+	const uint64_t offset = dataEnd;
+	if (!WriteEntry(static_cast<uint32_t>(index.size()) | MATCH_INDEX_ENTRY, index)) return false;
+
+	lastIndex = offset;
+	indexedCount = offsets.size();
+	return true;
+}
+
+bool MatchLogWriter::WriteTrailer()
+{
+	std::vector<uint8_t> trailer;
+	PutU64(trailer, lastIndex);
+	PutU32(trailer, static_cast<uint32_t>(offsets.size()));
+	PutU32(trailer, MATCH_INDEX_MAGIC);
+
+	file.seekp(static_cast<std::streamoff>(dataEnd));
+	file.write(reinterpret_cast<const char*>(trailer.data()), trailer.size());
+	file.flush();
+	return static_cast<bool>(file);
+}
+
+MatchLogReader::~MatchLogReader()
+{
+	Close();
+}
+
+bool MatchLogReader::Open(const std::string& path)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) return false;
+	fileHandle = handle;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(handle, &fileSize)) {
+		Close();
+		return false;
+	}
+	size = static_cast<size_t>(fileSize.QuadPart);
+
+	if (size > 0)
+	{
+		mappingHandle = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mappingHandle) {
+			Close();
+			return false;
+		}
+		data = static_cast<const uint8_t*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	}
+#else
+	fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		Close();
+		return false;
+	}
+	size = static_cast<size_t>(info.st_size);
+
+	if (size > 0)
+	{
+		void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+		data = mapped == MAP_FAILED ? nullptr : static_cast<const uint8_t*>(mapped);
+	}
+#endif
+
+	if (size > 0 && !data) {
+		Close();
+		return false;
+	}
+
+	if (size < HEADER_SIZE || GetU32(data) != MATCH_LOG_MAGIC) {
+		Close();
+		return false;
+	}
+
+	dataEnd = IndexRecords(data, size, offsets, lastIndex);
+	return true;
+}
+
+void MatchLogReader::Close()
+{
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mappingHandle) CloseHandle(mappingHandle);
+	if (fileHandle) CloseHandle(fileHandle);
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	if (data) munmap(const_cast<uint8_t*>(data), size);
+	if (fd >= 0) close(fd);
+	fd = -1;
+#endif
+	data = nullptr;
+	size = 0;
+	offsets.clear();
+	dataEnd = 0;
+	lastIndex = 0;
+}
+
+MatchRecordView MatchLogReader::Get(size_t index) const
+{
+	MatchRecordView record;
+	if (index >= offsets.size()) return record;
+
+	// IndexRecords checked the bounds, the payload is only checked here
+	const uint8_t* header = data + offsets[index];
+	const uint32_t recordSize = GetU32(header);
+	if (Checksum(header + RECORD_HEADER_SIZE, recordSize) != GetU32(header + 4)) return record;
+
+	record.size = recordSize;
+	record.data = header + RECORD_HEADER_SIZE;
+	return record;
+}
+
+json MatchLogReader::Parse(const MatchRecordView& record)
+{
+	return json::from_cbor(record.data, record.data + record.size, true, false);
+}
+
+bool MatchLogReader::ReadIndex(const uint8_t* data, size_t size, std::vector<uint64_t>& offsets, uint64_t& lastIndex)
+{
+	if (size < HEADER_SIZE + TRAILER_SIZE || GetU32(data + 4) != MATCH_LOG_VERSION) return false;
+
+	const uint64_t trailerOffset = size - TRAILER_SIZE;
+	const uint8_t* trailer = data + trailerOffset;
+	if (GetU32(trailer + 12) != MATCH_INDEX_MAGIC) return false;
+
+	const uint32_t count = GetU32(trailer + 8);
+	lastIndex = GetU64(trailer);
+
+	// index entries newest first, each must come before the one that points to it
+	std::vector<uint64_t> chain;
+	uint64_t limit = trailerOffset;
+	for (uint64_t index = lastIndex; index != 0;)
+	{
+		if (index < HEADER_SIZE || index + RECORD_HEADER_SIZE > limit) return false;
+
+		const uint32_t sizeField = GetU32(data + index);
+		const uint64_t entrySize = sizeField & ~MATCH_INDEX_ENTRY;
+		if (!(sizeField & MATCH_INDEX_ENTRY) || entrySize < 8 || entrySize % 8 != 0) return false;
+		if (index + RECORD_HEADER_SIZE + entrySize > limit) return false;
+		if (Checksum(data + index + RECORD_HEADER_SIZE, entrySize) != GetU32(data + index + 4)) return false;
+
+		chain.push_back(index);
+		limit = index;
+		index = GetU64(data + index + RECORD_HEADER_SIZE);
+	}
+
+	offsets.clear();
+	for (size_t i = chain.size(); i-- > 0;)
+	{
+		const uint8_t* entry = data + chain[i];
+		const uint64_t entrySize = GetU32(entry) & ~MATCH_INDEX_ENTRY;
+		for (uint64_t at = 16; at < RECORD_HEADER_SIZE + entrySize; at += 8) {
+			offsets.push_back(GetU64(entry + at));
+		}
+	}
+
+	// records after the last index, the ones a crash could have cut short
+	uint64_t position = HEADER_SIZE;
+	if (lastIndex) position = lastIndex + RECORD_HEADER_SIZE + (GetU32(data + lastIndex) & ~MATCH_INDEX_ENTRY);
+	while (position < trailerOffset)
+	{
+		if (position + RECORD_HEADER_SIZE > trailerOffset) return false;
+
+		const uint32_t recordSize = GetU32(data + position);
+		const uint64_t end = position + RECORD_HEADER_SIZE + recordSize;
+		if ((recordSize & MATCH_INDEX_ENTRY) || end > trailerOffset) return false;
+		if (Checksum(data + position + RECORD_HEADER_SIZE, recordSize) != GetU32(data + position + 4)) return false;
+
+		offsets.push_back(position);
+		position = end;
+	}
+
+	if (offsets.size() != count) return false;
+
+	// every record in range, in order, not overlapping the next
+	uint64_t previousEnd = HEADER_SIZE;
+	for (uint64_t offset : offsets)
+	{
+		if (offset < previousEnd || offset + RECORD_HEADER_SIZE > trailerOffset) return false;
+
+		const uint32_t recordSize = GetU32(data + offset);
+		if (recordSize & MATCH_INDEX_ENTRY) return false;
+		previousEnd = offset + RECORD_HEADER_SIZE + recordSize;
+		if (previousEnd > trailerOffset) return false;
+	}
+	return true;
+}
+
+uint64_t MatchLogReader::IndexRecords(const uint8_t* data, size_t size, std::vector<uint64_t>& offsets, uint64_t& lastIndex)
+{
+	if (ReadIndex(data, size, offsets, lastIndex)) return size - TRAILER_SIZE;
+
+	// no usable index, walk the entries and stop at the first bad record
+	offsets.clear();
+	lastIndex = 0;
+	uint64_t position = HEADER_SIZE;
+	uint64_t scan = HEADER_SIZE;
+	while (scan + RECORD_HEADER_SIZE <= size)
+	{
+		const uint32_t sizeField = GetU32(data + scan);
+		const uint64_t entrySize = sizeField & ~MATCH_INDEX_ENTRY;
+		const uint64_t end = scan + RECORD_HEADER_SIZE + entrySize;
+		if (end > size) break;
+
+		if (Checksum(data + scan + RECORD_HEADER_SIZE, entrySize) != GetU32(data + scan + 4))
+		{
+			// a bad index only lists records the walk finds anyway
+			if (!(sizeField & MATCH_INDEX_ENTRY)) break;
+			scan = end;
+			continue;
+		}
+
+		if (sizeField & MATCH_INDEX_ENTRY) lastIndex = scan;
+		else offsets.push_back(scan);
+		position = scan = end;
+	}
+	return position;
+}
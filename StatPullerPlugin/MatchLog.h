@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "json.hpp"
+using json = nlohmann::json;
+
+// Append-only history of exported matches.
+//
+// Layout, all integers little-endian:
+//   header   "SPML" u32 version u64 reserved
+//   entries  u32 size, u32 FNV-1a of payload, payload
+//            record  payload is a CBOR match document
+//            index   size has MATCH_INDEX_ENTRY set, payload is u64 offset
+//                    of the previous index (0 for none), u64 offsets of the
+//                    records since it
+//   trailer  u64 offset of the last index (0 for none), u32 record count, "SPMI"
+//
+// An append writes its record over the old trailer, flushes it, then
+// writes a new trailer, so a crash at any point leaves every earlier record
+// intact. Every MATCH_INDEX_INTERVAL records an index entry lists them, so
+// an append costs the same however long the log is. Readers follow the
+// index chain back from the trailer and walk the few records after the
+// last index. If any of it doesn't check out (crash during an append) the
+// records are recovered by walking them from the header until the first
+// one that doesn't check out.
+
+// marks an index entry in an entry's size field
+#define MATCH_INDEX_ENTRY 0x80000000u
+#define MATCH_INDEX_INTERVAL 64
+
+struct MatchRecordView {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+class MatchLogWriter
+{
+public:
+    MatchLogWriter() = default;
+    ~MatchLogWriter();
+
+    MatchLogWriter(const MatchLogWriter&) = delete;
+    MatchLogWriter& operator=(const MatchLogWriter&) = delete;
+
+    // Opens or creates the log. An existing log with a damaged trailer is
+    // cut back to its last intact entry.
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() const { return file.is_open(); }
+    size_t Count() const { return offsets.size(); }
+
+    bool Append(const std::vector<uint8_t>& payload);
+
+private:
+    bool WriteEntry(uint32_t sizeField, const std::vector<uint8_t>& payload);
+    bool WriteIndex();
+    bool WriteTrailer();
+
+    std::fstream file;
+    std::vector<uint64_t> offsets;
+    // records before this one are listed in index entries
+    size_t indexedCount = 0;
+    uint64_t lastIndex = 0;
+    uint64_t dataEnd = 0;
+};
+
+class MatchLogReader
+{
+public:
+    MatchLogReader() = default;
+    ~MatchLogReader();
+
+    MatchLogReader(const MatchLogReader&) = delete;
+    MatchLogReader& operator=(const MatchLogReader&) = delete;
+
+    // Maps the whole log read-only.
+    bool Open(const std::string& path);
+    void Close();
+
+    size_t Count() const { return offsets.size(); }
+    // empty if the record fails its checksum
+    MatchRecordView Get(size_t index) const;
+
+    const std::vector<uint64_t>& Offsets() const { return offsets; }
+
+    // end of the last intact entry, where the next append goes
+    uint64_t DataEnd() const { return dataEnd; }
+    // offset of the last intact index entry, 0 if there is none
+    uint64_t LastIndex() const { return lastIndex; }
+
+    template <typename Fn>
+    void ForEach(Fn&& fn) const
+    {
+        for (size_t i = 0; i < offsets.size(); i++) {
+            fn(i, Get(i));
+        }
+    }
+
+    static json Parse(const MatchRecordView& record);
+
+    // Finds record offsets in a mapped log, from the index if it's intact or
+    // by walking the entries otherwise. Returns the end of the last entry.
+    static uint64_t IndexRecords(const uint8_t* data, size_t size, std::vector<uint64_t>& offsets, uint64_t& lastIndex);
+
+private:
+    // the trailer and index chain, false if any of it doesn't check out
+    static bool ReadIndex(const uint8_t* data, size_t size, std::vector<uint64_t>& offsets, uint64_t& lastIndex);
+
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    std::vector<uint64_t> offsets;
+    uint64_t dataEnd = 0;
+    uint64_t lastIndex = 0;
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fd = -1;
+#endif
+};
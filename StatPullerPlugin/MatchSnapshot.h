@@ -0,0 +1,48 @@
+#pragma once
+
+#include <future>
+#include <string>
+#include <vector>
+
+#include "ExportFormat.h"
+#include "MatchEvents.h"
+#include "MatchState.h"
+#include "MatchSummary.h"
+#include "MmrTracker.h"
+#include "PlayerStats.h"
+#include "PlaylistPolicy.h"
+#include "ReplayFlusher.h"
+#include "SampleRing.h"
+#include "StatEventLog.h"
+
+// Plain copy of everything the exporter needs from a finished match.
+// Filled on the game thread, then handed off to the export worker.
+struct MatchSnapshot {
+    uint64_t matchId = 0;
+    MatchOutcome outcome = MatchOutcome::Completed;
+    int playlist = -1;
+    CaptureLevel captureLevel = CaptureLevel::Basic;
+    int mmrBefore = -1;
+    int mmrAfter = -1;
+    bool isMmrSettled = false;
+
+    ExportFormat format = ExportFormat::Json;
+    bool isSummaryScriptEnabled = true;
+
+    int clockLength = 300;
+    int64_t startWallClockMs = 0;
+
+    GoalBuffer goals;
+    StatEventLog events;
+    std::vector<std::string> eventNames;
+    std::vector<std::string> playerNames;
+    PlayerStatTable playerStats;
+    SampleRing samples;
+    // complete at match end apart from the post-match MMR
+    MatchSummary summary;
+
+    // ready once the replay file is complete or has failed
+    std::shared_future<ReplayResult> replay;
+    // ready once the post-match MMR is in, fills the mmr fields
+    std::shared_future<MmrResult> mmr;
+};
@@ -0,0 +1,97 @@
+#include "pch.h"
+#include "MatchState.h"
+
+// ids are start time in ms times this plus a counter, which stays under
+// 2^53 so json readers keep every digit
+#define MATCH_IDS_PER_MS 1000
+
+const char* MatchPhaseName(MatchPhase phase)
+{
+	switch (phase)
+	{
+	case MatchPhase::Idle: return "idle";
+	case MatchPhase::Countdown: return "countdown";
+	case MatchPhase::Live: return "live";
+	case MatchPhase::Overtime: return "overtime";
+	case MatchPhase::Ended: return "ended";
+	case MatchPhase::Exported: return "exported";
+	}
+	return "unknown";
+}
+
+const char* MatchOutcomeName(MatchOutcome outcome)
+{
+	switch (outcome)
+	{
+	case MatchOutcome::Completed: return "completed";
+	case MatchOutcome::Forfeit: return "forfeit";
+	case MatchOutcome::EarlyExit: return "early-exit";
+	case MatchOutcome::Disconnect: return "disconnect";
+	}
+	return "unknown";
+}
+
+bool ParseMatchOutcome(const std::string& name, MatchOutcome& outcome)
+{
+	for (uint8_t i = 0; i <= static_cast<uint8_t>(MatchOutcome::Disconnect); i++)
+	{
+		if (name == MatchOutcomeName(static_cast<MatchOutcome>(i))) {
+			outcome = static_cast<MatchOutcome>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+uint64_t MatchState::Begin(int64_t startWallClockMs)
+{
+	const uint64_t next = static_cast<uint64_t>(startWallClockMs) * MATCH_IDS_PER_MS;
+
+	// two matches in the same millisecond, or a clock that went backwards
+	id = next > id ? next : id + 1;
+	phase = MatchPhase::Countdown;
+	outcome = MatchOutcome::Completed;
+	isLeaving = false;
+	return id;
+}
+
+void MatchState::Ignore()
+{
+	phase = MatchPhase::Idle;
+}
+
+void MatchState::OnClockUpdated(const MatchClockState& state)
+{
+	if (phase == MatchPhase::Countdown) phase = MatchPhase::Live;
+	if (phase == MatchPhase::Live && state.isValid && state.isOvertime) phase = MatchPhase::Overtime;
+}
+
+void MatchState::OnLeaveMatch()
+{
+	if (IsActive()) isLeaving = true;
+}
+
+bool MatchState::End(MatchEndReason reason, const MatchClockState& state)
+{
+	if (!IsActive()) return false;
+
+	if (reason == MatchEndReason::MatchEnded)
+	{
+		const bool isClockDone = phase == MatchPhase::Overtime || !state.isValid || state.isOvertime || state.secondsRemaining <= 0;
+		outcome = isClockDone ? MatchOutcome::Completed : MatchOutcome::Forfeit;
+	}
+	else {
+		outcome = isLeaving ? MatchOutcome::EarlyExit : MatchOutcome::Disconnect;
+	}
+
+	phase = MatchPhase::Ended;
+	return true;
+}
+
+bool MatchState::MarkExported()
+{
+	if (phase != MatchPhase::Ended) return false;
+
+	phase = MatchPhase::Exported;
+	return true;
+}
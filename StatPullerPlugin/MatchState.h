@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "GameHost.h"
+
+enum class MatchPhase : uint8_t {
+    Idle,           // no match, or one that isn't captured
+    Countdown,      // teams created, clock not running yet
+    Live,
+    Overtime,
+    Ended,          // end seen, snapshot not handed off yet
+    Exported,
+};
+
+// How a match ended, decided by the first end hook that fires.
+enum class MatchOutcome : uint8_t {
+    Completed,      // clock ran out, or an overtime goal
+    Forfeit,        // match ended with time left on the clock
+    EarlyExit,      // local player left before the end
+    Disconnect,     // game went away without an end or a leave
+};
+
+enum class MatchEndReason : uint8_t {
+    MatchEnded,
+    GameDestroyed,
+};
+
+const char* MatchPhaseName(MatchPhase phase);
+const char* MatchOutcomeName(MatchOutcome outcome);
+bool ParseMatchOutcome(const std::string& name, MatchOutcome& outcome);
+
+// Lifecycle of the match being played. EventMatchEnded and Destroyed both
+// end a match and either may fire first, or both; only the first end
+// counts, so a match is snapshotted and exported exactly once. Game thread
+// only.
+class MatchState
+{
+public:
+    // OnAllTeamsCreated; returns the new match's id, ids are unique and
+    // increase with the start time
+    uint64_t Begin(int64_t startWallClockMs);
+
+    // the match turned out not to be captured
+    void Ignore();
+
+    // Countdown -> Live on the first clock update, Live -> Overtime when
+    // the server says so
+    void OnClockUpdated(const MatchClockState& state);
+
+    // the local player chose to leave
+    void OnLeaveMatch();
+
+    // true if this ended the match, false if it was already over or never
+    // started
+    bool End(MatchEndReason reason, const MatchClockState& state);
+
+    // Ended -> Exported, false for anything else
+    bool MarkExported();
+
+    MatchPhase Phase() const { return phase; }
+    MatchOutcome Outcome() const { return outcome; }
+    uint64_t Id() const { return id; }
+
+    bool IsActive() const { return phase == MatchPhase::Countdown || phase == MatchPhase::Live || phase == MatchPhase::Overtime; }
+
+private:
+    MatchPhase phase = MatchPhase::Idle;
+    MatchOutcome outcome = MatchOutcome::Completed;
+    uint64_t id = 0;
+    bool isLeaving = false;
+};
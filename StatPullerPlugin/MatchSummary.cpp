@@ -0,0 +1,256 @@
+#include "pch.h"
+#include "MatchSummary.h"
+
+#include <algorithm>
+#include <type_traits>
+
+void MatchSummary::Begin(uint64_t matchId, int playlist, int clockLength, int mmrBefore)
+{
+	*this = MatchSummary();
+	this->matchId = matchId;
+	this->playlist = playlist;
+	this->clockLength = clockLength;
+	this->mmrBefore = mmrBefore;
+}
+
+void MatchSummary::OnGoal(const GoalEvent& goal)
+{
+	if (goal.team > 1) return;
+
+	score[goal.team]++;
+	goalsByMinute[MatchMinute(goal.isOvertime, goal.clockSeconds, goal.overtimeSeconds, clockLength)][goal.team]++;
+
+	SummaryGoal entry;
+	entry.elapsedMs = goal.elapsedMs;
+	entry.clockSeconds = goal.clockSeconds;
+	entry.overtimeSeconds = goal.overtimeSeconds;
+	entry.scorerId = goal.scorerId;
+	entry.team = goal.team;
+	entry.isOvertime = goal.isOvertime;
+	entry.score[0] = score[0];
+	entry.score[1] = score[1];
+	timeline.Push(entry);
+}
+
+void MatchSummary::OnLocalStat(StatEventType type)
+{
+	switch (type)
+	{
+	case StatEventType::Goal: goals++; break;
+	case StatEventType::Assist: assists++; break;
+	case StatEventType::Save:
+	case StatEventType::EpicSave: saves++; break;
+	case StatEventType::Shot: shots++; break;
+	case StatEventType::Demolish: demolishes++; break;
+	default: break;
+	}
+}
+
+void MatchSummary::End(MatchOutcome outcome, uint32_t durationMs)
+{
+	this->outcome = outcome;
+	this->durationMs = durationMs;
+	isEnded = true;
+}
+
+void MatchSummary::SetMmr(int before, int after)
+{
+	if (before >= 0) mmrBefore = before;
+	mmrAfter = after;
+}
+
+uint16_t MatchSummary::GoalsFor() const
+{
+	return localTeam <= 1 ? score[localTeam] : 0;
+}
+
+uint16_t MatchSummary::GoalsAgainst() const
+{
+	return localTeam <= 1 ? score[1 - localTeam] : 0;
+}
+
+HistoryResult MatchSummary::Result() const
+{
+	if (localTeam > 1) return HistoryResult::Unknown;
+	// leaving counts as a loss whatever the score was
+	if (outcome == MatchOutcome::EarlyExit) return HistoryResult::Loss;
+	if (GoalsFor() == GoalsAgainst()) return HistoryResult::Unknown;
+	return GoalsFor() > GoalsAgainst() ? HistoryResult::Win : HistoryResult::Loss;
+}
+
+const char* MatchResultName(HistoryResult result)
+{
+	switch (result)
+	{
+	case HistoryResult::Win: return "win";
+	case HistoryResult::Loss: return "loss";
+	default: return "unknown";
+	}
+}
+
+json MatchSummary::ToJson(const std::vector<std::string>& playerNames) const
+{
+	json summary;
+	summary["MatchId"] = matchId;
+	summary["Playlist"] = playlist;
+	summary["Outcome"] = MatchOutcomeName(outcome);
+	summary["Result"] = MatchResultName(Result());
+	summary["LocalTeam"] = localTeam <= 1 ? static_cast<int>(localTeam) : -1;
+	summary["Score"] = { score[0], score[1] };
+	summary["DurationMs"] = durationMs;
+	summary["MMR_Before"] = mmrBefore;
+	summary["MMR_After"] = mmrAfter;
+	summary["MMR_Delta"] = mmrBefore >= 0 && mmrAfter >= 0 ? json(mmrAfter - mmrBefore) : json();
+
+	summary["Local"] = {
+		{ "Goals", goals },
+		{ "Assists", assists },
+		{ "Saves", saves },
+		{ "Shots", shots },
+		{ "Demolishes", demolishes },
+	};
+
+	json goalTimeline = json::array();
+	for (const SummaryGoal& goal : timeline)
+	{
+		goalTimeline.push_back({
+			{ "MatchTimeMs", goal.elapsedMs },
+			{ "GoalTimeSeconds", goal.clockSeconds },
+			{ "IsOvertime", goal.isOvertime != 0 },
+			{ "OvertimeSeconds", goal.overtimeSeconds },
+			{ "Scorer", goal.scorerId < playerNames.size() ? playerNames[goal.scorerId] : std::string() },
+			{ "Team", goal.team },
+			{ "Score", { goal.score[0], goal.score[1] } },
+		});
+	}
+	summary["Timeline"] = std::move(goalTimeline);
+
+	// from the local team's side, blue's if it isn't known
+	const int side = localTeam <= 1 ? localTeam : 0;
+	json goalsFor = json::array();
+	json goalsAgainst = json::array();
+	json differential = json::array();
+	for (int minute = 0; minute < HISTORY_MINUTES; minute++)
+	{
+		goalsFor.push_back(goalsByMinute[minute][side]);
+		goalsAgainst.push_back(goalsByMinute[minute][1 - side]);
+		differential.push_back(goalsByMinute[minute][side] - goalsByMinute[minute][1 - side]);
+	}
+	summary["GoalsByMinute"] = { { "For", std::move(goalsFor) }, { "Against", std::move(goalsAgainst) } };
+	summary["GoalDifferentialByMinute"] = std::move(differential);
+	return summary;
+}
+
+HistoryRow MatchSummary::ToHistoryRow(int64_t startTimeMs) const
+{
+	HistoryRow row = HistoryRow();
+	row.matchId = matchId;
+	row.startTimeMs = startTimeMs;
+	row.playlist = playlist;
+	row.mmrBefore = mmrBefore;
+	row.mmrAfter = mmrAfter;
+	row.goalsFor = GoalsFor();
+	row.goalsAgainst = GoalsAgainst();
+	row.result = static_cast<uint8_t>(Result());
+	row.outcome = static_cast<uint8_t>(outcome);
+	row.team = localTeam <= 1 ? localTeam : 0xFF;
+
+	for (int minute = 0; minute < HISTORY_MINUTES; minute++)
+	{
+		// minutes from 5 on are overtime
+		if (minute >= 5 && (goalsByMinute[minute][0] || goalsByMinute[minute][1])) row.isOvertime = 1;
+		if (localTeam > 1) continue;
+
+		row.goalsForByMinute[minute] = static_cast<uint8_t>(std::min<int>(goalsByMinute[minute][localTeam], 0xFF));
+		row.goalsAgainstByMinute[minute] = static_cast<uint8_t>(std::min<int>(goalsByMinute[minute][1 - localTeam], 0xFF));
+	}
+	return row;
+}
+
+// object[key] as T, fallback if it's missing, null or another type
+template <typename T>
+static T Field(const json& object, const char* key, T fallback)
+{
+	if (!object.is_object()) return fallback;
+	const auto it = object.find(key);
+	if (it == object.end()) return fallback;
+
+	if constexpr (std::is_same<T, bool>::value) return it->is_boolean() ? it->template get<T>() : fallback;
+	else if constexpr (std::is_arithmetic<T>::value) return it->is_number() ? it->template get<T>() : fallback;
+	else return it->is_string() ? it->template get<T>() : fallback;
+}
+
+// object[key] if it's an array, an empty one otherwise
+static const json& ArrayField(const json& object, const char* key)
+{
+	static const json empty = json::array();
+	if (!object.is_object()) return empty;
+	const auto it = object.find(key);
+	return it != object.end() && it->is_array() ? *it : empty;
+}
+
+MatchSummary SummaryFromDocument(const json& document)
+{
+	MatchSummary summary;
+	summary.Begin(Field(document, "MatchId", uint64_t(0)), Field(document, "Playlist", -1), Field(document, "ClockLength", 300), Field(document, "MMR_Before", -1));
+	summary.SetMmr(-1, Field(document, "MMR_After", -1));
+
+	const json& players = ArrayField(document, "Players");
+	const json empty = json::object();
+	const json& stats = document.is_object() && document.contains("PlayerStats") ? document["PlayerStats"] : empty;
+	const json& isLocal = ArrayField(stats, "IsLocal");
+	const json& teams = ArrayField(stats, "Team");
+	const json& playerIds = ArrayField(stats, "Player");
+	int localPlayer = -1;
+	for (size_t i = 0; i < isLocal.size() && i < teams.size() && i < playerIds.size(); i++)
+	{
+		if (isLocal[i].is_boolean() && isLocal[i].get<bool>() && teams[i].is_number() && playerIds[i].is_number()) {
+			summary.SetLocalTeam(teams[i].get<uint8_t>());
+			localPlayer = playerIds[i].get<int>();
+			break;
+		}
+	}
+
+	for (const json& entry : ArrayField(document, "Goals"))
+	{
+		GoalEvent goal{};
+		const std::string scorer = Field(entry, "ScorerName", std::string());
+		for (size_t i = 0; i < players.size(); i++) {
+			if (players[i] == scorer) goal.scorerId = static_cast<uint16_t>(i);
+		}
+		goal.team = Field(entry, "ScorerTeam", uint8_t(0));
+		goal.isOvertime = Field(entry, "IsOvertime", false);
+		goal.clockSeconds = Field(entry, "GoalTimeSeconds", int16_t(0));
+		goal.overtimeSeconds = Field(entry, "OvertimeSeconds", int16_t(0));
+		goal.elapsedMs = Field(entry, "MatchTimeMs", uint32_t(0));
+		summary.OnGoal(goal);
+	}
+
+	// the local player's line from the event columns
+	const json& events = document.is_object() && document.contains("Events") ? document["Events"] : empty;
+	const json& types = ArrayField(events, "Type");
+	const json& receivers = ArrayField(events, "Receiver");
+	if (localPlayer >= 0)
+	{
+		for (size_t i = 0; i < types.size() && i < receivers.size(); i++)
+		{
+			if (!receivers[i].is_number() || receivers[i].get<int>() != localPlayer || !types[i].is_string()) continue;
+
+			const std::string& type = types[i].get_ref<const std::string&>();
+			if (type == "Goal") summary.OnLocalStat(StatEventType::Goal);
+			else if (type == "Assist") summary.OnLocalStat(StatEventType::Assist);
+			else if (type == "Save") summary.OnLocalStat(StatEventType::Save);
+			else if (type == "EpicSave") summary.OnLocalStat(StatEventType::EpicSave);
+			else if (type == "Shot") summary.OnLocalStat(StatEventType::Shot);
+			else if (type == "Demolish") summary.OnLocalStat(StatEventType::Demolish);
+		}
+	}
+
+	MatchOutcome outcome = MatchOutcome::Completed;
+	ParseMatchOutcome(Field(document, "Outcome", std::string()), outcome);
+
+	const json& matchTimes = ArrayField(events, "MatchTimeMs");
+	const uint32_t durationMs = !matchTimes.empty() && matchTimes.back().is_number() ? matchTimes.back().get<uint32_t>() : 0;
+	summary.End(outcome, durationMs);
+	return summary;
+}
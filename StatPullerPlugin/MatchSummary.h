@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "json.hpp"
+using json = nlohmann::json;
+
+#include "HistoryStore.h"
+#include "MatchEvents.h"
+#include "MatchState.h"
+#include "StatEventLog.h"
+
+struct SummaryGoal {
+    uint32_t elapsedMs;
+    int16_t clockSeconds;
+    int16_t overtimeSeconds;
+    uint16_t scorerId;          // index into the match PlayerTable
+    uint8_t team;
+    uint8_t isOvertime;
+    uint16_t score[2];          // blue, orange after this goal
+};
+
+// The match summary, kept up to date as events arrive so it is complete
+// the moment the match ends: score line, goal timeline with the running
+// score, goals by minute and the local player's line. Every update is
+// O(1) and nothing allocates after Begin; the timeline shares the goal
+// buffer's capacity.
+class MatchSummary
+{
+public:
+    void Begin(uint64_t matchId, int playlist, int clockLength, int mmrBefore);
+
+    // from the stat tickers as soon as the local player shows up, and
+    // from the scoreboard at match end
+    void SetLocalTeam(uint8_t team) { localTeam = team; }
+
+    void OnGoal(const GoalEvent& goal);
+    void OnLocalStat(StatEventType type);
+
+    void End(MatchOutcome outcome, uint32_t durationMs);
+
+    // the post-match MMR, once the export worker has it
+    void SetMmr(int before, int after);
+
+    uint64_t MatchId() const { return matchId; }
+    HistoryResult Result() const;
+    uint16_t GoalsFor() const;
+    uint16_t GoalsAgainst() const;
+    int MmrBefore() const { return mmrBefore; }
+    int MmrAfter() const { return mmrAfter; }
+    uint32_t DurationMs() const { return durationMs; }
+    bool IsEnded() const { return isEnded; }
+
+    json ToJson(const std::vector<std::string>& playerNames) const;
+
+    // the history store's row for this match, result included, so the
+    // store and the session counters can't disagree
+    HistoryRow ToHistoryRow(int64_t startTimeMs) const;
+
+private:
+    uint64_t matchId = 0;
+    int playlist = -1;
+    int clockLength = 300;
+    int mmrBefore = -1;
+    int mmrAfter = -1;
+    uint8_t localTeam = 0xFF;
+    MatchOutcome outcome = MatchOutcome::Completed;
+    uint32_t durationMs = 0;
+    bool isEnded = false;
+
+    uint16_t score[2] = {};
+    uint16_t goalsByMinute[HISTORY_MINUTES][2] = {};
+    EventBuffer<SummaryGoal, MAX_GOAL_EVENTS> timeline;
+
+    // the local player's line
+    uint16_t goals = 0;
+    uint16_t assists = 0;
+    uint16_t saves = 0;
+    uint16_t shots = 0;
+    uint16_t demolishes = 0;
+};
+
+const char* MatchResultName(HistoryResult result);
+
+// The same summary recomputed from an exported match document, the way
+// build_summary.py does it. Used to compare the two and to rebuild the
+// history store. Missing, null or mistyped fields read as unknown rather
+// than throwing, the document may come from an older log.
+MatchSummary SummaryFromDocument(const json& document);
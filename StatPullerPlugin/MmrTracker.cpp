@@ -0,0 +1,150 @@
+#include "pch.h"
+#include "MmrTracker.h"
+
+#include <algorithm>
+
+MmrTracker::MmrTracker(IGameHost& host)
+	: host(host)
+{
+	cache.fill(-1.0f);
+}
+
+void MmrTracker::Start()
+{
+	lifetime = std::make_shared<const int>(0);
+	host.OnMMRChanged(Guard([this] {
+		OnChanged();
+	}));
+	RefreshAll();
+}
+
+void MmrTracker::Stop()
+{
+	Cancel();
+	lifetime.reset();
+	generation++;
+}
+
+float MmrTracker::Cached(int playlistId) const
+{
+	const int index = FindPlaylistPolicy(playlistId);
+	return index < 0 ? -1.0f : cache[index];
+}
+
+// -1 if the service hasn't synced the playlist yet
+float MmrTracker::Refresh(int playlistId)
+{
+	const int index = FindPlaylistPolicy(playlistId);
+	if (index < 0 || !host.IsMMRSynced(playlistId)) return -1.0f;
+
+	cache[index] = host.GetPlayerMMR(playlistId);
+	return cache[index];
+}
+
+void MmrTracker::RefreshAll()
+{
+	for (const PlaylistPolicy& policy : PLAYLIST_POLICIES) {
+		Refresh(policy.id);
+	}
+}
+
+void MmrTracker::BeginMatch(int playlistId)
+{
+	Cancel();
+
+	generation++;
+	playlist = playlistId;
+	before = Cached(playlistId);
+	after = -1.0f;
+
+	// nothing cached yet, MMR doesn't move during a match so any read
+	// before the end is the pre-match value
+	if (before < 0.0f) {
+		Poll(generation, 0);
+	}
+}
+
+std::shared_future<MmrResult> MmrTracker::EndMatch()
+{
+	Cancel();
+
+	generation++;
+	unchangedReads = 0;
+	pending = std::make_shared<std::promise<MmrResult>>();
+	std::shared_future<MmrResult> result = pending->get_future().share();
+
+	const uint64_t current = generation;
+	host.SetTimeout(Guard([this, current] {
+		Poll(current, 0);
+	}), MMR_FIRST_POLL);
+
+	return result;
+}
+
+void MmrTracker::Cancel()
+{
+	if (pending) Publish(false);
+}
+
+void MmrTracker::OnChanged()
+{
+	RefreshAll();
+	// the service pushed the post-match update, whatever the change
+	if (pending) TrySettle(true);
+}
+
+void MmrTracker::Poll(uint64_t expected, int attempt)
+{
+	if (expected != generation) return;
+
+	if (pending)
+	{
+		if (TrySettle(false)) return;
+	}
+	else
+	{
+		before = Refresh(playlist);
+		if (before >= 0.0f) return;
+	}
+
+	if (attempt + 1 >= MMR_MAX_POLLS)
+	{
+		if (pending) Publish(false);
+		return;
+	}
+
+	const float delay = std::min(MMR_MAX_POLL_DELAY, MMR_FIRST_POLL * static_cast<float>(1 << (attempt + 1)));
+	host.SetTimeout(Guard([this, expected, attempt] {
+		Poll(expected, attempt + 1);
+	}), delay);
+}
+
+// Settled once the service reported an update, the value moved away from
+// the pre-match one, or it read the same MMR_UNCHANGED_POLLS polls running.
+// Without a pre-match value the first synced read has to do.
+bool MmrTracker::TrySettle(bool isUpdated)
+{
+	const float value = Refresh(playlist);
+	if (value < 0.0f) return false;
+
+	unchangedReads = value == after ? unchangedReads + 1 : 1;
+	after = value;
+	if (!isUpdated && before >= 0.0f && after == before && unchangedReads < MMR_UNCHANGED_POLLS) return false;
+
+	Publish(true);
+	return true;
+}
+
+void MmrTracker::Publish(bool isSettled)
+{
+	MmrResult result;
+	result.before = before;
+	result.after = after >= 0.0f ? after : Cached(playlist);
+	result.isSettled = isSettled;
+
+	pending->set_value(result);
+	pending.reset();
+
+	// the next match in this playlist starts from here
+	generation++;
+}
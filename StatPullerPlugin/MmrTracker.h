@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <future>
+#include <memory>
+
+#include "GameHost.h"
+#include "PlaylistPolicy.h"
+
+// polls after a match ends, doubling from MMR_FIRST_POLL up to
+// MMR_MAX_POLL_DELAY, about 24 seconds in all
+#define MMR_FIRST_POLL 0.5f
+#define MMR_MAX_POLL_DELAY 8.0f
+#define MMR_MAX_POLLS 6
+// a post-match value that reads the same this many polls running is taken
+// as settled, a 0 point change looks like that without a notification
+#define MMR_UNCHANGED_POLLS 3
+
+struct MmrResult {
+    float before = -1.0f;
+    float after = -1.0f;
+    bool isSettled = false;     // after is a post-match value, not the last one seen
+};
+
+using MmrPromise = std::shared_ptr<std::promise<MmrResult>>;
+
+// The local player's MMR per playlist. Values are cached as soon as the
+// MMR service has them, so match start never waits on a query. After a
+// match the tracker waits for the new value: a change notification settles
+// it right away, even when the value didn't move, polling with backoff
+// catches it when no notification comes. Game thread only.
+//
+// The host keeps the callbacks it is given past the tracker's lifetime, so
+// each one holds a weak reference to the tracker's lifetime token and does
+// nothing once Stop or the destructor has dropped it.
+class MmrTracker
+{
+public:
+    explicit MmrTracker(IGameHost& host);
+
+    // subscribes to change notifications and caches every synced playlist
+    void Start();
+
+    // gives up on a pending result; notifications and polls already
+    // handed to the host are ignored from here on
+    void Stop();
+
+    // last known value, -1 if the playlist was never synced
+    float Cached(int playlistId) const;
+
+    void BeginMatch(int playlistId);
+
+    // ready once the post-match MMR came in or polling gave up
+    std::shared_future<MmrResult> EndMatch();
+
+    // gives up on a pending result
+    void Cancel();
+
+private:
+    // fn, as long as the tracker hasn't stopped
+    template <typename Fn>
+    IGameHost::Callback Guard(Fn fn) const
+    {
+        std::weak_ptr<const int> isAlive = lifetime;
+        return [isAlive, fn] {
+            if (!isAlive.expired()) fn();
+        };
+    }
+
+    float Refresh(int playlistId);
+    void RefreshAll();
+    void OnChanged();
+    void Poll(uint64_t generation, int attempt);
+    bool TrySettle(bool isUpdated);
+    void Publish(bool isSettled);
+
+    IGameHost& host;
+    std::array<float, PLAYLIST_POLICY_COUNT> cache;
+
+    int playlist = -1;
+    float before = -1.0f;
+    float after = -1.0f;
+    // polls in a row that read after
+    int unchangedReads = 0;
+    MmrPromise pending;
+
+    // bumped for every match, polls from an older one stop
+    uint64_t generation = 0;
+
+    // set from Start until Stop
+    std::shared_ptr<const int> lifetime;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// 4v4 is the biggest lobby that has a scoreboard
+#define MAX_STAT_PLAYERS 8
+
+// One player's scoreboard at match end, as the game counts it.
+struct PlayerStatRow {
+    uintptr_t key = 0;          // PlayerRef key
+    uint16_t playerId = 0;      // index into the match PlayerTable, set by the core
+    uint8_t team = 0;
+    bool isLocal = false;
+    bool isMvp = false;
+
+    int32_t score = 0;
+    int32_t goals = 0;
+    int32_t ownGoals = 0;
+    int32_t assists = 0;
+    int32_t saves = 0;
+    int32_t shots = 0;
+    int32_t demolishes = 0;
+    int32_t ballTouches = 0;
+    int32_t carTouches = 0;
+    int32_t boostPickups = 0;
+};
+
+struct TeamStatRow {
+    int32_t players = 0;
+    int32_t score = 0;
+    int32_t goals = 0;
+    int32_t assists = 0;
+    int32_t saves = 0;
+    int32_t shots = 0;
+    int32_t demolishes = 0;
+    int32_t ballTouches = 0;
+    int32_t boostPickups = 0;
+};
+
+// Every player's row plus team totals, filled in one pass at match end.
+struct PlayerStatTable {
+    std::array<PlayerStatRow, MAX_STAT_PLAYERS> rows;
+    size_t count = 0;
+    std::array<TeamStatRow, 2> teams;
+
+    void Clear()
+    {
+        count = 0;
+        teams = {};
+    }
+
+    void AddToTeam(const PlayerStatRow& row)
+    {
+        if (row.team > 1) return;
+
+        TeamStatRow& team = teams[row.team];
+        team.players++;
+        team.score += row.score;
+        team.goals += row.goals;
+        team.assists += row.assists;
+        team.saves += row.saves;
+        team.shots += row.shots;
+        team.demolishes += row.demolishes;
+        team.ballTouches += row.ballTouches;
+        team.boostPickups += row.boostPickups;
+    }
+
+    const PlayerStatRow* begin() const { return rows.data(); }
+    const PlayerStatRow* end() const { return rows.data() + count; }
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Per-match table of players seen in events, keyed by PRI address. Names
+// are resolved once per player, events refer to players by index.
+class PlayerTable
+{
+public:
+    static constexpr uint16_t NONE = 0xFFFF;
+
+    explicit PlayerTable(size_t expectedPlayers = 8)
+    {
+        keys.reserve(expectedPlayers);
+        names.reserve(expectedPlayers);
+    }
+
+    // resolveName is only called the first time a key is seen
+    template <typename NameFn>
+    uint16_t Intern(uintptr_t key, NameFn&& resolveName)
+    {
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (keys[i] == key) return static_cast<uint16_t>(i);
+        }
+        keys.push_back(key);
+        names.push_back(resolveName());
+        return static_cast<uint16_t>(names.size() - 1);
+    }
+
+    const std::string& Name(uint16_t id) const { return names[id]; }
+    const std::vector<std::string>& Names() const { return names; }
+
+    void Clear()
+    {
+        keys.clear();
+        names.clear();
+    }
+
+private:
+    std::vector<uintptr_t> keys;
+    std::vector<std::string> names;
+};
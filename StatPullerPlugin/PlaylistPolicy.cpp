@@ -0,0 +1,43 @@
+#include "pch.h"
+#include "PlaylistPolicy.h"
+
+static const char* const CAPTURE_LEVEL_NAMES[] = { "off", "basic", "full" };
+
+bool ParseCaptureLevel(const std::string& name, CaptureLevel& level)
+{
+	for (size_t i = 0; i < sizeof(CAPTURE_LEVEL_NAMES) / sizeof(CAPTURE_LEVEL_NAMES[0]); i++)
+	{
+		if (name == CAPTURE_LEVEL_NAMES[i]) {
+			level = static_cast<CaptureLevel>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* CaptureLevelName(CaptureLevel level)
+{
+	return CAPTURE_LEVEL_NAMES[static_cast<size_t>(level)];
+}
+
+PlaylistCapture::PlaylistCapture()
+{
+	for (size_t i = 0; i < PLAYLIST_POLICY_COUNT; i++) {
+		levels[i] = PLAYLIST_POLICIES[i].capture;
+	}
+}
+
+CaptureLevel PlaylistCapture::Level(int playlistId) const
+{
+	const int index = FindPlaylistPolicy(playlistId);
+	return index < 0 ? CaptureLevel::Off : levels[index];
+}
+
+bool PlaylistCapture::SetLevel(int playlistId, CaptureLevel level)
+{
+	const int index = FindPlaylistPolicy(playlistId);
+	if (index < 0) return false;
+
+	levels[index] = level;
+	return true;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// How much of a match is captured.
+enum class CaptureLevel : uint8_t {
+    Off,        // ignored
+    Basic,      // match file, goals and clips, events, player stats, replay
+    Full,       // also in-match sampling and the replay archive
+};
+
+bool ParseCaptureLevel(const std::string& name, CaptureLevel& level);
+const char* CaptureLevelName(CaptureLevel level);
+
+struct PlaylistPolicy {
+    int id;
+    const char* name;           // cvar suffix, statpuller_capture_<name>
+    uint8_t teamSize;
+    int16_t clockLength;        // seconds of regulation
+    CaptureLevel capture;       // default, the cvar can change it
+};
+
+// Every playlist the plugin knows. Anything not listed is never captured.
+constexpr PlaylistPolicy PLAYLIST_POLICIES[] = {
+    { 1, "casual_duel", 1, 300, CaptureLevel::Off },
+    { 2, "casual_doubles", 2, 300, CaptureLevel::Off },
+    { 3, "casual_standard", 3, 300, CaptureLevel::Off },
+    { 4, "casual_chaos", 4, 300, CaptureLevel::Off },
+    { 10, "ranked_duel", 1, 300, CaptureLevel::Basic },
+    { 11, "ranked_doubles", 2, 300, CaptureLevel::Basic },
+    { 13, "ranked_standard", 3, 300, CaptureLevel::Basic },
+    { 15, "snow_day", 3, 300, CaptureLevel::Off },
+    { 17, "hoops", 2, 300, CaptureLevel::Off },
+    { 18, "rumble", 3, 300, CaptureLevel::Off },
+    { 22, "custom_tournament", 3, 300, CaptureLevel::Basic },
+    { 23, "dropshot", 3, 300, CaptureLevel::Off },
+    { 27, "ranked_hoops", 2, 300, CaptureLevel::Basic },
+    { 28, "ranked_rumble", 3, 300, CaptureLevel::Basic },
+    { 29, "ranked_dropshot", 3, 300, CaptureLevel::Basic },
+    { 30, "ranked_snow_day", 3, 300, CaptureLevel::Basic },
+    { 34, "tournament", 3, 300, CaptureLevel::Basic },
+};
+
+#define PLAYLIST_POLICY_COUNT (sizeof(PLAYLIST_POLICIES) / sizeof(PLAYLIST_POLICIES[0]))
+#define DEFAULT_CLOCK_LENGTH 300
+
+// index into PLAYLIST_POLICIES, -1 if the playlist isn't listed
+constexpr int FindPlaylistPolicy(int playlistId)
+{
+    for (size_t i = 0; i < PLAYLIST_POLICY_COUNT; i++) {
+        if (PLAYLIST_POLICIES[i].id == playlistId) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+constexpr bool HasUniquePlaylistIds()
+{
+    for (size_t i = 0; i < PLAYLIST_POLICY_COUNT; i++) {
+        if (FindPlaylistPolicy(PLAYLIST_POLICIES[i].id) != static_cast<int>(i)) return false;
+    }
+    return true;
+}
+
+static_assert(HasUniquePlaylistIds(), "PLAYLIST_POLICIES lists a playlist twice");
+
+constexpr int PlaylistClockLength(int playlistId)
+{
+    return FindPlaylistPolicy(playlistId) < 0 ? DEFAULT_CLOCK_LENGTH : PLAYLIST_POLICIES[FindPlaylistPolicy(playlistId)].clockLength;
+}
+
+// The table's capture levels with the user's overrides applied. Read and
+// written on the game thread.
+class PlaylistCapture
+{
+public:
+    PlaylistCapture();
+
+    CaptureLevel Level(int playlistId) const;
+
+    // false if the playlist isn't in the table
+    bool SetLevel(int playlistId, CaptureLevel level);
+
+private:
+    std::array<CaptureLevel, PLAYLIST_POLICY_COUNT> levels;
+};
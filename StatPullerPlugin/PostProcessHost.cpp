@@ -0,0 +1,387 @@
+#include "pch.h"
+#include "PostProcessHost.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+
+#define WORKER_SCRIPT_NAME "postprocess_worker.py"
+
+// room for a few hundred requests while the worker is busy running one
+#define POST_PROCESS_PIPE_BYTES (64 * 1024)
+
+PostProcessHost::PostProcessHost(std::string scriptDirectory, LogFn log, std::string command)
+	: scriptDirectory(std::move(scriptDirectory)), command(std::move(command)), log(std::move(log))
+{
+}
+
+PostProcessHost::~PostProcessHost()
+{
+	Stop();
+}
+
+void PostProcessHost::Start()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (thread.joinable()) return;
+
+	isRunning = true;
+	isWriterDone = false;
+	isGivenUp = false;
+	launchFailures = 0;
+	thread = std::thread(&PostProcessHost::Run, this);
+}
+
+void PostProcessHost::Stop()
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (!thread.joinable()) return;
+
+		isRunning = false;
+		wake.notify_all();
+
+		// the writer drains the queue first, unless the worker stops reading
+		while (!isWriterDone) {
+			wake.wait_for(lock, std::chrono::milliseconds(100));
+			KillIfHung(std::min(writeTimeout, std::chrono::milliseconds(POST_PROCESS_STOP_WAIT_MS)));
+		}
+	}
+	thread.join();
+}
+
+bool PostProcessHost::Send(const std::string& scriptFileName, const json& args)
+{
+	json request;
+	request["script"] = scriptFileName;
+	request["args"] = args;
+	const std::string payload = request.dump();
+
+	const uint32_t size = static_cast<uint32_t>(payload.size());
+	const char header[4] = {
+		static_cast<char>(size),
+		static_cast<char>(size >> 8),
+		static_cast<char>(size >> 16),
+		static_cast<char>(size >> 24),
+	};
+	std::string frame(header, sizeof(header));
+	frame += payload;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!isRunning || isGivenUp) return false;
+
+	KillIfHung(writeTimeout);
+	if (frames.size() >= POST_PROCESS_QUEUE_FRAMES) return false;
+
+	frames.push_back(std::move(frame));
+	wake.notify_all();
+	return true;
+}
+
+uint32_t PostProcessHost::Launches() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return launches;
+}
+
+void PostProcessHost::Run()
+{
+#ifndef _WIN32
+	// a write to a dead worker fails with EPIPE instead of killing the process
+	sigset_t pipeSignal;
+	sigemptyset(&pipeSignal);
+	sigaddset(&pipeSignal, SIGPIPE);
+	pthread_sigmask(SIG_BLOCK, &pipeSignal, nullptr);
+#endif
+
+	// warm the interpreter up before the first goal
+	Launch();
+
+	for (;;)
+	{
+		std::string frame;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return !frames.empty() || !isRunning; });
+
+			if (frames.empty()) break;
+
+			frame = std::move(frames.front());
+			frames.pop_front();
+		}
+
+		bool isSent = false;
+		for (int attempt = 0; attempt < 2 && !isSent; attempt++)
+		{
+			if (!IsAlive())
+			{
+				Close();
+				if (launchFailures >= MAX_LAUNCH_FAILURES || !Launch()) break;
+			}
+
+			if (WriteFrame(frame)) {
+				launchFailures = 0;
+				isSent = true;
+			}
+			else {
+				log("StatPuller: Post-process worker stopped responding, restarting.");
+				Close();
+				launchFailures++;
+			}
+		}
+
+		if (!isSent && launchFailures >= MAX_LAUNCH_FAILURES)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			log("StatPuller: Post-process worker keeps failing, dropped " + std::to_string(frames.size() + 1) + " script requests.");
+			isGivenUp = true;
+			frames.clear();
+		}
+	}
+
+	Close();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	isWriterDone = true;
+	wake.notify_all();
+}
+
+void PostProcessHost::KillIfHung(std::chrono::milliseconds timeout)
+{
+	if (!isWriting || std::chrono::steady_clock::now() - writeStarted < timeout) return;
+
+#ifdef _WIN32
+	if (process) TerminateProcess(process, 1);
+#else
+	if (process > 0) kill(process, SIGKILL);
+#endif
+	// once is enough, the write fails as soon as the process is gone
+	isWriting = false;
+	log("StatPuller: Post-process worker stopped reading requests, killing it.");
+}
+
+#ifdef _WIN32
+
+bool PostProcessHost::Launch()
+{
+	SECURITY_ATTRIBUTES sa = {};
+	sa.nLength = sizeof(sa);
+	sa.bInheritHandle = TRUE;
+
+	HANDLE readEnd = nullptr;
+	HANDLE writeEnd = nullptr;
+	if (!CreatePipe(&readEnd, &writeEnd, &sa, POST_PROCESS_PIPE_BYTES)) {
+		log("StatPuller: Could not create post-process pipe.");
+		return false;
+	}
+	// only the child's end of the pipe may be inherited
+	SetHandleInformation(writeEnd, HANDLE_FLAG_INHERIT, 0);
+
+	STARTUPINFOW si = {};
+	si.cb = sizeof(si);
+	si.dwFlags = STARTF_USESTDHANDLES;
+	si.hStdInput = readEnd;
+
+	std::string commandLine = command.empty() ? "pythonw.exe \"" + scriptDirectory + WORKER_SCRIPT_NAME + "\"" : command;
+	std::wstring wCommandLine(commandLine.begin(), commandLine.end());
+	std::wstring wDirectory(scriptDirectory.begin(), scriptDirectory.end());
+
+	PROCESS_INFORMATION pi = {};
+	BOOL launched = CreateProcessW(
+		nullptr,
+		&wCommandLine[0],
+		nullptr,
+		nullptr,
+		TRUE,
+		CREATE_NO_WINDOW,
+		nullptr,
+		wDirectory.c_str(),
+		&si,
+		&pi
+	);
+
+	CloseHandle(readEnd);
+
+	if (!launched) {
+		CloseHandle(writeEnd);
+		launchFailures++;
+		log("StatPuller: Could not launch post-process worker.");
+		return false;
+	}
+
+	CloseHandle(pi.hThread);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		process = pi.hProcess;
+		launches++;
+	}
+	stdinWrite = writeEnd;
+
+	log("StatPuller: Post-process worker started.");
+	return true;
+}
+
+bool PostProcessHost::IsAlive()
+{
+	return process != nullptr && WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+}
+
+bool PostProcessHost::WriteFrame(const std::string& frame)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		writeStarted = std::chrono::steady_clock::now();
+		isWriting = true;
+	}
+
+	const char* data = frame.data();
+	DWORD remaining = static_cast<DWORD>(frame.size());
+	bool isWritten = true;
+	while (remaining > 0)
+	{
+		DWORD written = 0;
+		if (!WriteFile(stdinWrite, data, remaining, &written, nullptr)) {
+			isWritten = false;
+			break;
+		}
+		data += written;
+		remaining -= written;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	isWriting = false;
+	return isWritten;
+}
+
+void PostProcessHost::Close()
+{
+	if (stdinWrite) {
+		CloseHandle(stdinWrite);
+		stdinWrite = nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (process) {
+		CloseHandle(process);
+		process = nullptr;
+	}
+}
+
+#else
+
+bool PostProcessHost::Launch()
+{
+	int fds[2];
+	if (pipe(fds) != 0) {
+		log("StatPuller: Could not create post-process pipe.");
+		return false;
+	}
+	// only the child's end of the pipe may be inherited
+	fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+	// built before forking, the child may only make async-signal-safe calls
+	const std::string commandLine = command.empty() ? "python3 \"" + scriptDirectory + WORKER_SCRIPT_NAME + "\"" : command;
+
+	const pid_t pid = fork();
+	if (pid == 0)
+	{
+		dup2(fds[0], STDIN_FILENO);
+		close(fds[0]);
+		close(fds[1]);
+		if (!scriptDirectory.empty() && chdir(scriptDirectory.c_str()) != 0) _exit(127);
+		execl("/bin/sh", "sh", "-c", commandLine.c_str(), static_cast<char*>(nullptr));
+		_exit(127);
+	}
+
+	close(fds[0]);
+
+	if (pid < 0) {
+		close(fds[1]);
+		launchFailures++;
+		log("StatPuller: Could not launch post-process worker.");
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		process = pid;
+		launches++;
+	}
+	stdinWrite = fds[1];
+
+	log("StatPuller: Post-process worker started.");
+	return true;
+}
+
+bool PostProcessHost::IsAlive()
+{
+	if (process <= 0) return false;
+
+	int status = 0;
+	if (waitpid(process, &status, WNOHANG) == 0) return true;
+
+	// reaped, the pid may be reused from here on
+	std::lock_guard<std::mutex> lock(mutex);
+	process = -1;
+	return false;
+}
+
+bool PostProcessHost::WriteFrame(const std::string& frame)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		writeStarted = std::chrono::steady_clock::now();
+		isWriting = true;
+	}
+
+	const char* data = frame.data();
+	size_t remaining = frame.size();
+	bool isWritten = true;
+	while (remaining > 0)
+	{
+		const ssize_t written = write(stdinWrite, data, remaining);
+		if (written < 0)
+		{
+			if (errno == EINTR) continue;
+			isWritten = false;
+			break;
+		}
+		data += written;
+		remaining -= static_cast<size_t>(written);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	isWriting = false;
+	return isWritten;
+}
+
+void PostProcessHost::Close()
+{
+	if (stdinWrite >= 0) {
+		close(stdinWrite);
+		stdinWrite = -1;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (process > 0) {
+		exiting.push_back(process);
+		process = -1;
+	}
+
+	// reap the workers that have finished by now
+	int status = 0;
+	exiting.erase(std::remove_if(exiting.begin(), exiting.end(), [&status](int pid) {
+		return waitpid(pid, &status, WNOHANG) != 0;
+	}), exiting.end());
+}
+
+#endif
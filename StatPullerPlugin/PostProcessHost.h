@@ -0,0 +1,103 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "json.hpp"
+using json = nlohmann::json;
+
+// requests waiting for the writer thread, past this Send gives up
+#define POST_PROCESS_QUEUE_FRAMES 64
+// a worker that hasn't taken a frame off its stdin for this long is hung
+#define POST_PROCESS_WRITE_TIMEOUT_MS 30000
+// how long Stop waits on a write before killing the worker
+#define POST_PROCESS_STOP_WAIT_MS 2000
+
+// Keeps one pythonw.exe running postprocess_worker.py for the whole session
+// and sends it script requests over its stdin pipe, so clip.py and
+// build_summary.py don't each pay for a cold interpreter start.
+//
+// Each request is framed as a 4 byte little-endian length followed by a
+// UTF-8 JSON body: {"script": "clip.py", "args": {...}}.
+//
+// Send only queues the frame. A writer thread launches the worker and
+// writes to the pipe, so a worker that stops reading fills the queue
+// instead of blocking the game thread. Once a write has been stuck for
+// the write timeout the worker is killed and relaunched.
+class PostProcessHost
+{
+public:
+    using LogFn = std::function<void(std::string)>;
+
+    // command is the worker's command line, run in scriptDirectory; empty
+    // runs postprocess_worker.py with pythonw.exe (python3 off Windows)
+    PostProcessHost(std::string scriptDirectory, LogFn log, std::string command = "");
+    ~PostProcessHost();
+
+    void Start();
+
+    // Writes what is queued, as long as the worker keeps reading, then
+    // closes its stdin. The worker exits once it has run what it read.
+    // A write stuck for POST_PROCESS_STOP_WAIT_MS kills the worker.
+    void Stop();
+
+    // Returns false if the request can't be queued, because the worker
+    // keeps failing to launch or has fallen too far behind, so the caller
+    // can fall back to a one-off launch. Never waits on the worker.
+    bool Send(const std::string& scriptFileName, const json& args = json::object());
+
+    void SetWriteTimeout(std::chrono::milliseconds timeout) { writeTimeout = timeout; }
+
+    // worker processes started so far, relaunches included
+    uint32_t Launches() const;
+
+private:
+    void Run();
+    bool Launch();
+    bool IsAlive();
+    bool WriteFrame(const std::string& frame);
+    // ends a worker stuck in a write for longer than timeout, so the
+    // write fails; mutex held
+    void KillIfHung(std::chrono::milliseconds timeout);
+    void Close();
+
+    const std::string scriptDirectory;
+    const std::string command;
+    LogFn log;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::string> frames;
+    std::thread thread;
+    bool isRunning = false;
+    bool isWriterDone = false;
+
+    // set by the writer thread under mutex, read by Send and Stop
+    std::chrono::steady_clock::time_point writeStarted;
+    bool isWriting = false;
+    bool isGivenUp = false;
+    uint32_t launches = 0;
+
+    std::chrono::milliseconds writeTimeout{ POST_PROCESS_WRITE_TIMEOUT_MS };
+
+#ifdef _WIN32
+    void* process = nullptr;
+    void* stdinWrite = nullptr;
+#else
+    int process = -1;
+    int stdinWrite = -1;
+    // workers whose stdin is closed but that haven't exited yet
+    std::vector<int> exiting;
+#endif
+
+    // stop relaunching after this many launches in a row die before a send
+    static constexpr int MAX_LAUNCH_FAILURES = 3;
+    int launchFailures = 0;
+};
@@ -0,0 +1,372 @@
+#include "pch.h"
+#include "ReplayArchive.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <unordered_set>
+
+#ifdef STATPULLER_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#define REPLAY_INDEX_MAGIC 0x49525053u     // "SPRI"
+#define REPLAY_INDEX_VERSION 1u
+
+#define INDEX_HEADER_SIZE 16
+#define INDEX_ENTRY_SIZE 64
+
+#define REPLAY_ZSTD_LEVEL 3
+
+static void PutU32(std::vector<uint8_t>& out, uint32_t value)
+{
+	for (int i = 0; i < 4; i++) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+static void PutU64(std::vector<uint8_t>& out, uint64_t value)
+{
+	for (int i = 0; i < 8; i++) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+static uint32_t GetU32(const uint8_t* p)
+{
+	uint32_t value = 0;
+	for (int i = 3; i >= 0; i--) value = (value << 8) | p[i];
+	return value;
+}
+
+static uint64_t GetU64(const uint8_t* p)
+{
+	uint64_t value = 0;
+	for (int i = 7; i >= 0; i--) value = (value << 8) | p[i];
+	return value;
+}
+
+static bool ReadFile(const std::string& path, std::vector<uint8_t>& out)
+{
+	std::ifstream file(path, std::ifstream::binary | std::ifstream::ate);
+	if (!file.is_open()) return false;
+
+	out.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(out.data()), out.size());
+	return file.good();
+}
+
+// temp file and rename, so a stored replay is either complete or missing
+static bool WriteFileAtomic(const std::string& path, const uint8_t* data, size_t size)
+{
+	const std::string tempPath = path + ".tmp";
+
+	std::ofstream file(tempPath, std::ofstream::binary | std::ofstream::trunc);
+	file.write(reinterpret_cast<const char*>(data), size);
+	file.flush();
+	const bool isWritten = file.good();
+	file.close();
+
+	std::error_code ec;
+	if (!isWritten || file.fail()) {
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+
+	std::filesystem::rename(tempPath, path, ec);
+	if (ec) {
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+	return true;
+}
+
+static ReplayArchiveEntry ParseEntry(const uint8_t* p)
+{
+	ReplayArchiveEntry entry;
+	entry.matchId = GetU64(p);
+	entry.startWallClockMs = static_cast<int64_t>(GetU64(p + 8));
+	entry.contentHash = GetU64(p + 16);
+	entry.replayBytes = GetU64(p + 24);
+	entry.storedBytes = GetU64(p + 32);
+	entry.playlist = static_cast<int32_t>(GetU32(p + 40));
+	entry.mmrBefore = static_cast<int32_t>(GetU32(p + 44));
+	entry.mmrAfter = static_cast<int32_t>(GetU32(p + 48));
+	entry.compression = static_cast<ReplayCompression>(p[52]);
+	entry.slot = p[53];
+	return entry;
+}
+
+static void PutEntry(std::vector<uint8_t>& out, const ReplayArchiveEntry& entry)
+{
+	const size_t start = out.size();
+	PutU64(out, entry.matchId);
+	PutU64(out, static_cast<uint64_t>(entry.startWallClockMs));
+	PutU64(out, entry.contentHash);
+	PutU64(out, entry.replayBytes);
+	PutU64(out, entry.storedBytes);
+	PutU32(out, static_cast<uint32_t>(entry.playlist));
+	PutU32(out, static_cast<uint32_t>(entry.mmrBefore));
+	PutU32(out, static_cast<uint32_t>(entry.mmrAfter));
+	out.push_back(static_cast<uint8_t>(entry.compression));
+	out.push_back(entry.slot);
+	out.resize(start + INDEX_ENTRY_SIZE, 0);
+}
+
+static void PutIndexHeader(std::vector<uint8_t>& out)
+{
+	PutU32(out, REPLAY_INDEX_MAGIC);
+	PutU32(out, REPLAY_INDEX_VERSION);
+	PutU64(out, 0);
+}
+
+bool ReplayArchive::Open(const std::string& archiveDirectory)
+{
+	isOpen = false;
+	entries.clear();
+	byMatch.clear();
+	byHash.clear();
+
+	directory = archiveDirectory;
+	indexPath = directory + "index.spri";
+
+	std::error_code ec;
+	std::filesystem::create_directories(directory, ec);
+
+	std::vector<uint8_t> index;
+	if (!std::filesystem::exists(indexPath, ec) || !ReadFile(indexPath, index) || index.size() < INDEX_HEADER_SIZE)
+	{
+		std::vector<uint8_t> header;
+		PutIndexHeader(header);
+
+		std::ofstream file(indexPath, std::ofstream::binary | std::ofstream::trunc);
+		file.write(reinterpret_cast<const char*>(header.data()), header.size());
+		isOpen = file.good();
+		return isOpen;
+	}
+
+	if (GetU32(index.data()) != REPLAY_INDEX_MAGIC) return false;
+
+	const size_t count = (index.size() - INDEX_HEADER_SIZE) / INDEX_ENTRY_SIZE;
+	const size_t intactSize = INDEX_HEADER_SIZE + count * INDEX_ENTRY_SIZE;
+
+	// drop a half-written entry so appends stay aligned
+	if (intactSize != index.size())
+	{
+		std::filesystem::resize_file(indexPath, intactSize, ec);
+		if (ec) return false;
+	}
+
+	entries.reserve(count);
+	for (size_t i = 0; i < count; i++) {
+		entries.push_back(ParseEntry(index.data() + INDEX_HEADER_SIZE + i * INDEX_ENTRY_SIZE));
+	}
+	IndexEntries();
+
+	isOpen = true;
+	return true;
+}
+
+bool ReplayArchive::Add(const std::string& replayPath, ReplayArchiveEntry& entry)
+{
+	if (!isOpen) return false;
+
+	std::vector<uint8_t> replay;
+	if (!ReadFile(replayPath, replay) || replay.empty()) return false;
+
+	entry.contentHash = HashContent(replay);
+	entry.replayBytes = replay.size();
+
+	// Same replay archived before (e.g. exported twice), only index it
+	// again. The hash and size only find candidates, the bytes decide; a
+	// different replay never shares or overwrites a stored one.
+	std::unordered_set<uint8_t> usedSlots;
+	auto candidates = byHash.equal_range(entry.contentHash);
+	for (auto it = candidates.first; it != candidates.second; ++it)
+	{
+		const ReplayArchiveEntry& existing = entries[it->second];
+		if (existing.replayBytes != replay.size() || !usedSlots.insert(existing.slot).second) continue;
+
+		std::vector<uint8_t> stored;
+		if (ReadReplay(existing, stored) && stored == replay)
+		{
+			entry.storedBytes = existing.storedBytes;
+			entry.compression = existing.compression;
+			entry.slot = existing.slot;
+			return AppendEntry(entry);
+		}
+	}
+
+	entry.slot = 0;
+	while (usedSlots.count(entry.slot))
+	{
+		if (entry.slot == 0xFF) return false;
+		entry.slot++;
+	}
+
+#ifdef STATPULLER_WITH_ZSTD
+	std::vector<uint8_t> compressed(ZSTD_compressBound(replay.size()));
+	const size_t compressedSize = ZSTD_compress(compressed.data(), compressed.size(), replay.data(), replay.size(), REPLAY_ZSTD_LEVEL);
+
+	if (!ZSTD_isError(compressedSize) && compressedSize < replay.size())
+	{
+		compressed.resize(compressedSize);
+		entry.compression = ReplayCompression::Zstd;
+		entry.storedBytes = compressedSize;
+		if (!WriteFileAtomic(PathFor(entry), compressed.data(), compressed.size())) return false;
+		return AppendEntry(entry);
+	}
+#endif
+
+	entry.compression = ReplayCompression::None;
+	entry.storedBytes = replay.size();
+	if (!WriteFileAtomic(PathFor(entry), replay.data(), replay.size())) return false;
+	return AppendEntry(entry);
+}
+
+bool ReplayArchive::AppendEntry(const ReplayArchiveEntry& entry)
+{
+	std::vector<uint8_t> record;
+	record.reserve(INDEX_ENTRY_SIZE);
+	PutEntry(record, entry);
+
+	std::ofstream file(indexPath, std::ofstream::binary | std::ofstream::app);
+	file.write(reinterpret_cast<const char*>(record.data()), record.size());
+	file.flush();
+	if (!file.good()) return false;
+
+	entries.push_back(entry);
+	byMatch[entry.matchId] = entries.size() - 1;
+	byHash.emplace(entry.contentHash, entries.size() - 1);
+	return true;
+}
+
+void ReplayArchive::IndexEntries()
+{
+	byMatch.clear();
+	byHash.clear();
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		byMatch[entries[i].matchId] = i;
+		byHash.emplace(entries[i].contentHash, i);
+	}
+}
+
+size_t ReplayArchive::Prune(const ReplayRetention& policy, int64_t nowMs)
+{
+	if (!isOpen) return 0;
+
+	// entries sharing each stored replay
+	std::unordered_map<std::string, size_t> references;
+	for (const ReplayArchiveEntry& entry : entries) {
+		references[PathFor(entry)]++;
+	}
+
+	uint64_t storedBytes = StoredBytes();
+	std::vector<std::string> unused;
+	size_t dropped = 0;
+	for (; dropped < entries.size(); dropped++)
+	{
+		const ReplayArchiveEntry& entry = entries[dropped];
+		// a match without a start time is only dropped for space
+		const bool isTooOld = policy.maxAgeMs > 0 && entry.startWallClockMs > 0 && nowMs - entry.startWallClockMs > policy.maxAgeMs;
+		const bool isTooBig = policy.maxStoredBytes > 0 && storedBytes > policy.maxStoredBytes;
+		if (!isTooOld && !isTooBig) break;
+
+		const std::string path = PathFor(entry);
+		if (--references[path] == 0)
+		{
+			storedBytes -= entry.storedBytes;
+			unused.push_back(path);
+		}
+	}
+	if (dropped == 0) return 0;
+
+	std::vector<uint8_t> index;
+	index.reserve(INDEX_HEADER_SIZE + (entries.size() - dropped) * INDEX_ENTRY_SIZE);
+	PutIndexHeader(index);
+	for (size_t i = dropped; i < entries.size(); i++) {
+		PutEntry(index, entries[i]);
+	}
+	if (!WriteFileAtomic(indexPath, index.data(), index.size())) return 0;
+
+	entries.erase(entries.begin(), entries.begin() + dropped);
+	IndexEntries();
+
+	// only once no entry points at them, a crash before this leaves files
+	// nothing refers to rather than entries without a file
+	std::error_code ec;
+	for (const std::string& path : unused) {
+		std::filesystem::remove(path, ec);
+	}
+	return dropped;
+}
+
+uint64_t ReplayArchive::StoredBytes() const
+{
+	std::unordered_set<std::string> counted;
+	uint64_t bytes = 0;
+	for (const ReplayArchiveEntry& entry : entries)
+	{
+		if (counted.insert(PathFor(entry)).second) bytes += entry.storedBytes;
+	}
+	return bytes;
+}
+
+const ReplayArchiveEntry* ReplayArchive::FindMatch(uint64_t matchId) const
+{
+	auto it = byMatch.find(matchId);
+	return it == byMatch.end() ? nullptr : &entries[it->second];
+}
+
+std::vector<const ReplayArchiveEntry*> ReplayArchive::FindStartedBetween(int64_t fromMs, int64_t toMs) const
+{
+	std::vector<const ReplayArchiveEntry*> found;
+	for (const ReplayArchiveEntry& entry : entries)
+	{
+		if (entry.startWallClockMs >= fromMs && entry.startWallClockMs < toMs) {
+			found.push_back(&entry);
+		}
+	}
+	return found;
+}
+
+std::string ReplayArchive::PathFor(const ReplayArchiveEntry& entry) const
+{
+	char name[64];
+	int length = snprintf(name, sizeof(name), "%016llx-%llu", static_cast<unsigned long long>(entry.contentHash),
+		static_cast<unsigned long long>(entry.replayBytes));
+	if (entry.slot != 0) {
+		length += snprintf(name + length, sizeof(name) - length, "-%u", static_cast<unsigned>(entry.slot));
+	}
+	snprintf(name + length, sizeof(name) - length, ".replay%s", entry.compression == ReplayCompression::Zstd ? ".zst" : "");
+	return directory + name;
+}
+
+bool ReplayArchive::ReadReplay(const ReplayArchiveEntry& entry, std::vector<uint8_t>& out) const
+{
+	std::vector<uint8_t> stored;
+	if (!ReadFile(PathFor(entry), stored)) return false;
+
+	if (entry.compression == ReplayCompression::None)
+	{
+		out = std::move(stored);
+		return true;
+	}
+
+#ifdef STATPULLER_WITH_ZSTD
+	out.resize(static_cast<size_t>(entry.replayBytes));
+	const size_t size = ZSTD_decompress(out.data(), out.size(), stored.data(), stored.size());
+	return !ZSTD_isError(size) && size == out.size();
+#else
+	return false;
+#endif
+}
+
+// FNV-1a, 64 bit
+uint64_t ReplayArchive::HashContent(const std::vector<uint8_t>& data)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (uint8_t byte : data) {
+		hash ^= byte;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Every exported replay, stored once per distinct content under
+// replays/<hash>-<size>[-<slot>].replay[.zst], plus an index so tools can
+// find a match's replay without listing the directory. A replay is only
+// shared with a stored one whose bytes are the same; one that merely has
+// the same hash and size gets the next free slot instead.
+//
+// replays/index.spri, all integers little-endian:
+//   header   "SPRI" u32 version u64 reserved
+//   entries  64 bytes each, in the order matches were archived:
+//            u64 match id, i64 match start (ms since the Unix epoch),
+//            u64 content hash, u64 replay size, u64 stored size,
+//            i32 playlist, i32 MMR before, i32 MMR after,
+//            u8 compression, u8 slot, 10 bytes reserved
+//
+// Entries are fixed size, so a crash mid-append leaves at most one partial
+// entry at the end, which is dropped on the next Open. Prune rewrites the
+// index without the entries it drops, then deletes their replays.
+//
+// Compression needs zstd, built with STATPULLER_WITH_ZSTD (the vcxproj gets
+// it from vcpkg, CMake when it finds it). Without it replays are stored as
+// is and marked uncompressed.
+
+enum class ReplayCompression : uint8_t {
+    None = 0,
+    Zstd = 1,
+};
+
+struct ReplayArchiveEntry {
+    uint64_t matchId = 0;
+    int64_t startWallClockMs = 0;
+    uint64_t contentHash = 0;
+    uint64_t replayBytes = 0;
+    uint64_t storedBytes = 0;
+    int32_t playlist = -1;
+    int32_t mmrBefore = -1;
+    int32_t mmrAfter = -1;
+    ReplayCompression compression = ReplayCompression::None;
+    uint8_t slot = 0;                       // tells apart hash collisions
+
+    int32_t MmrDelta() const { return mmrBefore < 0 || mmrAfter < 0 ? 0 : mmrAfter - mmrBefore; }
+};
+
+// what the plugin keeps unless told otherwise
+#define REPLAY_ARCHIVE_MAX_MB 4096
+#define REPLAY_ARCHIVE_MAX_DAYS 90
+
+// limits for Prune, 0 for none
+struct ReplayRetention {
+    uint64_t maxStoredBytes = 0;            // all stored replays together
+    int64_t maxAgeMs = 0;                   // since the match started
+};
+
+class ReplayArchive
+{
+public:
+    // directory has a trailing separator, it's created if missing
+    bool Open(const std::string& directory);
+    bool IsOpen() const { return isOpen; }
+
+    // Stores the replay at replayPath unless a replay with the same content
+    // is already stored, then indexes it under entry's match. Fills in the
+    // hash, size, compression and slot fields of entry.
+    bool Add(const std::string& replayPath, ReplayArchiveEntry& entry);
+
+    const std::vector<ReplayArchiveEntry>& Entries() const { return entries; }
+
+    // nullptr if the match has no archived replay
+    const ReplayArchiveEntry* FindMatch(uint64_t matchId) const;
+
+    // matches that started in [fromMs, toMs)
+    std::vector<const ReplayArchiveEntry*> FindStartedBetween(int64_t fromMs, int64_t toMs) const;
+
+    std::string PathFor(const ReplayArchiveEntry& entry) const;
+
+    // the original replay file, decompressed if needed
+    bool ReadReplay(const ReplayArchiveEntry& entry, std::vector<uint8_t>& out) const;
+
+    // Drops entries oldest first, in the order they were archived, while
+    // they are older than the policy allows or the stored replays take more
+    // space than it allows. A replay is deleted with the last entry using
+    // it. Returns how many entries were dropped.
+    size_t Prune(const ReplayRetention& policy, int64_t nowMs);
+
+    // bytes on disk for every stored replay, shared ones counted once
+    uint64_t StoredBytes() const;
+
+    static uint64_t HashContent(const std::vector<uint8_t>& data);
+
+private:
+    bool AppendEntry(const ReplayArchiveEntry& entry);
+    void IndexEntries();
+
+    std::string directory;
+    std::string indexPath;
+    bool isOpen = false;
+
+    std::vector<ReplayArchiveEntry> entries;
+    std::unordered_map<uint64_t, size_t> byMatch;
+    // every entry by content hash, several may share a stored replay
+    std::unordered_multimap<uint64_t, size_t> byHash;
+};
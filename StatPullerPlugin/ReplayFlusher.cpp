@@ -0,0 +1,130 @@
+#include "pch.h"
+#include "ReplayFlusher.h"
+
+#include <filesystem>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// pushes the file's contents out of the OS cache
+static bool SyncFile(const std::string& path)
+{
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) return false;
+
+	const bool isFlushed = FlushFileBuffers(handle) != 0;
+	CloseHandle(handle);
+	return isFlushed;
+#else
+	const int fd = open(path.c_str(), O_WRONLY);
+	if (fd < 0) return false;
+
+	const bool isFlushed = fsync(fd) == 0;
+	close(fd);
+	return isFlushed;
+#endif
+}
+
+ReplayFlusher::~ReplayFlusher()
+{
+	Stop();
+}
+
+void ReplayFlusher::Start()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (isRunning) return;
+
+	isRunning = true;
+	thread = std::thread(&ReplayFlusher::Run, this);
+}
+
+void ReplayFlusher::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!isRunning) return;
+		isRunning = false;
+	}
+	wake.notify_one();
+
+	if (thread.joinable()) {
+		thread.join();
+	}
+}
+
+void ReplayFlusher::Flush(WriteReplay write, std::string tempPath, std::string path, ReplayPromise done)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (isRunning)
+		{
+			queue.push_back(Job{ std::move(write), std::move(tempPath), std::move(path), std::move(done) });
+			wake.notify_one();
+			return;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::remove(tempPath, ec);
+	done->set_value(ReplayResult());
+}
+
+void ReplayFlusher::Run()
+{
+	for (;;)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return !queue.empty() || !isRunning; });
+
+			if (queue.empty()) return;
+
+			job = std::move(queue.front());
+			queue.pop_front();
+		}
+
+		if (!job.write(job.tempPath)) {
+			std::error_code ec;
+			std::filesystem::remove(job.tempPath, ec);
+			job.done->set_value(ReplayResult());
+			continue;
+		}
+
+		job.done->set_value(FlushFile(job.tempPath, job.path));
+	}
+}
+
+ReplayResult ReplayFlusher::FlushFile(const std::string& tempPath, const std::string& path)
+{
+	ReplayResult result;
+	result.path = path;
+
+	std::error_code ec;
+	const uintmax_t size = std::filesystem::file_size(tempPath, ec);
+	if (ec || size == 0) {
+		std::filesystem::remove(tempPath, ec);
+		return result;
+	}
+
+	if (!SyncFile(tempPath)) {
+		std::filesystem::remove(tempPath, ec);
+		return result;
+	}
+
+	std::filesystem::rename(tempPath, path, ec);
+	if (ec) {
+		std::filesystem::remove(tempPath, ec);
+		return result;
+	}
+
+	result.isSaved = true;
+	result.bytes = size;
+	return result;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct ReplayResult {
+    bool isSaved = false;
+    std::string path;
+    uint64_t bytes = 0;
+};
+
+using ReplayPromise = std::shared_ptr<std::promise<ReplayResult>>;
+
+// Second half of a replay export. The game thread only takes the replay,
+// this thread writes it to a temp file, flushes it to disk and renames it
+// over the real replay file, then fulfills the promise so whoever waits on
+// the replay knows the file is complete.
+class ReplayFlusher
+{
+public:
+    ReplayFlusher() = default;
+    ~ReplayFlusher();
+
+    void Start();
+
+    // Finishes every queued replay, then joins the thread.
+    void Stop();
+
+    // Writes the replay to tempPath with write, which returns false when it
+    // failed. If the flusher isn't running the replay is dropped and done
+    // fulfilled as not saved.
+    using WriteReplay = std::function<bool(const std::string& tempPath)>;
+    void Flush(WriteReplay write, std::string tempPath, std::string path, ReplayPromise done);
+
+    static ReplayResult FlushFile(const std::string& tempPath, const std::string& path);
+
+private:
+    struct Job {
+        WriteReplay write;
+        std::string tempPath;
+        std::string path;
+        ReplayPromise done;
+    };
+
+    void Run();
+
+    std::deque<Job> queue;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread thread;
+
+    bool isRunning = false;
+};
@@ -0,0 +1,210 @@
+#include "pch.h"
+#include "SampleRing.h"
+
+#include <cmath>
+
+struct SampleFieldInfo {
+	SampleField field;
+	const char* name;
+};
+
+static const SampleFieldInfo SAMPLE_FIELDS[] = {
+	{ SampleScore, "score" },
+	{ SampleBoost, "boost" },
+	{ SampleCarPosition, "position" },
+	{ SampleBallPosition, "ball" },
+	{ SamplePossession, "possession" },
+};
+
+bool ParseSampleFields(const std::string& names, uint32_t& fields)
+{
+	uint32_t parsed = 0;
+
+	size_t start = 0;
+	while (start <= names.size())
+	{
+		size_t end = names.find(',', start);
+		if (end == std::string::npos) end = names.size();
+
+		std::string name = names.substr(start, end - start);
+		name.erase(0, name.find_first_not_of(' '));
+		name.erase(name.find_last_not_of(' ') + 1);
+
+		if (!name.empty() && name != "none")
+		{
+			bool isKnown = false;
+			for (const SampleFieldInfo& info : SAMPLE_FIELDS)
+			{
+				if (name == info.name) {
+					parsed |= info.field;
+					isKnown = true;
+				}
+			}
+			if (!isKnown) return false;
+		}
+		start = end + 1;
+	}
+
+	fields = parsed;
+	return true;
+}
+
+json SampleFieldNames(uint32_t fields)
+{
+	json names = json::array();
+	for (const SampleFieldInfo& info : SAMPLE_FIELDS) {
+		if (fields & info.field) names.push_back(info.name);
+	}
+	return names;
+}
+
+static int16_t ToUnits(float value)
+{
+	const float clamped = std::fmax(-32768.0f, std::fmin(32767.0f, value));
+	return static_cast<int16_t>(std::lround(clamped));
+}
+
+void SampleRing::Reset(uint32_t newFields, size_t newCapacity)
+{
+	fields = newFields;
+	capacity = fields ? newCapacity : 0;
+	next = 0;
+	count = 0;
+	overwritten = 0;
+	slotCount = 0;
+
+	const size_t playerCapacity = capacity * MAX_STAT_PLAYERS;
+	auto columnSize = [this](uint32_t field, size_t size) {
+		return (fields & field) ? size : 0;
+	};
+
+	ticks.assign(capacity, 0);
+	elapsedMs.assign(capacity, 0);
+	clockSeconds.assign(capacity, 0);
+	overtimeSeconds.assign(capacity, 0);
+	present.assign(capacity, 0);
+
+	ballX.assign(columnSize(SampleBallPosition, capacity), 0);
+	ballY.assign(columnSize(SampleBallPosition, capacity), 0);
+	ballZ.assign(columnSize(SampleBallPosition, capacity), 0);
+	possession.assign(columnSize(SamplePossession, capacity), -1);
+
+	scores.assign(columnSize(SampleScore, playerCapacity), 0);
+	boost.assign(columnSize(SampleBoost, playerCapacity), 0);
+	carX.assign(columnSize(SampleCarPosition, playerCapacity), 0);
+	carY.assign(columnSize(SampleCarPosition, playerCapacity), 0);
+	carZ.assign(columnSize(SampleCarPosition, playerCapacity), 0);
+}
+
+size_t SampleRing::SlotFor(uint16_t playerId)
+{
+	for (size_t slot = 0; slot < slotCount; slot++) {
+		if (slotPlayerIds[slot] == playerId) return slot;
+	}
+	if (slotCount == MAX_STAT_PLAYERS) return MAX_STAT_PLAYERS;
+
+	slotPlayerIds[slotCount] = playerId;
+	return slotCount++;
+}
+
+void SampleRing::Push(const ClockReading& reading, const SampleFrame& frame)
+{
+	if (capacity == 0) return;
+
+	const size_t i = next;
+	next = (next + 1) % capacity;
+	if (count == capacity) overwritten++;
+	else count++;
+
+	ticks[i] = reading.tick;
+	elapsedMs[i] = reading.elapsedMs;
+	clockSeconds[i] = reading.secondsRemaining;
+	overtimeSeconds[i] = reading.overtimeSeconds;
+
+	if (fields & SampleBallPosition)
+	{
+		ballX[i] = ToUnits(frame.ball.x);
+		ballY[i] = ToUnits(frame.ball.y);
+		ballZ[i] = ToUnits(frame.ball.z);
+	}
+	if (fields & SamplePossession) {
+		possession[i] = frame.possession;
+	}
+
+	uint8_t mask = 0;
+	for (size_t p = 0; p < frame.playerCount; p++)
+	{
+		const size_t slot = SlotFor(frame.playerIds[p]);
+		if (slot == MAX_STAT_PLAYERS) continue;
+
+		mask |= static_cast<uint8_t>(1u << slot);
+		const size_t at = slot * capacity + i;
+
+		if (fields & SampleScore) scores[at] = frame.scores[p];
+		if (fields & SampleBoost) boost[at] = frame.boost[p];
+		if (fields & SampleCarPosition)
+		{
+			carX[at] = ToUnits(frame.cars[p].x);
+			carY[at] = ToUnits(frame.cars[p].y);
+			carZ[at] = ToUnits(frame.cars[p].z);
+		}
+	}
+	present[i] = mask;
+}
+
+json SampleRing::ToJson() const
+{
+	const size_t first = count == capacity ? next : 0;
+
+	auto column = [this, first](const auto& values) {
+		json out = json::array();
+		for (size_t n = 0; n < count; n++) {
+			out.push_back(values[(first + n) % capacity]);
+		}
+		return out;
+	};
+
+	auto playerColumn = [this, first](const auto& values, size_t slot) {
+		json out = json::array();
+		for (size_t n = 0; n < count; n++)
+		{
+			const size_t i = (first + n) % capacity;
+			if (present[i] & (1u << slot)) out.push_back(values[slot * capacity + i]);
+			else out.push_back(nullptr);
+		}
+		return out;
+	};
+
+	json samples;
+	samples["Fields"] = SampleFieldNames(fields);
+	samples["Overwritten"] = overwritten;
+	samples["Tick"] = column(ticks);
+	samples["MatchTimeMs"] = column(elapsedMs);
+	samples["ClockSeconds"] = column(clockSeconds);
+	samples["OvertimeSeconds"] = column(overtimeSeconds);
+
+	if (fields & SampleBallPosition) {
+		samples["Ball"] = { { "X", column(ballX) }, { "Y", column(ballY) }, { "Z", column(ballZ) } };
+	}
+	if (fields & SamplePossession) {
+		samples["Possession"] = column(possession);
+	}
+
+	// "Player" indexes into the match's "Players"
+	json players = json::array();
+	for (size_t slot = 0; slot < slotCount; slot++)
+	{
+		json player = { { "Player", slotPlayerIds[slot] } };
+		if (fields & SampleScore) player["Score"] = playerColumn(scores, slot);
+		if (fields & SampleBoost) player["Boost"] = playerColumn(boost, slot);
+		if (fields & SampleCarPosition)
+		{
+			player["X"] = playerColumn(carX, slot);
+			player["Y"] = playerColumn(carY, slot);
+			player["Z"] = playerColumn(carZ, slot);
+		}
+		players.push_back(std::move(player));
+	}
+	samples["Players"] = std::move(players);
+	return samples;
+}
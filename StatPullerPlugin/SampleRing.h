@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "json.hpp"
+using json = nlohmann::json;
+
+#include "MatchClock.h"
+#include "PlayerStats.h"
+
+// samples kept per match, the oldest are overwritten past this; one sample
+// per clock update is a little over 17 minutes
+#define SAMPLE_CAPACITY 1024
+#define DEFAULT_SAMPLE_FIELDS "score,boost,ball,possession"
+
+// What a sample records, any combination.
+enum SampleField : uint32_t {
+    SampleScore = 1 << 0,
+    SampleBoost = 1 << 1,
+    SampleCarPosition = 1 << 2,
+    SampleBallPosition = 1 << 3,
+    SamplePossession = 1 << 4,
+};
+
+// comma separated field names, "none" turns sampling off
+bool ParseSampleFields(const std::string& names, uint32_t& fields);
+json SampleFieldNames(uint32_t fields);
+
+struct SamplePosition {
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+};
+
+// One read of the game, filled by the host on the caller's stack.
+struct SampleFrame {
+    size_t playerCount = 0;
+    std::array<uintptr_t, MAX_STAT_PLAYERS> keys{};
+    std::array<uint16_t, MAX_STAT_PLAYERS> playerIds{};    // set by the core
+    std::array<int32_t, MAX_STAT_PLAYERS> scores{};
+    std::array<uint8_t, MAX_STAT_PLAYERS> boost{};          // 0-100
+    std::array<SamplePosition, MAX_STAT_PLAYERS> cars{};
+
+    SamplePosition ball;
+    int8_t possession = -1;     // team that last touched the ball, -1 = none
+};
+
+// Fixed-capacity time series stored as columns. Every column for the
+// enabled fields is allocated in Reset, Push never allocates. Positions are
+// kept as whole unreal units, which is finer than the field needs.
+class SampleRing
+{
+public:
+    void Reset(uint32_t fields, size_t capacity = SAMPLE_CAPACITY);
+
+    uint32_t Fields() const { return fields; }
+    size_t Count() const { return count; }
+    uint64_t Overwritten() const { return overwritten; }
+
+    void Push(const ClockReading& reading, const SampleFrame& frame);
+
+    // oldest sample first, player columns are null where the player wasn't
+    // in the match
+    json ToJson() const;
+
+private:
+    // player slot for a PlayerTable id, MAX_STAT_PLAYERS if all are taken
+    size_t SlotFor(uint16_t playerId);
+
+    uint32_t fields = 0;
+    size_t capacity = 0;
+    size_t next = 0;
+    size_t count = 0;
+    uint64_t overwritten = 0;
+
+    std::array<uint16_t, MAX_STAT_PLAYERS> slotPlayerIds{};
+    size_t slotCount = 0;
+
+    std::vector<uint32_t> ticks;
+    std::vector<uint32_t> elapsedMs;
+    std::vector<int16_t> clockSeconds;
+    std::vector<int16_t> overtimeSeconds;
+    std::vector<uint8_t> present;           // bit per player slot
+
+    std::vector<int16_t> ballX, ballY, ballZ;
+    std::vector<int8_t> possession;
+
+    // player columns are slot-major, slot * capacity + sample
+    std::vector<int32_t> scores;
+    std::vector<uint8_t> boost;
+    std::vector<int16_t> carX, carY, carZ;
+};
@@ -0,0 +1,121 @@
+#include "pch.h"
+#include "ScriptedMatches.h"
+
+#include <algorithm>
+#include <string>
+
+#include "HookNames.h"
+#include "PlaylistPolicy.h"
+
+// xorshift32, enough to spread events around without pulling in <random>
+static uint32_t NextRandom(uint32_t& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+const char* ScenarioName(MatchScenario scenario)
+{
+	switch (scenario)
+	{
+	case MatchScenario::Ranked1v1: return "1v1";
+	case MatchScenario::Ranked2v2: return "2v2";
+	case MatchScenario::Overtime: return "overtime";
+	case MatchScenario::EarlyExit: return "early-exit";
+	}
+	return "unknown";
+}
+
+std::vector<ScriptStep> BuildScriptedMatch(FakeGameHost& host, MatchScenario scenario, uint32_t seed)
+{
+	uint32_t state = seed ? seed : 1;
+
+	const int teamSize = scenario == MatchScenario::Ranked1v1 ? 1 : 2;
+	host.playlistId = teamSize == 1 ? 10 : 11;
+	host.inOnlineGame = true;
+	host.inReplay = false;
+	const float mmr = 900.0f + NextRandom(state) % 400;
+	host.mmr[host.playlistId] = mmr;
+
+	host.ClearPlayers();
+
+	std::vector<PlayerRef> players;
+	for (int i = 0; i < teamSize * 2; i++) {
+		const uint8_t team = static_cast<uint8_t>(i % 2);
+		players.push_back(host.AddPlayer("Player" + std::to_string(i), team, i == 0));
+	}
+
+	// kickoff countdown, then the playlist's clock, plus overtime
+	const double kickoff = 4.0;
+	const int clockLength = PlaylistClockLength(host.playlistId);
+	int clockSeconds = clockLength;
+	if (scenario == MatchScenario::Overtime) clockSeconds += 60 + NextRandom(state) % 120;
+	if (scenario == MatchScenario::EarlyExit) clockSeconds = 60 + NextRandom(state) % (clockLength - 120);
+	const double end = kickoff + clockSeconds;
+
+	MatchClockState clock;
+	clock.isValid = true;
+	clock.secondsRemaining = clockLength;
+	clock.gameLength = clockLength;
+
+	std::vector<ScriptStep> steps;
+	steps.push_back(ScriptStep::Clock(0.0, clock));
+	steps.push_back(ScriptStep::Hook(0.0, HOOK_ALL_TEAMS_CREATED));
+
+	for (int second = 0; second < clockSeconds; second++)
+	{
+		clock.secondsRemaining = std::max(0, clockLength - second - 1);
+		clock.isOvertime = second + 1 > clockLength;
+		steps.push_back(ScriptStep::Clock(kickoff + second, clock));
+		steps.push_back(ScriptStep::Hook(kickoff + second, HOOK_GAME_TIME_UPDATED));
+	}
+
+	// roughly one ticker event every three seconds, weighted like a real match
+	static const char* const EVENT_MIX[] = {
+		"Shot", "Shot", "Shot", "Save", "Save", "Clear", "Center",
+		"Demolish", "AerialHit", "FirstTouch", "EpicSave", "Goal",
+	};
+	const size_t mixSize = sizeof(EVENT_MIX) / sizeof(EVENT_MIX[0]);
+
+	const int tickerEvents = clockSeconds / 3;
+	for (int i = 0; i < tickerEvents; i++)
+	{
+		const double time = kickoff + (NextRandom(state) % (clockSeconds * 10)) / 10.0;
+		const char* eventName = EVENT_MIX[NextRandom(state) % mixSize];
+
+		const PlayerRef& receiver = players[NextRandom(state) % players.size()];
+		PlayerRef victim;
+		if (std::string(eventName) == "Demolish") {
+			victim = players[(NextRandom(state) % teamSize) * 2 + (1 - receiver.team)];
+		}
+
+		steps.push_back(ScriptStep::Ticker(time, HOOK_STAT_TICKER, host.MakeTicker(eventName, receiver, victim)));
+		if (std::string(eventName) == "Goal" && NextRandom(state) % 2) {
+			steps.push_back(ScriptStep::Ticker(time, HOOK_STAT_TICKER, host.MakeTicker("Assist", players[NextRandom(state) % players.size()])));
+		}
+	}
+
+	if (scenario == MatchScenario::Overtime) {
+		steps.push_back(ScriptStep::Ticker(end, HOOK_STAT_TICKER, host.MakeTicker("Goal", players[0])));
+		steps.push_back(ScriptStep::Ticker(end, HOOK_STAT_TICKER, host.MakeTicker("OvertimeGoal", players[0])));
+	}
+
+	if (scenario != MatchScenario::EarlyExit) {
+		steps.push_back(ScriptStep::Hook(end, HOOK_MATCH_ENDED));
+	}
+	else {
+		steps.push_back(ScriptStep::Hook(end, HOOK_LEAVE_MATCH));
+	}
+	steps.push_back(ScriptStep::Hook(end + 10.0, HOOK_GAME_DESTROYED));
+
+	// the MMR service reports the new value a moment after the match
+	const float delta = scenario == MatchScenario::EarlyExit ? -12.0f : static_cast<float>(NextRandom(state) % 21) - 10.0f;
+	steps.push_back(ScriptStep::MMR(end + 1.5, host.playlistId, mmr + delta));
+
+	std::stable_sort(steps.begin(), steps.end(), [](const ScriptStep& a, const ScriptStep& b) {
+		return a.time < b.time;
+	});
+	return steps;
+}
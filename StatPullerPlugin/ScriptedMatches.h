@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "FakeGameHost.h"
+
+enum class MatchScenario {
+    Ranked1v1,
+    Ranked2v2,
+    Overtime,
+    EarlyExit,
+};
+
+const char* ScenarioName(MatchScenario scenario);
+
+// Builds a deterministic match for the scenario: players are added to the
+// host, its playlist and MMR are set, and the returned steps replay the
+// hooks from OnAllTeamsCreated to Destroyed. The same seed always gives
+// the same match.
+std::vector<ScriptStep> BuildScriptedMatch(FakeGameHost& host, MatchScenario scenario, uint32_t seed);
@@ -0,0 +1,254 @@
+#include "pch.h"
+#include "SessionAggregator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#define SESSION_MAGIC 0x53535053u      // "SPSS"
+#define SESSION_VERSION 2u
+#define SESSION_HEADER_SIZE 16
+// streaks and the day they belong to
+#define SESSION_STREAKS_SIZE 24
+
+static uint32_t Checksum(const char* data, size_t size)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= static_cast<uint8_t>(data[i]);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+int64_t LocalDayStartMs(int64_t timeMs)
+{
+	const time_t seconds = static_cast<time_t>(timeMs / 1000);
+	tm local;
+#ifdef _WIN32
+	localtime_s(&local, &seconds);
+#else
+	localtime_r(&seconds, &local);
+#endif
+	local.tm_hour = 0;
+	local.tm_min = 0;
+	local.tm_sec = 0;
+	local.tm_isdst = -1;
+	return static_cast<int64_t>(mktime(&local)) * 1000;
+}
+
+void SessionWindow::Add(const SessionEntry& entry, int sign)
+{
+	matches += sign;
+	goalsFor += sign * entry.goalsFor;
+	goalsAgainst += sign * entry.goalsAgainst;
+	playedMs += sign * static_cast<int64_t>(entry.durationMs);
+	if (entry.hasMmr) mmrDelta += sign * entry.mmrDelta;
+
+	const HistoryResult result = static_cast<HistoryResult>(entry.result);
+	if (result == HistoryResult::Win) wins += sign;
+	else if (result == HistoryResult::Loss) losses += sign;
+}
+
+json SessionWindow::ToJson(int currentStreak) const
+{
+	const double minutes = playedMs / 60000.0;
+	const uint32_t decided = wins + losses;
+
+	// the day's streak, as far as it reaches into this window
+	const int streak = currentStreak < 0
+		? -std::min(-currentStreak, static_cast<int>(losses))
+		: std::min(currentStreak, static_cast<int>(wins));
+
+	return {
+		{ "Matches", matches },
+		{ "Wins", wins },
+		{ "Losses", losses },
+		{ "WinRate", decided ? static_cast<double>(wins) / decided : 0.0 },
+		{ "GoalsFor", goalsFor },
+		{ "GoalsAgainst", goalsAgainst },
+		{ "GoalsForPerMinute", minutes > 0.0 ? goalsFor / minutes : 0.0 },
+		{ "GoalsAgainstPerMinute", minutes > 0.0 ? goalsAgainst / minutes : 0.0 },
+		{ "MMR_Delta", mmrDelta },
+		{ "Streak", streak },
+	};
+}
+
+bool SessionAggregator::Load(const std::string& path, int64_t nowMs)
+{
+	this->path = path;
+	streakDayMs = LocalDayStartMs(nowMs);
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file) return false;
+
+	uint32_t header[4] = {};
+	file.read(reinterpret_cast<char*>(header), SESSION_HEADER_SIZE);
+	if (!file || header[0] != SESSION_MAGIC || header[1] != SESSION_VERSION || header[2] > SESSION_CAPACITY) return false;
+
+	// streaks, day and entries, checked as a whole before any of it is used
+	std::vector<char> body(SESSION_STREAKS_SIZE + header[2] * sizeof(SessionEntry));
+	file.read(body.data(), body.size());
+	if (!file || Checksum(body.data(), body.size()) != header[3]) return false;
+
+	int32_t streaks[4];
+	int64_t dayMs;
+	std::vector<SessionEntry> entries(header[2]);
+	memcpy(streaks, body.data(), sizeof(streaks));
+	memcpy(&dayMs, body.data() + sizeof(streaks), sizeof(dayMs));
+	memcpy(entries.data(), body.data() + SESSION_STREAKS_SIZE, entries.size() * sizeof(SessionEntry));
+
+	for (const SessionEntry& entry : entries) {
+		Push(entry);
+	}
+	currentStreak = streaks[0];
+	longestWinStreak = streaks[1];
+	longestLossStreak = streaks[2];
+	streakDayMs = dayMs;
+
+	// a snapshot from yesterday restores only what still falls in a window
+	Advance(nowMs);
+	return true;
+}
+
+void SessionAggregator::Add(const MatchSummary& summary, int64_t endTimeMs)
+{
+	Advance(endTimeMs);
+
+	SessionEntry entry{};
+	entry.endTimeMs = endTimeMs;
+	entry.durationMs = summary.DurationMs();
+	entry.goalsFor = summary.GoalsFor();
+	entry.goalsAgainst = summary.GoalsAgainst();
+	entry.result = static_cast<uint8_t>(summary.Result());
+	entry.hasMmr = summary.MmrBefore() >= 0 && summary.MmrAfter() >= 0;
+	entry.mmrDelta = entry.hasMmr ? summary.MmrAfter() - summary.MmrBefore() : 0;
+
+	// a match without a result doesn't break the streak
+	const HistoryResult result = summary.Result();
+	if (result == HistoryResult::Win)
+	{
+		currentStreak = currentStreak > 0 ? currentStreak + 1 : 1;
+		longestWinStreak = std::max(longestWinStreak, currentStreak);
+	}
+	else if (result == HistoryResult::Loss)
+	{
+		currentStreak = currentStreak < 0 ? currentStreak - 1 : -1;
+		longestLossStreak = std::max(longestLossStreak, -currentStreak);
+	}
+
+	Push(entry);
+}
+
+void SessionAggregator::Push(const SessionEntry& entry)
+{
+	// the slot about to be reused must have left every window first
+	if (next >= SESSION_CAPACITY)
+	{
+		const uint64_t overwritten = next - SESSION_CAPACITY;
+		EvictTo(lastMatches, overwritten + 1);
+		EvictTo(lastHour, overwritten + 1);
+		EvictTo(today, overwritten + 1);
+	}
+
+	ring[next % SESSION_CAPACITY] = entry;
+	next++;
+
+	lastMatches.Add(entry, 1);
+	lastHour.Add(entry, 1);
+	today.Add(entry, 1);
+
+	EvictTo(lastMatches, next > SESSION_LAST_MATCHES ? next - SESSION_LAST_MATCHES : 0);
+}
+
+void SessionAggregator::EvictTo(SessionWindow& window, uint64_t index)
+{
+	while (window.head < index && window.head < next) {
+		window.Add(At(window.head++), -1);
+	}
+}
+
+void SessionAggregator::EvictBefore(SessionWindow& window, int64_t cutoffMs)
+{
+	while (window.head < next && At(window.head).endTimeMs < cutoffMs) {
+		window.Add(At(window.head++), -1);
+	}
+}
+
+void SessionAggregator::Advance(int64_t nowMs)
+{
+	EvictBefore(lastHour, nowMs - SESSION_HOUR_MS);
+
+	if (nowMs < dayStartMs || nowMs >= nextDayStartMs)
+	{
+		dayStartMs = LocalDayStartMs(nowMs);
+		// a day is 23 to 25 hours around a DST change
+		nextDayStartMs = LocalDayStartMs(dayStartMs + 26 * static_cast<int64_t>(SESSION_HOUR_MS));
+	}
+	EvictBefore(today, dayStartMs);
+
+	// streaks are per day
+	if (dayStartMs > streakDayMs)
+	{
+		streakDayMs = dayStartMs;
+		currentStreak = 0;
+		longestWinStreak = 0;
+		longestLossStreak = 0;
+	}
+}
+
+json SessionAggregator::ToJson(int64_t nowMs)
+{
+	Advance(nowMs);
+
+	return {
+		{ "LastMatches", lastMatches.ToJson(currentStreak) },
+		{ "LastHour", lastHour.ToJson(currentStreak) },
+		{ "Today", today.ToJson(currentStreak) },
+		{ "CurrentStreak", currentStreak },
+		{ "LongestWinStreak", longestWinStreak },
+		{ "LongestLossStreak", longestLossStreak },
+	};
+}
+
+// Writes next to the snapshot and renames over it, a crash mid-save
+// leaves the previous one.
+bool SessionAggregator::Save() const
+{
+	if (path.empty()) return false;
+
+	// only what a window still holds, oldest first
+	const uint64_t first = std::min({ lastMatches.head, lastHour.head, today.head });
+	const uint32_t count = static_cast<uint32_t>(next - first);
+
+	const int32_t streaks[4] = { currentStreak, longestWinStreak, longestLossStreak, 0 };
+
+	std::vector<char> body(SESSION_STREAKS_SIZE + count * sizeof(SessionEntry));
+	memcpy(body.data(), streaks, sizeof(streaks));
+	memcpy(body.data() + sizeof(streaks), &streakDayMs, sizeof(streakDayMs));
+	for (uint64_t i = first; i < next; i++) {
+		memcpy(body.data() + SESSION_STREAKS_SIZE + (i - first) * sizeof(SessionEntry), &At(i), sizeof(SessionEntry));
+	}
+
+	const uint32_t header[4] = { SESSION_MAGIC, SESSION_VERSION, count, Checksum(body.data(), body.size()) };
+
+	const std::string tempPath = path + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		file.write(body.data(), body.size());
+		file.flush();
+		if (!file) return false;
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, path, ec);
+	if (ec) {
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+	return true;
+}
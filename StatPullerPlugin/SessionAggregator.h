@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "json.hpp"
+using json = nlohmann::json;
+
+#include "MatchSummary.h"
+
+// matches kept for the windows below; a day with more than this only
+// counts its latest SESSION_CAPACITY matches under "Today"
+#define SESSION_CAPACITY 256
+#define SESSION_LAST_MATCHES 10
+#define SESSION_HOUR_MS (60 * 60 * 1000)
+
+struct SessionEntry {
+    int64_t endTimeMs;          // wall clock
+    uint32_t durationMs;
+    int32_t mmrDelta;
+    uint16_t goalsFor;
+    uint16_t goalsAgainst;
+    uint8_t result;             // HistoryResult
+    uint8_t hasMmr;
+    uint8_t reserved[2];
+};
+
+static_assert(sizeof(SessionEntry) == 24, "SessionEntry is written to the snapshot as is");
+static_assert(std::is_trivially_copyable<SessionEntry>::value, "SessionEntry is read back with memcpy");
+
+// Sums over the entries in [head, next) of the aggregator's ring.
+struct SessionWindow {
+    uint64_t head = 0;
+    uint32_t matches = 0;
+    uint32_t wins = 0;
+    uint32_t losses = 0;
+    uint32_t goalsFor = 0;
+    uint32_t goalsAgainst = 0;
+    int32_t mmrDelta = 0;
+    uint64_t playedMs = 0;
+
+    void Add(const SessionEntry& entry, int sign);
+    json ToJson(int currentStreak) const;
+};
+
+// Rolling stats for the play session: the last SESSION_LAST_MATCHES
+// matches, the last hour and today (since local midnight). Matches live in
+// a fixed ring and each window keeps running sums, so adding a match is
+// O(1): it is added to every window and whatever fell out of a window is
+// subtracted again. Streaks count across the day.
+//
+// Saved as a small snapshot of the ring after every match, so a reload
+// picks the session up without going through the match history:
+//
+//   "SPSS" u32 version u32 entries u32 FNV-1a of everything after the header
+//   i32 current streak i32 longest win streak i32 longest loss streak
+//   i32 reserved i64 day the streaks belong to (local midnight, ms)
+//   SessionEntry[entries], oldest first
+//
+// A snapshot that fails its checksum is ignored and the session starts
+// over.
+// Export worker only, after Load.
+class SessionAggregator
+{
+public:
+    // restores the snapshot at path, if there is one; saves go there too
+    bool Load(const std::string& path, int64_t nowMs);
+
+    // O(1), in memory; Save writes the snapshot
+    void Add(const MatchSummary& summary, int64_t endTimeMs);
+
+    // drops matches that have aged out of the time windows
+    void Advance(int64_t nowMs);
+
+    const SessionWindow& LastMatches() const { return lastMatches; }
+    const SessionWindow& LastHour() const { return lastHour; }
+    const SessionWindow& Today() const { return today; }
+    int CurrentStreak() const { return currentStreak; }
+
+    json ToJson(int64_t nowMs);
+
+    bool Save() const;
+
+private:
+    void Push(const SessionEntry& entry);
+    // drops entries from the front of window up to index, or ending before cutoffMs
+    void EvictTo(SessionWindow& window, uint64_t index);
+    void EvictBefore(SessionWindow& window, int64_t cutoffMs);
+
+    const SessionEntry& At(uint64_t index) const { return ring[index % SESSION_CAPACITY]; }
+
+    std::string path;
+
+    std::array<SessionEntry, SESSION_CAPACITY> ring;
+    uint64_t next = 0;
+
+    SessionWindow lastMatches;
+    SessionWindow lastHour;
+    SessionWindow today;
+
+    int currentStreak = 0;
+    int longestWinStreak = 0;
+    int longestLossStreak = 0;
+    int64_t streakDayMs = 0;
+
+    // the local day Advance last saw, mktime is too slow to call every time
+    int64_t dayStartMs = 0;
+    int64_t nextDayStartMs = 0;
+};
+
+// local midnight before timeMs, in ms since the epoch
+int64_t LocalDayStartMs(int64_t timeMs);
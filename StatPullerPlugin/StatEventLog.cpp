@@ -0,0 +1,89 @@
+#include "pch.h"
+#include "StatEventLog.h"
+
+// indexed by StatEventType
+static const char* const KNOWN_EVENT_NAMES[] = {
+	"Unknown",
+	"Goal",
+	"Assist",
+	"Save",
+	"EpicSave",
+	"Shot",
+	"Demolish",
+	"AerialGoal",
+	"BackwardsGoal",
+	"BicycleGoal",
+	"LongGoal",
+	"TurtleGoal",
+	"PoolShot",
+	"OvertimeGoal",
+	"OwnGoal",
+	"HatTrick",
+	"Playmaker",
+	"Savior",
+	"Center",
+	"Clear",
+	"FirstTouch",
+	"AerialHit",
+	"BicycleHit",
+	"LowFive",
+	"HighFive",
+	"Swish",
+	"MVP",
+	"Win",
+};
+
+static_assert(sizeof(KNOWN_EVENT_NAMES) / sizeof(KNOWN_EVENT_NAMES[0]) == static_cast<size_t>(StatEventType::Count),
+	"KNOWN_EVENT_NAMES must match StatEventType");
+
+StatEventTable::StatEventTable()
+	: names(std::begin(KNOWN_EVENT_NAMES), std::end(KNOWN_EVENT_NAMES))
+{
+	resolved.reserve(64);
+}
+
+uint8_t StatEventTable::IdForName(const std::string& name)
+{
+	for (size_t i = 1; i < names.size(); i++) {
+		if (names[i] == name) return static_cast<uint8_t>(i);
+	}
+
+	// ids are a byte, anything past that is lumped in with Unknown
+	if (names.size() > UINT8_MAX) return static_cast<uint8_t>(StatEventType::Unknown);
+
+	names.push_back(name);
+	return static_cast<uint8_t>(names.size() - 1);
+}
+
+StatEventLog::StatEventLog(size_t expectedEvents)
+{
+	types.reserve(expectedEvents);
+	receivers.reserve(expectedEvents);
+	victims.reserve(expectedEvents);
+	clockSeconds.reserve(expectedEvents);
+	overtimeSeconds.reserve(expectedEvents);
+	ticks.reserve(expectedEvents);
+	elapsedMs.reserve(expectedEvents);
+}
+
+void StatEventLog::Append(uint8_t type, uint16_t receiverId, uint16_t victimId, const ClockReading& clock)
+{
+	types.push_back(type);
+	receivers.push_back(receiverId);
+	victims.push_back(victimId);
+	clockSeconds.push_back(clock.secondsRemaining);
+	overtimeSeconds.push_back(clock.overtimeSeconds);
+	ticks.push_back(clock.tick);
+	elapsedMs.push_back(clock.elapsedMs);
+}
+
+void StatEventLog::Clear()
+{
+	types.clear();
+	receivers.clear();
+	victims.clear();
+	clockSeconds.clear();
+	overtimeSeconds.clear();
+	ticks.clear();
+	elapsedMs.clear();
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "MatchClock.h"
+
+// Stat ticker events the plugin knows by name. Names the game sends that
+// aren't listed here get ids after Count, assigned the first time they show up.
+enum class StatEventType : uint8_t {
+    Unknown = 0,
+    Goal,
+    Assist,
+    Save,
+    EpicSave,
+    Shot,
+    Demolish,
+    AerialGoal,
+    BackwardsGoal,
+    BicycleGoal,
+    LongGoal,
+    TurtleGoal,
+    PoolShot,
+    OvertimeGoal,
+    OwnGoal,
+    HatTrick,
+    Playmaker,
+    Savior,
+    Center,
+    Clear,
+    FirstTouch,
+    AerialHit,
+    BicycleHit,
+    LowFive,
+    HighFive,
+    Swish,
+    MVP,
+    Win,
+    Count
+};
+
+// Maps the game's StatEvent objects to event ids. The name is only compared
+// the first time an object is seen, after that it's a pointer lookup.
+class StatEventTable
+{
+public:
+    StatEventTable();
+
+    template <typename NameFn>
+    uint8_t Resolve(uintptr_t statEvent, NameFn&& resolveName)
+    {
+        auto it = resolved.find(statEvent);
+        if (it != resolved.end()) return it->second;
+
+        const uint8_t id = IdForName(resolveName());
+        resolved.emplace(statEvent, id);
+        return id;
+    }
+
+    const std::string& Name(uint8_t id) const { return names[id]; }
+    const std::vector<std::string>& Names() const { return names; }
+
+    // forget resolved objects, the game may reload them between matches
+    void ClearResolved() { resolved.clear(); }
+
+private:
+    uint8_t IdForName(const std::string& name);
+
+    std::vector<std::string> names;
+    std::unordered_map<uintptr_t, uint8_t> resolved;
+};
+
+// Every stat ticker event of a match, one column per field.
+class StatEventLog
+{
+public:
+    explicit StatEventLog(size_t expectedEvents = 1024);
+
+    void Append(uint8_t type, uint16_t receiverId, uint16_t victimId, const ClockReading& clock);
+    void Clear();
+
+    size_t Size() const { return types.size(); }
+
+    std::vector<uint8_t> types;
+    std::vector<uint16_t> receivers;    // PlayerTable index or PlayerTable::NONE
+    std::vector<uint16_t> victims;      // PlayerTable index or PlayerTable::NONE
+    std::vector<int16_t> clockSeconds;
+    std::vector<int16_t> overtimeSeconds;
+    std::vector<uint32_t> ticks;
+    std::vector<uint32_t> elapsedMs;
+};
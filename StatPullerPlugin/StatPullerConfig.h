@@ -0,0 +1,9 @@
+#pragma once
+
+// version:
+// major: changes to exported .json data structure, new data fields
+// minor: patch, bug fixes, small changes
+#define STAT_PULLER_VERSION "12.0"
+
+// full file path to python script ex: "C:\\Users\\(user)\\Desktop\\StatPuller-Build-Match-Summary\\"
+#define PYTHON_SCRIPT_PATH "C:\\Users\\harri\\Desktop\\StatPuller-Build-Match-Summary\\"
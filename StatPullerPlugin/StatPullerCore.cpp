@@ -0,0 +1,882 @@
+#include "pch.h"
+#include "StatPullerCore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+#include "StatPullerConfig.h"
+
+// the replay is taken this long after match end, once the post-game screen
+// has loaded, or right away if the match is torn down first
+#define REPLAY_CAPTURE_DELAY 1.5f
+// how long the exporter holds the summary back for the replay
+#define REPLAY_WAIT_SECONDS 30
+// and the match file for the post-match MMR
+#define MMR_WAIT_SECONDS 30
+
+
+StatPullerCore::StatPullerCore(IGameHost& host, std::string outputDirectory)
+	: host(host), outputDirectory(std::move(outputDirectory)), exportWorker(logger), mmrTracker(host)
+{
+}
+
+StatPullerCore::~StatPullerCore()
+{
+	Stop();
+}
+
+void StatPullerCore::Start()
+{
+	logger.Start([this](const std::string& line) {
+		host.LogAsync(line);
+	}, outputDirectory + "logs" + static_cast<char>(std::filesystem::path::preferred_separator));
+
+	LoadHooks();
+	mmrTracker.Start();
+
+	if (!liveFile.Open(outputDirectory + "live-match.bin")) {
+		SP_LOG_WARN(logger, "Could not open live-match.bin, live stats are off.");
+	}
+
+	if (session.Load(outputDirectory + "session.bin", host.WallClockMs())) {
+		SP_LOG_INFO(logger, "Session restored, {} matches today.", session.Today().matches);
+	}
+
+	replayFlusher.Start();
+	exportWorker.Start([this](MatchSnapshot& snapshot) {
+		ExportMatch(snapshot);
+	});
+}
+
+void StatPullerCore::Stop()
+{
+	if (pendingReplay) {
+		pendingReplay->set_value(ReplayResult());
+		pendingReplay.reset();
+	}
+	mmrTracker.Stop();
+
+	replayFlusher.Stop();
+	exportWorker.Stop();
+	// after the export worker, which publishes to it
+	server.Stop();
+	liveFile.Close();
+	logger.Stop();
+}
+
+void StatPullerCore::SetServerPort(uint16_t port)
+{
+	server.Stop();
+	if (port == 0) return;
+
+	if (server.Start(port, outputDirectory + "live-match.bin", outputDirectory + "match-history.splog")) {
+		SP_LOG_INFO(logger, "Stats server listening on http://127.0.0.1:{}/", server.Port());
+	}
+	else {
+		SP_LOG_ERROR(logger, "Could not start the stats server on port {}.", port);
+	}
+}
+
+void StatPullerCore::SetReplayRetention(uint64_t maxMegabytes, int maxAgeDays)
+{
+	replayArchiveMaxBytes = maxMegabytes << 20;
+	replayArchiveMaxAgeMs = static_cast<int64_t>(maxAgeDays) * 86400000;
+}
+
+void StatPullerCore::LoadHooks()
+{
+	hooks.Register(host, *this);
+}
+
+void StatPullerCore::OnHook(HookId id, const StatTickerEvent* ticker)
+{
+	switch (id)
+	{
+	case HookId::MatchStarted:
+		OnMatchStarted();
+		break;
+	case HookId::MatchEnded:
+		OnGameComplete(MatchEndReason::MatchEnded);
+		break;
+	case HookId::GameDestroyed:
+		OnGameComplete(MatchEndReason::GameDestroyed);
+		// the replay goes away with the game, take it now
+		CaptureReplay();
+		break;
+	case HookId::StatTicker:
+		OnStatTickerMessage(*ticker);
+		break;
+	case HookId::ClockUpdated:
+		UpdateClock();
+		SampleMatch();
+		break;
+	case HookId::LeaveMatch:
+		matchState.OnLeaveMatch();
+		break;
+	default:
+		break;
+	}
+}
+
+void StatPullerCore::OnMatchStarted()
+{
+	// clips left over from a match that never reported its end
+	FlushClips(true);
+
+	const OnlineGameInfo game = host.GetOnlineGame();
+	clock.Start(PlaylistClockLength(game.isValid ? game.playlistId : -1), host.ClockNow(), host.WallClockMs());
+	const uint64_t matchId = matchState.Begin(clock.StartWallClockMs());
+	captureLevel = CaptureLevel::Off;
+	goalEvents.Clear();
+	eventLog.Clear();
+	players.Clear();
+	statEvents.ClearResolved();
+	// nothing is sampled until the playlist's capture level is known
+	samples.Reset(0);
+
+	host.SetTimeout([this, matchId]
+	{
+		// ended, or another match started, before this ran
+		if (matchState.Id() != matchId || !matchState.IsActive()) return;
+
+		if (!host.IsInOnlineGame() || host.IsInReplay())
+		{
+			matchState.Ignore();
+			SP_LOG_INFO(logger, "Ignored OnMatchStarted because it's not an online match.");
+			return;
+		}
+
+		playlist = host.GetOnlineGame().playlistId;
+		const CaptureLevel level = playlistCapture.Level(playlist);
+
+		if (level == CaptureLevel::Off) {
+			matchState.Ignore();
+			SP_LOG_INFO(logger, "Playlist {} isn't captured. Skipping.", playlist);
+			return;
+		}
+
+		captureLevel = level;
+		samples.Reset(captureLevel == CaptureLevel::Full ? sampleFields : 0);
+		mmrTracker.BeginMatch(playlist);
+		summary.Begin(matchId, playlist, clock.ClockLength(), static_cast<int>(mmrTracker.Cached(playlist)));
+
+		PublishMatchStart();
+		SP_LOG_INFO(logger, "Match {} has started.", matchId);
+	}, 3.0f);
+}
+
+// Bound to both EventMatchEnded and Destroyed, whichever comes first ends
+// the match and the other is ignored.
+void StatPullerCore::OnGameComplete(MatchEndReason reason)
+{
+	if (!IsRecording() || host.IsInReplay()) return;
+
+	if (!matchState.End(reason, host.GetClockState())) return;
+
+	const uint64_t matchId = matchState.Id();
+	const MatchOutcome outcome = matchState.Outcome();
+	SP_LOG_INFO(logger, "Match {} ended: {}", matchId, MatchOutcomeName(outcome));
+
+	// the last goal, an overtime winner say, still needs its footage
+	clipQueue.CloseBatch();
+	FlushClips(false);
+	CapturePlayerStats();
+	PublishPhase();
+	EndSummary(outcome);
+
+	TrySaveReplay(MatchOutcomeName(outcome));
+	mmrResult = mmrTracker.EndMatch();
+
+	// copies the match state outside the match end hook
+	host.SetTimeout([this, matchId, outcome]
+	{
+		if (matchState.Id() != matchId || !matchState.MarkExported()) return;
+
+		MatchSnapshot snapshot;
+		snapshot.matchId = matchId;
+		snapshot.outcome = outcome;
+		PublishPhase();
+		snapshot.playlist = playlist;
+		snapshot.captureLevel = captureLevel;
+		snapshot.format = exportFormat;
+		snapshot.isSummaryScriptEnabled = isSummaryScriptEnabled;
+		snapshot.clockLength = clock.ClockLength();
+		snapshot.startWallClockMs = clock.StartWallClockMs();
+		snapshot.mmr = mmrResult;
+		snapshot.goals = goalEvents;
+		snapshot.events = eventLog;
+		snapshot.eventNames = statEvents.Names();
+		snapshot.playerNames = players.Names();
+		snapshot.playerStats = playerStats;
+		snapshot.samples = std::move(samples);
+		samples.Reset(0);
+		snapshot.summary = summary;
+		snapshot.replay = replayResult;
+
+		if (!exportWorker.Submit(std::move(snapshot))) {
+			SP_LOG_WARN(logger, "Export queue is full, match data dropped.");
+		}
+	}, 0.2f);
+}
+
+// runs on the export worker thread
+void StatPullerCore::ExportMatch(MatchSnapshot& snapshot)
+{
+	// the history log outlives the plugin, so it seeds the sequence once
+	if (!isSequenceSeeded)
+	{
+		if (OpenMatchLog()) {
+			exportSequence = matchLog.Count();
+		}
+		isSequenceSeeded = true;
+	}
+
+	// polling gives up well before this, the wait only guards against a
+	// result that never comes
+	if (snapshot.mmr.valid())
+	{
+		if (snapshot.mmr.wait_for(std::chrono::seconds(MMR_WAIT_SECONDS)) == std::future_status::ready)
+		{
+			const MmrResult mmr = snapshot.mmr.get();
+			snapshot.mmrBefore = static_cast<int>(mmr.before);
+			snapshot.mmrAfter = static_cast<int>(mmr.after);
+			snapshot.isMmrSettled = mmr.isSettled;
+		}
+		if (!snapshot.isMmrSettled) {
+			SP_LOG_WARN(logger, "MMR didn't update after the match, recording the last known value.");
+		}
+	}
+
+	if (snapshot.matchId == lastExportedMatchId)
+	{
+		SP_LOG_WARN(logger, "Match {} was already exported, skipping.", snapshot.matchId);
+		return;
+	}
+	lastExportedMatchId = snapshot.matchId;
+
+	snapshot.summary.SetMmr(snapshot.mmrBefore, snapshot.mmrAfter);
+	session.Add(snapshot.summary, snapshot.startWallClockMs + snapshot.summary.DurationMs());
+	if (!session.Save()) {
+		SP_LOG_WARN(logger, "Could not save session.bin.");
+	}
+
+	json document = BuildMatchDocument(snapshot);
+	document["Sequence"] = ++exportSequence;
+
+	const bool isSaved = SaveMatchDataToFile(document, snapshot.format);
+	AppendToHistory(document);
+	AppendToMatchLog(document);
+	server.PublishMatch(document);
+
+	// the summary reads the replay, so it waits until the file is complete
+	ReplayResult replay;
+	if (snapshot.replay.valid())
+	{
+		if (snapshot.replay.wait_for(std::chrono::seconds(REPLAY_WAIT_SECONDS)) != std::future_status::ready) {
+			SP_LOG_WARN(logger, "Replay still not written, continuing without it.");
+		}
+		else if (!(replay = snapshot.replay.get()).isSaved) {
+			SP_LOG_WARN(logger, "Replay was not saved, continuing without it.");
+		}
+		else {
+			SP_LOG_INFO(logger, "Replay saved successfully: {}", replay.path);
+		}
+	}
+
+	if (isSaved && snapshot.isSummaryScriptEnabled)
+	{
+		host.RunScript("build_summary.py");
+		SP_LOG_INFO(logger, "Match data saved and uploaded.");
+	}
+	else if (isSaved) {
+		SP_LOG_INFO(logger, "Match data saved.");
+	}
+	else {
+		SP_LOG_ERROR(logger, "Could not write match data, summary skipped.");
+	}
+
+	// the archive is heavy, only for playlists captured in full
+	if (replay.isSaved && snapshot.captureLevel == CaptureLevel::Full) {
+		ArchiveReplay(replay.path, snapshot);
+	}
+}
+
+void StatPullerCore::ArchiveReplay(const std::string& replayPath, const MatchSnapshot& snapshot)
+{
+	if (!replayArchive.IsOpen() && !replayArchive.Open(outputDirectory + "replays" + static_cast<char>(std::filesystem::path::preferred_separator)))
+	{
+		SP_LOG_ERROR(logger, "Could not open replay archive.");
+		return;
+	}
+
+	ReplayArchiveEntry entry;
+	entry.matchId = snapshot.matchId;
+	entry.startWallClockMs = snapshot.startWallClockMs;
+	entry.playlist = snapshot.playlist;
+	entry.mmrBefore = snapshot.mmrBefore;
+	entry.mmrAfter = snapshot.mmrAfter;
+
+	if (!replayArchive.Add(replayPath, entry)) {
+		SP_LOG_ERROR(logger, "Could not archive replay {}", replayPath);
+		return;
+	}
+
+	ReplayRetention retention;
+	retention.maxStoredBytes = replayArchiveMaxBytes.load();
+	retention.maxAgeMs = replayArchiveMaxAgeMs.load();
+	// the export worker can't read the host's clock, the match end will do
+	const int64_t nowMs = snapshot.startWallClockMs + snapshot.summary.DurationMs();
+
+	const size_t dropped = replayArchive.Prune(retention, nowMs);
+	if (dropped > 0) {
+		SP_LOG_INFO(logger, "Dropped {} old replays from the archive.", dropped);
+	}
+}
+
+json StatPullerCore::BuildMatchDocument(const MatchSnapshot& snapshot)
+{
+	json localMatchStats;
+	localMatchStats["Version"] = STAT_PULLER_VERSION;
+	localMatchStats["MatchId"] = snapshot.matchId;
+	localMatchStats["Outcome"] = MatchOutcomeName(snapshot.outcome);
+	localMatchStats["MMR_Before"] = snapshot.mmrBefore;
+	localMatchStats["MMR_After"] = snapshot.mmrAfter;
+	localMatchStats["MMR_Settled"] = snapshot.isMmrSettled;
+
+	json goals = json::array();
+	for (const GoalEvent& goal : snapshot.goals)
+	{
+		goals.push_back({
+			{ "ScorerName", snapshot.playerNames[goal.scorerId] },
+			{ "ScorerTeam", goal.team },
+			{ "GoalTimeSeconds", goal.clockSeconds },
+			{ "IsOvertime", goal.isOvertime != 0 },
+			{ "OvertimeSeconds", goal.overtimeSeconds },
+			{ "MatchTimeMs", goal.elapsedMs },
+			{ "WallClockMs", snapshot.startWallClockMs + goal.elapsedMs },
+		});
+	}
+	localMatchStats["Goals"] = std::move(goals);
+
+	const StatEventLog& events = snapshot.events;
+	json eventTypes = json::array();
+	for (uint8_t type : events.types) {
+		eventTypes.push_back(snapshot.eventNames[type]);
+	}
+
+	auto playerColumn = [](const std::vector<uint16_t>& ids) {
+		json column = json::array();
+		for (uint16_t id : ids) {
+			column.push_back(id == PlayerTable::NONE ? -1 : static_cast<int>(id));
+		}
+		return column;
+	};
+
+	// columns line up by index, player columns index into "Players" (-1 = none)
+	localMatchStats["Players"] = snapshot.playerNames;
+	localMatchStats["Events"] = {
+		{ "Type", std::move(eventTypes) },
+		{ "Receiver", playerColumn(events.receivers) },
+		{ "Victim", playerColumn(events.victims) },
+		{ "ClockSeconds", events.clockSeconds },
+		{ "OvertimeSeconds", events.overtimeSeconds },
+		{ "Tick", events.ticks },
+		{ "MatchTimeMs", events.elapsedMs },
+	};
+
+	// one row per player, same layout as "Events"
+	const PlayerStatTable& stats = snapshot.playerStats;
+	json statColumns = {
+		{ "Player", json::array() }, { "Team", json::array() }, { "IsLocal", json::array() }, { "IsMVP", json::array() },
+		{ "Score", json::array() }, { "Goals", json::array() }, { "OwnGoals", json::array() }, { "Assists", json::array() },
+		{ "Saves", json::array() }, { "Shots", json::array() }, { "Demolishes", json::array() },
+		{ "BallTouches", json::array() }, { "CarTouches", json::array() }, { "BoostPickups", json::array() },
+	};
+	for (const PlayerStatRow& row : stats)
+	{
+		statColumns["Player"].push_back(row.playerId == PlayerTable::NONE ? -1 : static_cast<int>(row.playerId));
+		statColumns["Team"].push_back(row.team);
+		statColumns["IsLocal"].push_back(row.isLocal);
+		statColumns["IsMVP"].push_back(row.isMvp);
+		statColumns["Score"].push_back(row.score);
+		statColumns["Goals"].push_back(row.goals);
+		statColumns["OwnGoals"].push_back(row.ownGoals);
+		statColumns["Assists"].push_back(row.assists);
+		statColumns["Saves"].push_back(row.saves);
+		statColumns["Shots"].push_back(row.shots);
+		statColumns["Demolishes"].push_back(row.demolishes);
+		statColumns["BallTouches"].push_back(row.ballTouches);
+		statColumns["CarTouches"].push_back(row.carTouches);
+		statColumns["BoostPickups"].push_back(row.boostPickups);
+	}
+	localMatchStats["PlayerStats"] = std::move(statColumns);
+
+	json teamStats = json::array();
+	for (const TeamStatRow& team : stats.teams)
+	{
+		teamStats.push_back({
+			{ "Players", team.players },
+			{ "Score", team.score },
+			{ "Goals", team.goals },
+			{ "Assists", team.assists },
+			{ "Saves", team.saves },
+			{ "Shots", team.shots },
+			{ "Demolishes", team.demolishes },
+			{ "BallTouches", team.ballTouches },
+			{ "BoostPickups", team.boostPickups },
+		});
+	}
+	localMatchStats["TeamStats"] = std::move(teamStats);
+
+	if (snapshot.samples.Fields()) {
+		localMatchStats["Samples"] = snapshot.samples.ToJson();
+	}
+
+	localMatchStats["ClockLength"] = snapshot.clockLength;
+	localMatchStats["MatchStartWallClockMs"] = snapshot.startWallClockMs;
+	localMatchStats["Playlist"] = snapshot.playlist;
+
+	const int policy = FindPlaylistPolicy(snapshot.playlist);
+	localMatchStats["PlaylistName"] = policy < 0 ? "unknown" : PLAYLIST_POLICIES[policy].name;
+	localMatchStats["TeamSize"] = policy < 0 ? 0 : PLAYLIST_POLICIES[policy].teamSize;
+	localMatchStats["CaptureLevel"] = CaptureLevelName(snapshot.captureLevel);
+
+	localMatchStats["Summary"] = snapshot.summary.ToJson(snapshot.playerNames);
+	localMatchStats["Session"] = session.ToJson(snapshot.startWallClockMs + snapshot.summary.DurationMs());
+	return localMatchStats;
+}
+
+void StatPullerCore::OnStatTickerMessage(const StatTickerEvent& event)
+{
+	if (!IsRecording()) return;
+
+	const uint8_t type = statEvents.Resolve(event.statEvent, [this, &event] {
+		return host.GetStatEventName(event.statEvent);
+	});
+
+	const uint16_t receiverId = InternPlayer(event.receiver);
+	const uint16_t victimId = InternPlayer(event.victim);
+
+	if (event.receiver.isLocal)
+	{
+		summary.SetLocalTeam(event.receiver.team);
+		summary.OnLocalStat(static_cast<StatEventType>(type));
+	}
+
+	const ClockReading reading = clock.Read(host.GetClockState(), host.ClockNow());
+	eventLog.Append(type, receiverId, victimId, reading);
+	PublishStatEvent(static_cast<StatEventType>(type), receiverId, event.receiver);
+
+	switch (static_cast<StatEventType>(type))
+	{
+	case StatEventType::Goal:
+		OnGoal(event.receiver, receiverId, reading);
+		break;
+	default:
+		break;
+	}
+}
+
+void StatPullerCore::OnGoal(const PlayerRef& scorer, uint16_t scorerId, const ClockReading& reading)
+{
+	if (scorerId == PlayerTable::NONE)
+	{
+		SP_LOG_WARN(logger, "Receiver PRI is null.");
+		return;
+	}
+
+	GoalEvent goal;
+	goal.scorerId = scorerId;
+	goal.team = scorer.team;
+	goal.isOvertime = reading.isOvertime;
+	goal.clockSeconds = reading.secondsRemaining;
+	goal.overtimeSeconds = reading.overtimeSeconds;
+	goal.tick = reading.tick;
+	goal.elapsedMs = reading.elapsedMs;
+
+	if (!goalEvents.Push(goal)) {
+		SP_LOG_WARN(logger, "Goal buffer is full, goal not recorded.");
+	}
+	PublishGoal(goal);
+	summary.OnGoal(goal);
+
+	if (server.IsRunning())
+	{
+		server.Publish("goal", {
+			{ "MatchId", matchState.Id() },
+			{ "Scorer", players.Name(scorerId) },
+			{ "Team", goal.team },
+			{ "IsOvertime", goal.isOvertime != 0 },
+			{ "ClockSeconds", goal.clockSeconds },
+			{ "OvertimeSeconds", goal.overtimeSeconds },
+			{ "ElapsedMs", goal.elapsedMs },
+		});
+	}
+
+	if (reading.isOvertime) {
+		SP_LOG_INFO(logger, "Goal scored by: {} on team {} at +{}", players.Name(goal.scorerId), goal.team, reading.overtimeSeconds);
+	}
+	else {
+		SP_LOG_INFO(logger, "Goal scored by: {} on team {} at {}", players.Name(goal.scorerId), goal.team, reading.secondsRemaining);
+	}
+
+	if (scorer.isLocal)
+	{
+		ClipGoal clip;
+		clip.scorerName = players.Name(scorerId);
+		clip.clockSeconds = reading.secondsRemaining;
+		clip.isOvertime = reading.isOvertime;
+		clip.matchTimeMs = reading.elapsedMs;
+		clip.wallClockMs = clock.StartWallClockMs() + reading.elapsedMs;
+
+		clipQueue.Add(std::move(clip), host.ClockNow());
+		ScheduleClipCheck();
+	}
+}
+
+// A check already pending is kept unless the batch is now due sooner,
+// closing it at match end does that.
+void StatPullerCore::ScheduleClipCheck()
+{
+	const IGameHost::TimePoint now = host.ClockNow();
+
+	// timers can fire a little early, never ask for less than a frame or so
+	const float delay = std::max(0.05f, clipQueue.SecondsUntilDue(now));
+	const IGameHost::TimePoint checkAt = now + std::chrono::duration_cast<IGameHost::TimePoint::duration>(std::chrono::duration<float>(delay));
+	if (isClipCheckPending && clipCheckAt <= checkAt) return;
+
+	isClipCheckPending = true;
+	clipCheckAt = checkAt;
+	host.SetTimeout([this, checkAt]
+	{
+		// a later check replaced by an earlier one finds nothing to do
+		if (clipCheckAt == checkAt) isClipCheckPending = false;
+		FlushClips(false);
+	}, delay);
+}
+
+// Runs clip.py once for every goal queued so far. Unforced flushes wait
+// for the batch to be due, a later goal may have pushed it back.
+void StatPullerCore::FlushClips(bool isForced)
+{
+	const IGameHost::TimePoint now = host.ClockNow();
+	if (clipQueue.IsEmpty()) return;
+
+	if (!isForced && !clipQueue.IsDue(now))
+	{
+		ScheduleClipCheck();
+		return;
+	}
+
+	json request = clipQueue.TakeRequest(now);
+	const size_t count = request["Goals"].size();
+
+	host.RunScript("clip.py", request);
+	SP_LOG_INFO(logger, "Clipping {} goal(s).", count);
+}
+
+uint16_t StatPullerCore::InternPlayer(const PlayerRef& player)
+{
+	if (player.key == 0) return PlayerTable::NONE;
+
+	return players.Intern(player.key, [this, &player] {
+		return host.GetPlayerName(player.key);
+	});
+}
+
+// One pass over the scoreboard at match end, names are only looked up for
+// players the match hasn't seen yet.
+// The summary has been kept up to date all match, so ending it is cheap
+// enough for the match end hook.
+void StatPullerCore::EndSummary(MatchOutcome outcome)
+{
+	// the scoreboard knows the local player even if no ticker named them
+	for (const PlayerStatRow& row : playerStats) {
+		if (row.isLocal) summary.SetLocalTeam(row.team);
+	}
+	summary.End(outcome, clock.Read(host.GetClockState(), host.ClockNow()).elapsedMs);
+
+	SP_LOG_INFO(logger, "Match {} summary: {} {}-{}", summary.MatchId(), MatchResultName(summary.Result()), summary.GoalsFor(), summary.GoalsAgainst());
+
+	if (server.IsRunning()) {
+		server.Publish("summary", summary.ToJson(players.Names()));
+	}
+}
+
+void StatPullerCore::CapturePlayerStats()
+{
+	playerStats.Clear();
+	playerStats.count = host.CapturePlayerStats(playerStats.rows.data(), playerStats.rows.size());
+
+	for (size_t i = 0; i < playerStats.count; i++)
+	{
+		PlayerStatRow& row = playerStats.rows[i];
+
+		PlayerRef player;
+		player.key = row.key;
+		player.team = row.team;
+		player.isLocal = row.isLocal;
+		row.playerId = InternPlayer(player);
+
+		playerStats.AddToTeam(row);
+	}
+}
+
+// Once per clock update. The frame lives on the stack and the ring is
+// allocated at match start, so a sample doesn't touch the heap.
+void StatPullerCore::SampleMatch()
+{
+	if (!IsRecording() || !samples.Fields()) return;
+
+	SampleFrame frame;
+	if (!host.CaptureSample(samples.Fields(), frame)) return;
+
+	for (size_t i = 0; i < frame.playerCount; i++)
+	{
+		PlayerRef player;
+		player.key = frame.keys[i];
+		frame.playerIds[i] = InternPlayer(player);
+	}
+
+	samples.Push(clock.Read(host.GetClockState(), host.ClockNow()), frame);
+}
+
+void StatPullerCore::PublishMatchStart()
+{
+	liveFile.Update([this](LiveMatchData& live) {
+		const uint32_t updates = live.updates;
+		live = LiveMatchData();
+		live.updates = updates;
+
+		live.matchId = matchState.Id();
+		live.startWallClockMs = clock.StartWallClockMs();
+		live.playlist = playlist;
+		live.mmrBefore = static_cast<int32_t>(mmrTracker.Cached(playlist));
+		live.clockLength = static_cast<int16_t>(clock.ClockLength());
+		live.secondsRemaining = live.clockLength;
+		live.phase = static_cast<uint8_t>(matchState.Phase());
+	});
+}
+
+void StatPullerCore::PublishClock(const ClockReading& reading)
+{
+	liveFile.Update([this, &reading](LiveMatchData& live) {
+		live.phase = static_cast<uint8_t>(matchState.Phase());
+		live.clockLength = static_cast<int16_t>(clock.ClockLength());
+		live.secondsRemaining = reading.secondsRemaining;
+		live.overtimeSeconds = reading.overtimeSeconds;
+		live.isOvertime = reading.isOvertime;
+		live.tick = reading.tick;
+		live.elapsedMs = reading.elapsedMs;
+	});
+}
+
+void StatPullerCore::PublishStatEvent(StatEventType type, uint16_t playerId, const PlayerRef& ref)
+{
+	if (playerId >= LIVE_MAX_PLAYERS) return;
+
+	liveFile.Update([this, type, playerId, &ref](LiveMatchData& live) {
+		// players show up in id order, fill in any new ones
+		const std::vector<std::string>& names = players.Names();
+		for (size_t id = live.playerCount; id < names.size() && id < LIVE_MAX_PLAYERS; id++) {
+			CopyLiveName(live.players[id].name, names[id]);
+		}
+		live.playerCount = static_cast<uint8_t>(names.size() < LIVE_MAX_PLAYERS ? names.size() : LIVE_MAX_PLAYERS);
+
+		LivePlayer& player = live.players[playerId];
+		player.team = ref.team;
+		player.isLocal = ref.isLocal;
+
+		switch (type)
+		{
+		case StatEventType::Goal: player.goals++; break;
+		case StatEventType::Assist: player.assists++; break;
+		case StatEventType::Save:
+		case StatEventType::EpicSave: player.saves++; break;
+		case StatEventType::Shot: player.shots++; break;
+		case StatEventType::Demolish: player.demolishes++; break;
+		default: break;
+		}
+	});
+}
+
+void StatPullerCore::PublishGoal(const GoalEvent& goal)
+{
+	liveFile.Update([&goal](LiveMatchData& live) {
+		if (goal.team <= 1) live.score[goal.team]++;
+		if (live.goalCount == LIVE_MAX_GOALS) return;
+
+		LiveGoal& entry = live.goals[live.goalCount++];
+		entry.scorer = static_cast<uint8_t>(goal.scorerId < LIVE_MAX_PLAYERS ? goal.scorerId : 0xFF);
+		entry.team = goal.team;
+		entry.isOvertime = goal.isOvertime;
+		entry.clockSeconds = goal.clockSeconds;
+		entry.overtimeSeconds = goal.overtimeSeconds;
+		entry.elapsedMs = goal.elapsedMs;
+		entry.tick = goal.tick;
+	});
+}
+
+void StatPullerCore::PublishPhase()
+{
+	liveFile.Update([this](LiveMatchData& live) {
+		live.phase = static_cast<uint8_t>(matchState.Phase());
+		live.outcome = static_cast<uint8_t>(matchState.Outcome());
+	});
+}
+
+void StatPullerCore::UpdateClock() {
+	const MatchClockState state = host.GetClockState();
+	clock.OnClockUpdated(state, host.ClockNow());
+	matchState.OnClockUpdated(state);
+
+	if (IsRecording()) {
+		PublishClock(clock.Read(state, host.ClockNow()));
+	}
+}
+
+// Writes next to the target and renames over it, so readers only ever see a
+// complete file. The rename is also the event to watch for a new match.
+bool StatPullerCore::SaveMatchDataToFile(const json& wrapped, ExportFormat format) {
+	const std::string basePath = outputDirectory + "last-match-stats";
+	const std::string path = basePath + ExportFormatExtension(format);
+	const std::string tempPath = path + ".tmp";
+
+	const std::vector<uint8_t> encoded = EncodeMatchDocument(wrapped, format);
+
+	std::ofstream file(tempPath, std::ofstream::binary | std::ofstream::trunc);
+	file.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+	file.flush();
+	const bool isWritten = file.good();
+	file.close();
+
+	std::error_code ec;
+	if (!isWritten || file.fail()) {
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+
+	std::filesystem::rename(tempPath, path, ec);
+	if (ec) {
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+
+	// consumers pick the format by extension, so don't leave another one behind
+	for (int i = 0; i < EXPORT_FORMAT_COUNT; i++)
+	{
+		const char* extension = ExportFormatExtension(static_cast<ExportFormat>(i));
+		if (std::string(extension) != ExportFormatExtension(format)) {
+			std::filesystem::remove(basePath + extension, ec);
+		}
+	}
+	return true;
+}
+
+bool StatPullerCore::OpenMatchLog()
+{
+	if (matchLog.IsOpen()) return true;
+
+	const std::string path = outputDirectory + "match-history.splog";
+	if (!matchLog.Open(path)) {
+		SP_LOG_ERROR(logger, "Could not open match history {}", path);
+		return false;
+	}
+	return true;
+}
+
+void StatPullerCore::AppendToMatchLog(const json& wrapped)
+{
+	if (!OpenMatchLog()) return;
+
+	if (!matchLog.Append(json::to_cbor(wrapped))) {
+		SP_LOG_ERROR(logger, "Could not append to match history.");
+		matchLog.Close();
+	}
+}
+
+bool StatPullerCore::OpenHistory()
+{
+	if (history.IsOpen()) return true;
+
+	const std::string path = outputDirectory + "match-history.spcol";
+	if (!history.Open(path, true)) {
+		SP_LOG_ERROR(logger, "Could not open history store {}", path);
+		return false;
+	}
+	if (history.Count() > 0) return true;
+
+	// a new store starts from every match already in the log
+	MatchLogReader log;
+	if (!log.Open(outputDirectory + "match-history.splog")) return true;
+
+	size_t added = 0;
+	log.ForEach([this, &added](size_t, const MatchRecordView& record) {
+		HistoryRow row;
+		if (HistoryRowFromDocument(MatchLogReader::Parse(record), row) && history.Append(row)) added++;
+	});
+	SP_LOG_INFO(logger, "History store built from {} of {} logged matches.", added, log.Count());
+	return true;
+}
+
+void StatPullerCore::AppendToHistory(const json& document)
+{
+	if (!OpenHistory()) return;
+
+	HistoryRow row;
+	if (!HistoryRowFromDocument(document, row)) return;
+
+	if (!history.Append(row)) {
+		SP_LOG_ERROR(logger, "Could not append to the history store.");
+		history.Close();
+	}
+}
+
+// Only stops the recording here, match end is when the post-game screen
+// loads. Writing the replay takes long enough to stall a frame, so the
+// flusher does that off the game thread.
+void StatPullerCore::TrySaveReplay(const std::string& label)
+{
+	if (pendingReplay) {
+		pendingReplay->set_value(ReplayResult());
+	}
+
+	pendingReplay = std::make_shared<std::promise<ReplayResult>>();
+	replayResult = pendingReplay->get_future().share();
+
+	if (!host.StopReplayRecording())
+	{
+		SP_LOG_INFO(logger, "No replay to save for the {} match.", label);
+		pendingReplay->set_value(ReplayResult());
+		pendingReplay.reset();
+		return;
+	}
+
+	host.SetTimeout([this] {
+		CaptureReplay();
+	}, REPLAY_CAPTURE_DELAY);
+}
+
+void StatPullerCore::CaptureReplay()
+{
+	if (!pendingReplay) return;
+
+	ReplayPromise done = std::move(pendingReplay);
+	pendingReplay.reset();
+
+	const std::string replayPath = outputDirectory + "last-match-replay.replay";
+	// a new name per capture, the previous replay may still be waiting to flush
+	const std::string tempPath = replayPath + "." + std::to_string(++replayCaptures) + ".tmp";
+
+	IGameHost::ReplayHandle replay = host.TakeReplay();
+	if (!replay) {
+		done->set_value(ReplayResult());
+		return;
+	}
+
+	replayFlusher.Flush([this, replay](const std::string& path) {
+		return host.WriteReplay(replay, path);
+	}, tempPath, replayPath, std::move(done));
+}
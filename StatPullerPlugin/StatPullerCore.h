@@ -0,0 +1,166 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include "json.hpp"
+using json = nlohmann::json;
+
+#include "GameHost.h"
+#include "ClipQueue.h"
+#include "ExportFormat.h"
+#include "ExportWorker.h"
+#include "HistoryStore.h"
+#include "HookDispatcher.h"
+#include "LiveMatchFile.h"
+#include "Logger.h"
+#include "MatchEvents.h"
+#include "MatchClock.h"
+#include "MatchLog.h"
+#include "MatchState.h"
+#include "MatchSummary.h"
+#include "SessionAggregator.h"
+#include "MmrTracker.h"
+#include "PlayerStats.h"
+#include "PlayerTable.h"
+#include "PlaylistPolicy.h"
+#include "ReplayArchive.h"
+#include "ReplayFlusher.h"
+#include "SampleRing.h"
+#include "StatEventLog.h"
+#include "StatsServer.h"
+
+// Match tracking and export, independent of BakkesMod. The plugin wires it
+// to the game through BakkesModHost.
+class StatPullerCore : public IHookHandler
+{
+public:
+    // outputDirectory is where match files and replays are written, with a
+    // trailing separator
+    StatPullerCore(IGameHost& host, std::string outputDirectory);
+    ~StatPullerCore();
+
+    void Start();
+    void Stop();
+
+    void OnMatchStarted();
+    void OnGameComplete(MatchEndReason reason);
+    void OnStatTickerMessage(const StatTickerEvent& event);
+    void UpdateClock();
+
+    // takes effect for matches that end after the call
+    void SetExportFormat(ExportFormat format) { exportFormat = format; }
+
+    // goals scored within this many seconds of each other are clipped together
+    void SetClipWindow(float seconds) { clipQueue.SetWindow(seconds); }
+
+    // takes effect from the next match in that playlist
+    void SetCaptureLevel(int playlistId, CaptureLevel level) { playlistCapture.SetLevel(playlistId, level); }
+
+    // SampleFields to record each clock update, 0 for none; takes effect
+    // from the next match
+    void SetSampleFields(uint32_t fields) { sampleFields = fields; }
+
+    // the summary is always built in process, build_summary.py only runs
+    // when this is on
+    void SetSummaryScript(bool isEnabled) { isSummaryScriptEnabled = isEnabled; }
+
+    // (re)starts the local stats server on 127.0.0.1:port, 0 stops it
+    void SetServerPort(uint16_t port);
+
+    // archived replays past either limit are dropped after the next match
+    // is archived, 0 for no limit
+    void SetReplayRetention(uint64_t maxMegabytes, int maxAgeDays);
+
+    HookDispatcher& Hooks() { return hooks; }
+
+private:
+    void LoadHooks();
+    void OnHook(HookId id, const StatTickerEvent* ticker) override;
+
+    void OnGoal(const PlayerRef& scorer, uint16_t scorerId, const ClockReading& reading);
+    uint16_t InternPlayer(const PlayerRef& player);
+    void CapturePlayerStats();
+    void EndSummary(MatchOutcome outcome);
+    void SampleMatch();
+
+    void PublishMatchStart();
+    void PublishClock(const ClockReading& reading);
+    void PublishStatEvent(StatEventType type, uint16_t playerId, const PlayerRef& player);
+    void PublishGoal(const GoalEvent& goal);
+    void PublishPhase();
+    void ScheduleClipCheck();
+    void FlushClips(bool isForced);
+
+    void ExportMatch(MatchSnapshot& snapshot);
+    json BuildMatchDocument(const MatchSnapshot& snapshot);
+    bool SaveMatchDataToFile(const json& wrapped, ExportFormat format);
+    bool OpenMatchLog();
+    void AppendToMatchLog(const json& wrapped);
+    bool OpenHistory();
+    void AppendToHistory(const json& document);
+    void ArchiveReplay(const std::string& replayPath, const MatchSnapshot& snapshot);
+
+    void TrySaveReplay(const std::string& label);
+    void CaptureReplay();
+
+    IGameHost& host;
+    const std::string outputDirectory;
+
+    // declared before everything that logs, so it outlives them
+    Logger logger;
+
+    HookDispatcher hooks;
+
+    ExportWorker exportWorker;
+    ReplayFlusher replayFlusher;
+    // only touched on the export worker
+    MatchLogWriter matchLog;
+    uint64_t exportSequence = 0;
+    bool isSequenceSeeded = false;
+    uint64_t lastExportedMatchId = 0;
+    HistoryStore history;
+    SessionAggregator session;
+    ReplayArchive replayArchive;
+    // set on the game thread, read on the export worker
+    std::atomic<uint64_t> replayArchiveMaxBytes{ static_cast<uint64_t>(REPLAY_ARCHIVE_MAX_MB) << 20 };
+    std::atomic<int64_t> replayArchiveMaxAgeMs{ static_cast<int64_t>(REPLAY_ARCHIVE_MAX_DAYS) * 86400000 };
+
+    GoalBuffer goalEvents;
+    ClipQueue clipQueue;
+    bool isClipCheckPending = false;
+    IGameHost::TimePoint clipCheckAt;
+    StatEventLog eventLog;
+    StatEventTable statEvents;
+    PlayerTable players;
+    // scoreboard as it stood when the match ended
+    PlayerStatTable playerStats;
+    SampleRing samples;
+    MatchSummary summary;
+    uint32_t sampleFields = SampleScore | SampleBoost | SampleBallPosition | SamplePossession;
+
+    // set from match end until the game has written the replay
+    ReplayPromise pendingReplay;
+    std::shared_future<ReplayResult> replayResult;
+    uint64_t replayCaptures = 0;
+
+    MmrTracker mmrTracker;
+    std::shared_future<MmrResult> mmrResult;
+
+    MatchClock clock;
+    int playlist = -1;
+    PlaylistCapture playlistCapture;
+    CaptureLevel captureLevel = CaptureLevel::Off;     // of the match in progress
+
+    ExportFormat exportFormat = ExportFormat::Json;
+    bool isSummaryScriptEnabled = true;
+
+    MatchState matchState;
+    // mirror of the match in progress for overlays, see LiveMatchLayout.h
+    LiveMatchFile liveFile;
+    // pushes goals and exports to local subscribers, see StatsServer.h
+    StatsServer server;
+
+    // events are only recorded for an active match that is captured
+    bool IsRecording() const { return matchState.IsActive() && captureLevel != CaptureLevel::Off; }
+};
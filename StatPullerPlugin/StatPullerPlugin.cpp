@@ -1,252 +1,199 @@
 #include "pch.h"  
 #include "StatPullerPlugin.h"  
 
-#include <fstream>
-#include "json.hpp"
-using json = nlohmann::json;
-
-#include <filesystem>
-namespace fs = std::filesystem;
-
-#include "bakkesmod/wrappers/MMRWrapper.h"
-
-#include <chrono>
-#include <iomanip>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <sstream>
 
-#include <windows.h>
-#include <shellapi.h>
-#include <thread>
-
-#include <set>
-
-// version:
-// major: changes to exported .json data structure, new data fields
-// minor: patch, bug fixes, small changes
-#define STAT_PULLER_VERSION "5.0"
-
-// full file path to python script ex: "C:\\Users\\(user)\\Desktop\\StatPuller-Build-Match-Summary\\"
-#define PYTHON_SCRIPT_PATH "C:\\Users\\harri\\Desktop\\StatPuller-Build-Match-Summary\\"
+#include "HistoryStore.h"
+#include "StatPullerConfig.h"
 
 BAKKESMOD_PLUGIN(StatPullerPlugin, "Stat Puller Plugin", STAT_PULLER_VERSION, PERMISSION_ALL)
 
 void StatPullerPlugin::onLoad() {
 	this->Log("StatPullerPlugin: Loaded Successfully!");
 
-	this->LoadHooks();
-}
-
-void StatPullerPlugin::onUnload() 
-{
+	host = std::make_unique<BakkesModHost>(gameWrapper, cvarManager, PYTHON_SCRIPT_PATH);
+
+	core = std::make_unique<StatPullerCore>(*host, PYTHON_SCRIPT_PATH);
+	core->Start();
+
+	CVarWrapper exportFormat = cvarManager->registerCvar("statpuller_export_format", "json",
+		"Match file format: json, json-compact, cbor, msgpack or bson");
+	exportFormat.addOnValueChanged([this](std::string, CVarWrapper cvar) {
+		ApplyExportFormat(cvar.getStringValue());
+	});
+	ApplyExportFormat(exportFormat.getStringValue());
+
+	CVarWrapper clipWindow = cvarManager->registerCvar("statpuller_clip_window", "10",
+		"Seconds of goals to collect into one clip.py run, 0 clips every goal on its own", true, true, 0, true, 300);
+	clipWindow.addOnValueChanged([this](std::string, CVarWrapper cvar) {
+		core->SetClipWindow(cvar.getFloatValue());
+	});
+	core->SetClipWindow(clipWindow.getFloatValue());
+
+	CVarWrapper sampleFields = cvarManager->registerCvar("statpuller_sample_fields", DEFAULT_SAMPLE_FIELDS,
+		"Fields sampled every clock update: any of score, boost, position, ball, possession, or none");
+	sampleFields.addOnValueChanged([this](std::string, CVarWrapper cvar) {
+		ApplySampleFields(cvar.getStringValue());
+	});
+	ApplySampleFields(sampleFields.getStringValue());
+
+	for (const PlaylistPolicy& policy : PLAYLIST_POLICIES)
+	{
+		const int playlistId = policy.id;
+		CVarWrapper capture = cvarManager->registerCvar(std::string("statpuller_capture_") + policy.name, CaptureLevelName(policy.capture),
+			"What to capture in this playlist: off, basic, or full (adds in-match sampling and the replay archive)");
+		capture.addOnValueChanged([this, playlistId](std::string, CVarWrapper cvar) {
+			ApplyCaptureLevel(playlistId, cvar.getStringValue());
+		});
+		ApplyCaptureLevel(playlistId, capture.getStringValue());
+	}
 
+	CVarWrapper summaryScript = cvarManager->registerCvar("statpuller_summary_script", "1",
+		"Run build_summary.py after each match, the summary in the match file is built either way", true, true, 0, true, 1);
+	summaryScript.addOnValueChanged([this](std::string, CVarWrapper cvar) {
+		core->SetSummaryScript(cvar.getBoolValue());
+	});
+	core->SetSummaryScript(summaryScript.getBoolValue());
+
+	CVarWrapper serverPort = cvarManager->registerCvar("statpuller_server_port", "0",
+		"Port for the local stats server on 127.0.0.1 (/match, /history, /events WebSocket), 0 turns it off", true, true, 0, true, 65535);
+	serverPort.addOnValueChanged([this](std::string, CVarWrapper cvar) {
+		core->SetServerPort(static_cast<uint16_t>(cvar.getIntValue()));
+	});
+	core->SetServerPort(static_cast<uint16_t>(serverPort.getIntValue()));
+
+	CVarWrapper archiveSize = cvarManager->registerCvar("statpuller_replay_archive_mb", std::to_string(REPLAY_ARCHIVE_MAX_MB),
+		"Space the replay archive may take in MB, the oldest replays go first, 0 for no limit", true, true, 0);
+	CVarWrapper archiveAge = cvarManager->registerCvar("statpuller_replay_archive_days", std::to_string(REPLAY_ARCHIVE_MAX_DAYS),
+		"Days archived replays are kept, 0 keeps them all", true, true, 0);
+	auto applyRetention = [this](std::string, CVarWrapper) {
+		ApplyReplayRetention();
+	};
+	archiveSize.addOnValueChanged(applyRetention);
+	archiveAge.addOnValueChanged(applyRetention);
+	ApplyReplayRetention();
+
+	cvarManager->registerNotifier("statpuller_hook_stats", [this](std::vector<std::string> args) {
+		LogHookStats(args.size() > 1 && args[1] == "reset");
+	}, "Logs call counts and handler time per game hook. Usage: statpuller_hook_stats [reset]", PERMISSION_ALL);
+
+	cvarManager->registerNotifier("statpuller_history", [this](std::vector<std::string> args) {
+		LogHistory(args.size() > 1 ? args[1] : "all", args.size() > 2 ? std::atoi(args[2].c_str()) : 0);
+	}, "Logs win rate, streaks, MMR and goals by minute from the match history. Usage: statpuller_history [playlist|all] [last matches]", PERMISSION_ALL);
 }
 
-void StatPullerPlugin::LoadHooks() 
+void StatPullerPlugin::onUnload() 
 {
-	gameWrapper->HookEvent("Function TAGame.GameEvent_Soccar_TA.OnAllTeamsCreated", std::bind(&StatPullerPlugin::OnMatchStarted, this, std::placeholders::_1));
-
-	gameWrapper->HookEventWithCaller<ServerWrapper>(
-		"Function TAGame.GameEvent_Soccar_TA.EventMatchEnded",
-		std::bind(&StatPullerPlugin::OnGameComplete,
-			this,
-			std::placeholders::_1,
-			std::placeholders::_2,
-			std::placeholders::_3)
-	);
-
-	gameWrapper->HookEventWithCaller<ServerWrapper>(
-		"Function TAGame.GameEvent_Soccar_TA.Destroyed",
-		std::bind(&StatPullerPlugin::OnGameComplete,
-			this,
-			std::placeholders::_1,
-			std::placeholders::_2,
-			std::placeholders::_3)
-	);
-
-	gameWrapper->HookEventWithCallerPost<ServerWrapper>(
-		"Function TAGame.GFxHUD_TA.HandleStatTickerMessage",
-		[this](ServerWrapper caller, void* params, std::string eventname) {
-			onStatTickerMessage(params);
-		});
-
-	gameWrapper->HookEvent(
-		"Function TAGame.GameEvent_Soccar_TA.OnGameTimeUpdated",
-		[this](std::string eventName) {
-			UpdateClock();
-		}
-	);
+	// the core's export worker may still be using the host
+	core.reset();
+	host.reset();
 }
 
-void StatPullerPlugin::OnMatchStarted(std::string eventName)
+// Opens its own read-only copy of the store, the export worker keeps
+// appending to the plugin's.
+void StatPullerPlugin::LogHistory(const std::string& playlistName, int lastMatches)
 {
-	simulatedClock = 300;
-	goalEvents.clear();
+	HistoryStore history;
+	if (!history.Open(std::string(PYTHON_SCRIPT_PATH) + "match-history.spcol", false)) {
+		Log("StatPuller: No match history yet.");
+		return;
+	}
 
-	gameWrapper->SetTimeout([this](GameWrapper*) 
+	HistoryFilter filter;
+	filter.lastMatches = lastMatches > 0 ? static_cast<size_t>(lastMatches) : 0;
+	if (playlistName != "all")
 	{
-		if (!gameWrapper->IsInOnlineGame() || gameWrapper->IsInReplay())
-		{
-			Log("StatPuller: Ignored OnMatchStarted because it's not an online match.");
-			return;
+		for (const PlaylistPolicy& policy : PLAYLIST_POLICIES) {
+			if (playlistName == policy.name) filter.playlist = policy.id;
 		}
-
-		ServerWrapper game = gameWrapper->GetOnlineGame();
-		playlist = game.GetPlaylist().GetPlaylistId();
-
-		if (playlist != 10 && playlist != 11 ) {
-			Log("StatPuller: Not ranked 1v1 nor 2v2. Skipping.");
+		if (filter.playlist < 0) {
+			Log("StatPuller: Unknown playlist '" + playlistName + "', use a statpuller_capture_ suffix or all.");
 			return;
 		}
+	}
 
-		isReplaySaved = false;
-		isMatchInProgress = true;
-		wasEarlyExit = false;
-		mmrBefore = -1;
-		mmrAfter = -1;
-
-		gameWrapper->SetTimeout([this](GameWrapper*) 
-		{
-			const UniqueIDWrapper uid = gameWrapper->GetUniqueID();
-			mmrBefore = gameWrapper->GetMMRWrapper().GetPlayerMMR(uid, playlist);
-		}, 1.0f);
-
-		Log("StatPuller: Match has started.");
-	}, 3.0f);
-}
+	const std::vector<uint32_t> rows = history.Select(filter);
+	const HistorySummary summary = history.Summarize(rows);
 
-void StatPullerPlugin::OnGameComplete(ServerWrapper server,
-	void*,
-	std::string eventName)
-{
-	if (!isMatchInProgress || isReplaySaved || (gameWrapper->IsInReplay())) return;
+	char line[256];
+	snprintf(line, sizeof(line), "%s: %zu matches, %zu-%zu (%.1f%%), goals %llu-%llu, MMR %d -> %d",
+		playlistName.c_str(), summary.matches, summary.wins, summary.losses, summary.winRate * 100.0,
+		static_cast<unsigned long long>(summary.goalsFor), static_cast<unsigned long long>(summary.goalsAgainst), summary.firstMmr, summary.lastMmr);
+	Log(line);
 
-	if (playlist != 10 && playlist != 11) return;
+	snprintf(line, sizeof(line), "Streaks: longest %d wins, %d losses, current %+d", summary.longestWinStreak, summary.longestLossStreak, summary.currentStreak);
+	Log(line);
 
-	isReplaySaved = true;
-	isMatchInProgress = false;
-
-	TrySaveReplay(server, wasEarlyExit ? "early-exit" : "match-end");
+	const GoalsByMinute minutes = history.GoalsPerMinute(rows);
+	std::string goals = "Goals by minute (for/against):";
+	for (int i = 0; i < HISTORY_MINUTES; i++) {
+		goals += (i < 5 ? " " + std::to_string(i + 1) : " OT" + std::to_string(i - 4) + (i == HISTORY_MINUTES - 1 ? "+" : "")) + ": "
+			+ std::to_string(minutes.goalsFor[i]) + "/" + std::to_string(minutes.goalsAgainst[i]);
+	}
+	Log(goals);
 
-	gameWrapper->SetTimeout([this](GameWrapper*) 
+	for (const MmrBucket& bucket : history.WinRateByMmr(rows, 100))
 	{
-		mmrAfter = gameWrapper->GetMMRWrapper().GetPlayerMMR(gameWrapper->GetUniqueID(), playlist);
-		json localMatchStats;
-		localMatchStats["Version"] = STAT_PULLER_VERSION;
-		localMatchStats["MMR_Before"] = mmrBefore;
-		localMatchStats["MMR_After"] = mmrAfter;
-		localMatchStats["Goals"] = goalEvents;
-		localMatchStats["Playlist"] = playlist;
-
-		SaveMatchDataToFile(localMatchStats);
-		RunPythonScript("build_summary.py");
-
-		Log("StatPuller: Match data saved and uploaded.");
-	}, 0.2f);
-
-
+		snprintf(line, sizeof(line), "  MMR %d-%d: %zu matches, %.1f%% won", bucket.mmr, bucket.mmr + 99, bucket.matches, 100.0 * bucket.wins / bucket.matches);
+		Log(line);
+	}
 }
 
-void StatPullerPlugin::onStatTickerMessage(void* params)
+void StatPullerPlugin::LogHookStats(bool isReset)
 {
-	StatTickerParams* pStruct = (StatTickerParams*)params;
-	StatEventWrapper statEvent = StatEventWrapper(pStruct->StatEvent);
-	PriWrapper receiver = PriWrapper(pStruct->Receiver);
-
-
-	if (statEvent.GetEventName() == "Goal") 
-	{
-		if (!isMatchInProgress) {
-			Log("StatPuller: Not an online game.");
-			return;
-		}
-
-		if (!receiver || receiver.IsNull()) 
-		{
-			Log("StatPuller: Receiver PRI is null.");
-			return;
-		}
-
-		std::string scorerName = receiver.GetPlayerName().ToString();
-		int teamNum = receiver.GetTeamNum(); // 0 = blue, 1 = orange
-		Log("Goal scored by: " + scorerName + " on team " + std::to_string(teamNum) + " at " + std::to_string(simulatedClock));
-
-		json goal;
-		goal["ScorerName"] = scorerName;
-		goal["ScorerTeam"] = teamNum;
-		goal["GoalTimeSeconds"] = simulatedClock;
-
-		goalEvents.push_back(goal);
+	Log(isReset ? "Hook handler times (now reset):" : "Hook handler times:");
 
-		if (receiver.IsLocalPlayerPRI())
-		{
-			gameWrapper->SetTimeout([this](GameWrapper*)
-				{
-					RunPythonScript("clip.py");
-					Log("StatPuller: Local player scored. Clipping.");
-				}, 2.0f);
-		}
+	std::istringstream report(core->Hooks().FormatCounters());
+	std::string line;
+	while (std::getline(report, line)) {
+		Log(line);
 	}
-}
-
-void StatPullerPlugin::UpdateClock() {  
-	simulatedClock -= 1;
-}
 
-void StatPullerPlugin::SaveMatchDataToFile(const json& wrapped) {
-	std::string folder = PYTHON_SCRIPT_PATH;
-	std::string path = folder + "last-match-stats.json";
-	std::ofstream file(path, std::ofstream::trunc);
-	file << wrapped.dump(4);
-	file.close();
+	if (isReset) {
+		core->Hooks().ResetCounters();
+	}
 }
 
-void StatPullerPlugin::TrySaveReplay(ServerWrapper server, const std::string& label)
+void StatPullerPlugin::ApplyExportFormat(const std::string& name)
 {
-	if (server.IsNull()) {
-		Log("TrySaveReplay: Server is null, skipping replay save.");
+	ExportFormat format;
+	if (!ParseExportFormat(name, format)) {
+		Log("StatPuller: Unknown export format '" + name + "', keeping the current one.");
 		return;
 	}
+	core->SetExportFormat(format);
+}
 
-	ReplayDirectorWrapper replayDirector = server.GetReplayDirector();
-	if (replayDirector.IsNull()) {
-		Log("TrySaveReplay: ReplayDirector is null.");
+void StatPullerPlugin::ApplySampleFields(const std::string& names)
+{
+	uint32_t fields;
+	if (!ParseSampleFields(names, fields)) {
+		Log("StatPuller: Unknown sample field in '" + names + "', keeping the current ones.");
 		return;
 	}
+	core->SetSampleFields(fields);
+}
 
-	ReplaySoccarWrapper soccarReplay = replayDirector.GetReplay();
-	if (soccarReplay.memory_address == NULL) {
-		Log("TrySaveReplay: Replay object is null.");
+void StatPullerPlugin::ApplyCaptureLevel(int playlistId, const std::string& name)
+{
+	CaptureLevel level;
+	if (!ParseCaptureLevel(name, level)) {
+		Log("StatPuller: Unknown capture level '" + name + "' for playlist " + std::to_string(playlistId) + ", keeping the current one.");
 		return;
 	}
-
-	soccarReplay.StopRecord();
-
-	std::string replayName = "last-match-replay";
-	std::string replayPath = fs::path(PYTHON_SCRIPT_PATH + replayName + ".replay").string();
-
-	soccarReplay.ExportReplay(replayPath);
-
-	Log("StatPuller: Replay saved successfully: " + replayPath);
+	core->SetCaptureLevel(playlistId, level);
 }
 
-void StatPullerPlugin::RunPythonScript(const std::string& scriptFileName) {
-	std::string scriptPath = "\"" + std::string(PYTHON_SCRIPT_PATH) + scriptFileName + "\"";
-	std::wstring wScriptPath(scriptPath.begin(), scriptPath.end());
-	Log("Calling Python script: " + scriptPath);
-
-	std::thread([wScriptPath] {
-
-		ShellExecute(
-			nullptr,
-			L"open",
-			L"pythonw.exe",
-			wScriptPath.c_str(),
-			nullptr,
-			SW_HIDE
-		);
-		}).detach();
+void StatPullerPlugin::ApplyReplayRetention()
+{
+	const int maxMegabytes = cvarManager->getCvar("statpuller_replay_archive_mb").getIntValue();
+	const int maxAgeDays = cvarManager->getCvar("statpuller_replay_archive_days").getIntValue();
+	core->SetReplayRetention(static_cast<uint64_t>(std::max(maxMegabytes, 0)), std::max(maxAgeDays, 0));
 }
 
 void StatPullerPlugin::Log(std::string msg) {
 	cvarManager->log(msg);
-}
\ No newline at end of file
+}
@@ -1,23 +1,13 @@
 #pragma once  
 
 #include "bakkesmod/plugin/bakkesmodplugin.h"  
-#include "bakkesmod/wrappers/GameObject/Stats/StatEventWrapper.h"   
 
-#include "json.hpp"  
-using json = nlohmann::json;  
+#include <memory>
 
-#pragma comment ( lib, "pluginsdk.lib" )  
-
-struct StatTickerParams {  
-    uintptr_t Receiver;  
-    uintptr_t Victim;  
-    uintptr_t StatEvent;  
-};  
+#include "BakkesModHost.h"
+#include "StatPullerCore.h"
 
-struct StatEventParams {  
-    uintptr_t PRI;  
-    uintptr_t StatEvent;  
-};  
+#pragma comment ( lib, "pluginsdk.lib" )  
 
 class StatPullerPlugin : public BakkesMod::Plugin::BakkesModPlugin  
 {  
@@ -25,33 +15,15 @@ public:
     virtual void onLoad() override;  
     virtual void onUnload() override;  
 
-    void LoadHooks();  
-
-    void OnMatchStarted(std::string eventName);  
-    void OnGameComplete(ServerWrapper server,  
-        void* params,  
-        std::string   eventName);  
-
-    void onStatTickerMessage(void* params);  
-    void UpdateClock();
-
-    void SaveMatchDataToFile(const json& wrapped);  
-    void RunPythonScript(const std::string& scriptFileName);
-
-    void TrySaveReplay(ServerWrapper server, const std::string& label);
-
 private:  
+    void LogHookStats(bool isReset);
+    void LogHistory(const std::string& playlistName, int lastMatches);
+    void ApplyExportFormat(const std::string& name);
+    void ApplySampleFields(const std::string& names);
+    void ApplyCaptureLevel(int playlistId, const std::string& name);
+    void ApplyReplayRetention();
     void Log(std::string msg);  
 
-    std::vector<json> goalEvents;
-
-    int mmrAfter = -1;  
-    int mmrBefore = -1;  
-
-    int simulatedClock = 300;
-    int playlist = -1;
-
-    bool isReplaySaved = false;  
-    bool wasEarlyExit = false;  
-    bool isMatchInProgress = false;  
+    std::unique_ptr<BakkesModHost> host;
+    std::unique_ptr<StatPullerCore> core;
 };
@@ -0,0 +1,594 @@
+#include "pch.h"
+#include "StatsServer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include "MatchLog.h"
+#include "MatchState.h"
+#include "WebSocket.h"
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+// a dead peer must not kill the game with SIGPIPE
+#ifdef MSG_NOSIGNAL
+#define SERVER_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SERVER_SEND_FLAGS 0
+#endif
+
+// the loop also wakes this often to notice Stop if a wake was lost
+#define SERVER_POLL_MS 250
+#define SERVER_READ_CHUNK 4096
+
+StatsServer::~StatsServer()
+{
+	Stop();
+}
+
+static SocketHandle OpenLoopbackSocket(int type, uint16_t port, uint16_t& boundPort)
+{
+	SocketHandle handle = socket(AF_INET, type, 0);
+	if (handle == INVALID_SOCKET_HANDLE) return INVALID_SOCKET_HANDLE;
+
+	if (type == SOCK_STREAM)
+	{
+		// Windows lets SO_REUSEADDR bind over a port another process is
+		// listening on, so there the port is claimed exclusively instead;
+		// elsewhere it only skips TIME_WAIT after a restart
+		const int isSet = 1;
+#ifdef _WIN32
+		setsockopt(handle, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, reinterpret_cast<const char*>(&isSet), sizeof(isSet));
+#else
+		setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&isSet), sizeof(isSet));
+#endif
+	}
+
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons(port);
+
+	socklen_t length = sizeof(address);
+	if (bind(handle, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+		|| getsockname(handle, reinterpret_cast<sockaddr*>(&address), &length) != 0
+		|| !SetNonBlocking(handle))
+	{
+		CloseSocket(handle);
+		return INVALID_SOCKET_HANDLE;
+	}
+
+	boundPort = ntohs(address.sin_port);
+	return handle;
+}
+
+bool StatsServer::Start(uint16_t port, std::string liveMatchPath, std::string historyPath)
+{
+	if (IsRunning()) return true;
+	// a loop that gave up still has its thread and sockets
+	Stop();
+	if (!InitSockets()) return false;
+
+	this->liveMatchPath = std::move(liveMatchPath);
+	this->historyPath = std::move(historyPath);
+
+	poller = std::make_unique<EventPoller>();
+	listener = OpenLoopbackSocket(SOCK_STREAM, port, boundPort);
+
+	uint16_t wakerPort = 0;
+	waker = OpenLoopbackSocket(SOCK_DGRAM, 0, wakerPort);
+
+	sockaddr_in self{};
+	self.sin_family = AF_INET;
+	self.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	self.sin_port = htons(wakerPort);
+
+	const bool isReady = poller->IsValid()
+		&& listener != INVALID_SOCKET_HANDLE && listen(listener, SOMAXCONN) == 0
+		&& waker != INVALID_SOCKET_HANDLE && connect(waker, reinterpret_cast<sockaddr*>(&self), sizeof(self)) == 0
+		&& poller->Add(listener, false) && poller->Add(waker, false);
+
+	if (!isReady)
+	{
+		if (listener != INVALID_SOCKET_HANDLE) CloseSocket(listener);
+		if (waker != INVALID_SOCKET_HANDLE) CloseSocket(waker);
+		listener = waker = INVALID_SOCKET_HANDLE;
+		poller.reset();
+		boundPort = 0;
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		isRunning = true;
+	}
+	thread = std::thread(&StatsServer::Run, this);
+	return true;
+}
+
+void StatsServer::Stop()
+{
+	if (!thread.joinable()) return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		isRunning = false;
+		Wake();
+	}
+	thread.join();
+
+	for (auto& entry : connections) {
+		CloseSocket(entry.first);
+	}
+	connections.clear();
+	history.clear();
+	liveMatch.Close();
+	subscriberCount = 0;
+
+	CloseSocket(listener);
+	listener = INVALID_SOCKET_HANDLE;
+	poller.reset();
+	boundPort = 0;
+
+	// publishers check isRunning and send to the waker under mutex
+	std::lock_guard<std::mutex> lock(mutex);
+	CloseSocket(waker);
+	waker = INVALID_SOCKET_HANDLE;
+	pending.clear();
+	isWakePending = false;
+}
+
+void StatsServer::Publish(const char* type, json data)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!IsRunning()) return;
+
+	if (pending.size() >= SERVER_MAX_PENDING_EVENTS) pending.erase(pending.begin());
+	pending.push_back(PendingEvent{ type, std::move(data), false });
+
+	// one wake per batch, the loop takes everything queued
+	if (isWakePending) return;
+	isWakePending = true;
+	Wake();
+}
+
+void StatsServer::PublishMatch(const json& document)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!IsRunning()) return;
+
+	if (pending.size() >= SERVER_MAX_PENDING_EVENTS) pending.erase(pending.begin());
+	pending.push_back(PendingEvent{ "match-end", document, true });
+
+	if (isWakePending) return;
+	isWakePending = true;
+	Wake();
+}
+
+void StatsServer::Wake()
+{
+	const char byte = 0;
+	send(waker, &byte, 1, SERVER_SEND_FLAGS);
+}
+
+void StatsServer::DrainWaker()
+{
+	char bytes[64];
+	while (recv(waker, bytes, sizeof(bytes), 0) > 0) {}
+}
+
+void StatsServer::Run()
+{
+	SeedHistory();
+
+	std::vector<PollEvent> events;
+	while (isRunning.load(std::memory_order_relaxed))
+	{
+		if (!poller->Wait(events, SERVER_POLL_MS))
+		{
+			// nothing would take what publishers queue from here on
+			std::lock_guard<std::mutex> lock(mutex);
+			isRunning = false;
+			pending.clear();
+			isWakePending = false;
+			break;
+		}
+
+		for (const PollEvent& event : events)
+		{
+			if (event.socket == listener) {
+				Accept();
+				continue;
+			}
+			if (event.socket == waker) {
+				DrainWaker();
+				continue;
+			}
+
+			auto it = connections.find(event.socket);
+			if (it == connections.end()) continue;
+
+			bool isOpen = true;
+			if (event.isReadable || event.isClosed) {
+				isOpen = OnReadable(event.socket, it->second);
+			}
+			if (isOpen && event.isWritable) {
+				isOpen = Flush(event.socket, it->second);
+			}
+			if (!isOpen) {
+				Disconnect(event.socket);
+			}
+		}
+
+		Broadcast();
+	}
+}
+
+void StatsServer::SeedHistory()
+{
+	MatchLogReader log;
+	if (!log.Open(historyPath)) return;
+
+	const size_t count = log.Count();
+	for (size_t i = count > SERVER_HISTORY_MATCHES ? count - SERVER_HISTORY_MATCHES : 0; i < count; i++)
+	{
+		const MatchRecordView record = log.Get(i);
+		const json document = json::from_cbor(record.data, record.data + record.size, true, false);
+		if (document.is_discarded()) continue;
+
+		history.push_back(std::make_shared<const std::string>(document.dump()));
+	}
+}
+
+void StatsServer::Accept()
+{
+	while (true)
+	{
+		const SocketHandle client = accept(listener, nullptr, nullptr);
+		if (client == INVALID_SOCKET_HANDLE) return;
+
+		if (connections.size() >= SERVER_MAX_CONNECTIONS || !SetNonBlocking(client) || !poller->Add(client, false))
+		{
+			CloseSocket(client);
+			continue;
+		}
+		connections.emplace(client, Connection());
+	}
+}
+
+bool StatsServer::OnReadable(SocketHandle socket, Connection& connection)
+{
+	char chunk[SERVER_READ_CHUNK];
+	while (true)
+	{
+		const int received = static_cast<int>(recv(socket, chunk, sizeof(chunk), 0));
+		if (received > 0)
+		{
+			connection.input.append(chunk, received);
+			continue;
+		}
+		if (received == 0 || !IsWouldBlock()) return false;
+		break;
+	}
+
+	if (connection.isClosing) {
+		connection.input.clear();
+		return true;
+	}
+	if (connection.isWebSocket) {
+		return OnWebSocketFrames(socket, connection);
+	}
+	if (connection.input.size() > SERVER_MAX_REQUEST_BYTES) return false;
+	return OnHttpRequest(socket, connection);
+}
+
+static std::string HttpResponse(const char* status, const char* contentType, const std::string& body)
+{
+	std::string response = "HTTP/1.1 ";
+	response += status;
+	response += "\r\nContent-Type: ";
+	response += contentType;
+	response += "\r\nContent-Length: " + std::to_string(body.size());
+	response += "\r\nAccess-Control-Allow-Origin: *\r\nCache-Control: no-store\r\nConnection: close\r\n\r\n";
+	response += body;
+	return response;
+}
+
+static std::string Lowercase(std::string text)
+{
+	std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) {
+		return static_cast<char>(std::tolower(c));
+	});
+	return text;
+}
+
+bool StatsServer::OnHttpRequest(SocketHandle socket, Connection& connection)
+{
+	const size_t headerEnd = connection.input.find("\r\n\r\n");
+	if (headerEnd == std::string::npos) return true;
+
+	// request line, then headers; only the two the upgrade needs are kept
+	const std::string head = connection.input.substr(0, headerEnd + 2);
+	connection.input.erase(0, headerEnd + 4);
+
+	const size_t lineEnd = head.find("\r\n");
+	const std::string requestLine = head.substr(0, lineEnd);
+	const size_t methodEnd = requestLine.find(' ');
+	const size_t pathEnd = requestLine.find(' ', methodEnd + 1);
+	if (methodEnd == std::string::npos || pathEnd == std::string::npos) return false;
+
+	const std::string method = requestLine.substr(0, methodEnd);
+	std::string path = requestLine.substr(methodEnd + 1, pathEnd - methodEnd - 1);
+	path = path.substr(0, path.find('?'));
+
+	std::string upgrade;
+	std::string key;
+	for (size_t start = lineEnd + 2; start < head.size();)
+	{
+		const size_t end = head.find("\r\n", start);
+		const std::string line = head.substr(start, end - start);
+		start = end + 2;
+
+		const size_t colon = line.find(':');
+		if (colon == std::string::npos) continue;
+
+		const std::string name = Lowercase(line.substr(0, colon));
+		const size_t valueStart = line.find_first_not_of(' ', colon + 1);
+		const std::string value = valueStart == std::string::npos ? std::string() : line.substr(valueStart);
+
+		if (name == "upgrade") upgrade = Lowercase(value);
+		else if (name == "sec-websocket-key") key = value;
+	}
+
+	std::string response;
+	if (method != "GET") {
+		response = HttpResponse("405 Method Not Allowed", "text/plain", "GET only\n");
+	}
+	else if (path == "/events")
+	{
+		if (upgrade != "websocket" || key.empty()) {
+			response = HttpResponse("426 Upgrade Required", "text/plain", "/events is a WebSocket\n");
+		}
+		else
+		{
+			connection.isWebSocket = true;
+			subscriberCount++;
+
+			response = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: ";
+			response += WebSocketAccept(key);
+			response += "\r\n\r\n";
+
+			return Send(socket, connection, std::make_shared<const std::string>(std::move(response)))
+				&& OnWebSocketFrames(socket, connection);
+		}
+	}
+	else if (path == "/match")
+	{
+		const std::string body = MatchJson();
+		response = body.empty()
+			? HttpResponse("503 Service Unavailable", "application/json", "{\"Error\":\"no live match data\"}")
+			: HttpResponse("200 OK", "application/json", body);
+	}
+	else if (path == "/history") {
+		response = HttpResponse("200 OK", "application/json", HistoryJson());
+	}
+	else {
+		response = HttpResponse("404 Not Found", "text/plain", "try /match, /history or /events\n");
+	}
+
+	connection.isClosing = true;
+	connection.input.clear();
+	return Send(socket, connection, std::make_shared<const std::string>(std::move(response)));
+}
+
+bool StatsServer::OnWebSocketFrames(SocketHandle socket, Connection& connection)
+{
+	size_t offset = 0;
+	WebSocketFrame frame;
+
+	while (offset < connection.input.size())
+	{
+		const ptrdiff_t used = DecodeWebSocketFrame(connection.input.data() + offset, connection.input.size() - offset, frame);
+		if (used < 0) return false;
+		if (used == 0) break;
+		offset += static_cast<size_t>(used);
+
+		if (frame.opcode == WS_OPCODE_CLOSE)
+		{
+			// echo the status code back and close once it is sent
+			connection.isClosing = true;
+			connection.input.clear();
+			return Send(socket, connection, std::make_shared<const std::string>(EncodeWebSocketFrame(WS_OPCODE_CLOSE, frame.payload.substr(0, 2))));
+		}
+		if (frame.opcode == WS_OPCODE_PING)
+		{
+			if (!Send(socket, connection, std::make_shared<const std::string>(EncodeWebSocketFrame(WS_OPCODE_PONG, frame.payload)))) return false;
+		}
+		// the feed is one way, anything else from the client is ignored
+	}
+
+	connection.input.erase(0, offset);
+	return true;
+}
+
+bool StatsServer::Send(SocketHandle socket, Connection& connection, std::shared_ptr<const std::string> buffer)
+{
+	if (connection.queuedBytes + buffer->size() > SERVER_MAX_QUEUED_BYTES) return false;
+
+	connection.queuedBytes += buffer->size();
+	connection.output.push_back(std::move(buffer));
+	return Flush(socket, connection);
+}
+
+bool StatsServer::Flush(SocketHandle socket, Connection& connection)
+{
+	while (!connection.output.empty())
+	{
+		const std::string& buffer = *connection.output.front();
+		const int sent = static_cast<int>(send(socket, buffer.data() + connection.outputOffset,
+			static_cast<int>(buffer.size() - connection.outputOffset), SERVER_SEND_FLAGS));
+
+		if (sent < 0)
+		{
+			if (!IsWouldBlock()) return false;
+			break;
+		}
+
+		connection.outputOffset += sent;
+		if (connection.outputOffset == buffer.size())
+		{
+			connection.queuedBytes -= buffer.size();
+			connection.output.pop_front();
+			connection.outputOffset = 0;
+		}
+	}
+
+	if (connection.output.empty() && connection.isClosing) return false;
+
+	// only ask for writable while there is something left to write
+	const bool wantWrite = !connection.output.empty();
+	if (wantWrite != connection.isWatchingWrite)
+	{
+		connection.isWatchingWrite = wantWrite;
+		poller->Modify(socket, wantWrite);
+	}
+	return true;
+}
+
+void StatsServer::Disconnect(SocketHandle socket)
+{
+	auto it = connections.find(socket);
+	if (it == connections.end()) return;
+
+	if (it->second.isWebSocket) subscriberCount--;
+	poller->Remove(socket);
+	CloseSocket(socket);
+	connections.erase(it);
+}
+
+void StatsServer::Broadcast()
+{
+	std::vector<PendingEvent> events;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		events.swap(pending);
+		isWakePending = false;
+	}
+	if (events.empty()) return;
+
+	std::vector<SocketHandle> dropped;
+	for (PendingEvent& event : events)
+	{
+		const std::string data = event.data.dump();
+		if (event.isMatch)
+		{
+			history.push_back(std::make_shared<const std::string>(data));
+			if (history.size() > SERVER_HISTORY_MATCHES) history.pop_front();
+		}
+
+		// serialized and framed once, every subscriber queues the same buffer
+		std::string message = "{\"Type\":\"";
+		message += event.type;
+		message += "\",\"Data\":";
+		message += data;
+		message += '}';
+		const auto frame = std::make_shared<const std::string>(EncodeWebSocketFrame(WS_OPCODE_TEXT, message));
+
+		for (auto& entry : connections)
+		{
+			Connection& connection = entry.second;
+			if (!connection.isWebSocket || connection.isClosing) continue;
+
+			if (!Send(entry.first, connection, frame)) {
+				dropped.push_back(entry.first);
+			}
+		}
+
+		for (SocketHandle socket : dropped) {
+			Disconnect(socket);
+		}
+		dropped.clear();
+	}
+}
+
+std::string StatsServer::MatchJson()
+{
+	if (!liveMatch.IsOpen() && !liveMatch.Open(liveMatchPath)) return std::string();
+
+	LiveMatchData live;
+	if (!liveMatch.Read(live)) return std::string();
+	return LiveMatchToJson(live).dump();
+}
+
+std::string StatsServer::HistoryJson() const
+{
+	std::string body = "[";
+	for (size_t i = 0; i < history.size(); i++)
+	{
+		if (i) body += ',';
+		body += *history[i];
+	}
+	body += ']';
+	return body;
+}
+
+static std::string LiveName(const char (&name)[LIVE_NAME_BYTES])
+{
+	return std::string(name, strnlen(name, LIVE_NAME_BYTES));
+}
+
+json LiveMatchToJson(const LiveMatchData& live)
+{
+	json match;
+	match["MatchId"] = live.matchId;
+	match["StartTime"] = live.startWallClockMs;
+	match["Updates"] = live.updates;
+	match["Playlist"] = live.playlist;
+	match["MMRBefore"] = live.mmrBefore;
+	match["Phase"] = MatchPhaseName(static_cast<MatchPhase>(live.phase));
+	match["Outcome"] = MatchOutcomeName(static_cast<MatchOutcome>(live.outcome));
+	match["ClockLength"] = live.clockLength;
+	match["SecondsRemaining"] = live.secondsRemaining;
+	match["IsOvertime"] = live.isOvertime != 0;
+	match["OvertimeSeconds"] = live.overtimeSeconds;
+	match["ElapsedMs"] = live.elapsedMs;
+	match["Score"] = { live.score[0], live.score[1] };
+
+	json players = json::array();
+	for (size_t i = 0; i < live.playerCount && i < LIVE_MAX_PLAYERS; i++)
+	{
+		const LivePlayer& player = live.players[i];
+		players.push_back({
+			{ "Name", LiveName(player.name) },
+			{ "Team", player.team },
+			{ "IsLocal", player.isLocal != 0 },
+			{ "Goals", player.goals },
+			{ "Assists", player.assists },
+			{ "Saves", player.saves },
+			{ "Shots", player.shots },
+			{ "Demolishes", player.demolishes },
+		});
+	}
+	match["Players"] = std::move(players);
+
+	json goals = json::array();
+	for (size_t i = 0; i < live.goalCount && i < LIVE_MAX_GOALS; i++)
+	{
+		const LiveGoal& goal = live.goals[i];
+		goals.push_back({
+			{ "Scorer", goal.scorer < live.playerCount ? LiveName(live.players[goal.scorer].name) : std::string() },
+			{ "Team", goal.team },
+			{ "IsOvertime", goal.isOvertime != 0 },
+			{ "ClockSeconds", goal.clockSeconds },
+			{ "OvertimeSeconds", goal.overtimeSeconds },
+			{ "ElapsedMs", goal.elapsedMs },
+		});
+	}
+	match["Goals"] = std::move(goals);
+	return match;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "json.hpp"
+using json = nlohmann::json;
+
+#include "EventPoller.h"
+#include "LiveMatchReader.h"
+
+// exported matches served from /history
+#define SERVER_HISTORY_MATCHES 20
+#define SERVER_MAX_CONNECTIONS 1024
+#define SERVER_MAX_REQUEST_BYTES 8192
+// a subscriber this far behind is disconnected instead of buffered
+#define SERVER_MAX_QUEUED_BYTES (4 * 1024 * 1024)
+// events published but not yet taken by the loop, the oldest go first
+#define SERVER_MAX_PENDING_EVENTS 1024
+
+// Local stats endpoint for overlays and dashboards, bound to 127.0.0.1:
+//
+//   GET /match      the match in progress, read from live-match.bin
+//   GET /history    the last SERVER_HISTORY_MATCHES exported matches
+//   GET /events     WebSocket, pushes {"Type": ..., "Data": ...} on every
+//                   goal ("goal"), match end ("summary") and export
+//                   ("match-end")
+//
+// Runs on its own thread around one EventPoller. Publishing only queues
+// the event and wakes the loop, so the game thread never waits on a
+// socket. Each event is serialized and framed once and the same buffer is
+// queued for every subscriber.
+class StatsServer
+{
+public:
+    StatsServer() = default;
+    ~StatsServer();
+
+    StatsServer(const StatsServer&) = delete;
+    StatsServer& operator=(const StatsServer&) = delete;
+
+    // port 0 picks a free one, see Port. History is seeded from the match
+    // log at historyPath.
+    bool Start(uint16_t port, std::string liveMatchPath, std::string historyPath);
+    void Stop();
+
+    bool IsRunning() const { return isRunning.load(std::memory_order_relaxed); }
+    uint16_t Port() const { return boundPort; }
+    size_t Subscribers() const { return subscriberCount.load(std::memory_order_relaxed); }
+
+    // any thread
+    void Publish(const char* type, json data);
+
+    // any thread, also adds document to /history
+    void PublishMatch(const json& document);
+
+private:
+    struct Connection {
+        bool isWebSocket = false;
+        bool isClosing = false;         // close once output is flushed
+        bool isWatchingWrite = false;
+        std::string input;
+        std::deque<std::shared_ptr<const std::string>> output;
+        size_t outputOffset = 0;        // into output.front()
+        size_t queuedBytes = 0;
+    };
+
+    struct PendingEvent {
+        const char* type;
+        json data;
+        bool isMatch;
+    };
+
+    void Run();
+    void SeedHistory();
+
+    // the connection handlers return false when it should be closed
+    void Accept();
+    bool OnReadable(SocketHandle socket, Connection& connection);
+    bool OnHttpRequest(SocketHandle socket, Connection& connection);
+    bool OnWebSocketFrames(SocketHandle socket, Connection& connection);
+    bool Send(SocketHandle socket, Connection& connection, std::shared_ptr<const std::string> buffer);
+    bool Flush(SocketHandle socket, Connection& connection);
+    void Disconnect(SocketHandle socket);
+    void DrainWaker();
+
+    void Broadcast();
+    std::string MatchJson();
+    std::string HistoryJson() const;
+    // mutex held, so Stop can't close the waker under it
+    void Wake();
+
+    SocketHandle listener = INVALID_SOCKET_HANDLE;
+    // a UDP socket connected to itself, Publish sends it a byte to wake
+    // the loop; sent to and closed under mutex
+    SocketHandle waker = INVALID_SOCKET_HANDLE;
+    uint16_t boundPort = 0;
+
+    std::string liveMatchPath;
+    std::string historyPath;
+
+    // only touched on the server thread
+    std::unique_ptr<EventPoller> poller;
+    std::unordered_map<SocketHandle, Connection> connections;
+    std::deque<std::shared_ptr<const std::string>> history;
+    LiveMatchReader liveMatch;
+
+    std::mutex mutex;
+    std::vector<PendingEvent> pending;
+    bool isWakePending = false;
+
+    std::thread thread;
+    // set under mutex, cleared by Stop or when the loop gives up
+    std::atomic<bool> isRunning{ false };
+    std::atomic<size_t> subscriberCount{ 0 };
+};
+
+// JSON view of a live-match.bin snapshot, as /match serves it
+json LiveMatchToJson(const LiveMatchData& live);
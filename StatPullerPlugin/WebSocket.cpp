@@ -0,0 +1,160 @@
+#include "pch.h"
+#include "WebSocket.h"
+
+#include <array>
+
+#define WS_HANDSHAKE_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+static uint32_t RotateLeft(uint32_t value, int bits)
+{
+	return (value << bits) | (value >> (32 - bits));
+}
+
+static std::array<uint8_t, 20> Sha1(const std::string& message)
+{
+	uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+	// padded to a multiple of 64 bytes with the bit length at the end
+	std::string padded = message;
+	padded += static_cast<char>(0x80);
+	while (padded.size() % 64 != 56) {
+		padded += '\0';
+	}
+	const uint64_t bits = static_cast<uint64_t>(message.size()) * 8;
+	for (int i = 7; i >= 0; i--) {
+		padded += static_cast<char>((bits >> (i * 8)) & 0xFF);
+	}
+
+	for (size_t block = 0; block < padded.size(); block += 64)
+	{
+		uint32_t w[80];
+		for (int i = 0; i < 16; i++)
+		{
+			const uint8_t* p = reinterpret_cast<const uint8_t*>(padded.data() + block + i * 4);
+			w[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+		}
+		for (int i = 16; i < 80; i++) {
+			w[i] = RotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+		}
+
+		uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+		for (int i = 0; i < 80; i++)
+		{
+			uint32_t f, k;
+			if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+			else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+			else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+			else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+
+			const uint32_t next = RotateLeft(a, 5) + f + e + k + w[i];
+			e = d;
+			d = c;
+			c = RotateLeft(b, 30);
+			b = a;
+			a = next;
+		}
+
+		h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+	}
+
+	std::array<uint8_t, 20> digest;
+	for (int i = 0; i < 20; i++) {
+		digest[i] = static_cast<uint8_t>(h[i / 4] >> (24 - (i % 4) * 8));
+	}
+	return digest;
+}
+
+static std::string Base64(const uint8_t* data, size_t size)
+{
+	static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	std::string out;
+	out.reserve((size + 2) / 3 * 4);
+
+	for (size_t i = 0; i < size; i += 3)
+	{
+		const uint32_t chunk = (uint32_t(data[i]) << 16)
+			| (i + 1 < size ? uint32_t(data[i + 1]) << 8 : 0)
+			| (i + 2 < size ? uint32_t(data[i + 2]) : 0);
+
+		out += alphabet[(chunk >> 18) & 0x3F];
+		out += alphabet[(chunk >> 12) & 0x3F];
+		out += i + 1 < size ? alphabet[(chunk >> 6) & 0x3F] : '=';
+		out += i + 2 < size ? alphabet[chunk & 0x3F] : '=';
+	}
+	return out;
+}
+
+std::string WebSocketAccept(const std::string& key)
+{
+	const std::array<uint8_t, 20> digest = Sha1(key + WS_HANDSHAKE_GUID);
+	return Base64(digest.data(), digest.size());
+}
+
+std::string EncodeWebSocketFrame(uint8_t opcode, const std::string& payload)
+{
+	std::string frame;
+	frame.reserve(payload.size() + 10);
+	frame += static_cast<char>(0x80 | opcode);
+
+	const uint64_t size = payload.size();
+	if (size < 126) {
+		frame += static_cast<char>(size);
+	}
+	else if (size <= 0xFFFF)
+	{
+		frame += static_cast<char>(126);
+		frame += static_cast<char>(size >> 8);
+		frame += static_cast<char>(size & 0xFF);
+	}
+	else
+	{
+		frame += static_cast<char>(127);
+		for (int i = 7; i >= 0; i--) {
+			frame += static_cast<char>((size >> (i * 8)) & 0xFF);
+		}
+	}
+
+	frame += payload;
+	return frame;
+}
+
+ptrdiff_t DecodeWebSocketFrame(const char* data, size_t size, WebSocketFrame& frame)
+{
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+	if (size < 2) return 0;
+
+	const bool isMasked = (bytes[1] & 0x80) != 0;
+	if (!isMasked) return -1;
+
+	size_t offset = 2;
+	uint64_t length = bytes[1] & 0x7F;
+	if (length == 126)
+	{
+		if (size < 4) return 0;
+		length = (uint64_t(bytes[2]) << 8) | bytes[3];
+		offset = 4;
+	}
+	else if (length == 127)
+	{
+		if (size < 10) return 0;
+		length = 0;
+		for (int i = 0; i < 8; i++) {
+			length = (length << 8) | bytes[2 + i];
+		}
+		offset = 10;
+	}
+	if (length > WS_MAX_CLIENT_FRAME) return -1;
+
+	if (size < offset + 4 + length) return 0;
+	const uint8_t* mask = bytes + offset;
+	offset += 4;
+
+	frame.isFinal = (bytes[0] & 0x80) != 0;
+	frame.opcode = bytes[0] & 0x0F;
+	frame.payload.resize(static_cast<size_t>(length));
+	for (size_t i = 0; i < length; i++) {
+		frame.payload[i] = static_cast<char>(bytes[offset + i] ^ mask[i % 4]);
+	}
+	return static_cast<ptrdiff_t>(offset + length);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// The parts of RFC 6455 the stats server needs: the handshake and frame
+// encoding/decoding. Server side only, so outgoing frames are unmasked.
+
+#define WS_OPCODE_TEXT 0x1
+#define WS_OPCODE_BINARY 0x2
+#define WS_OPCODE_CLOSE 0x8
+#define WS_OPCODE_PING 0x9
+#define WS_OPCODE_PONG 0xA
+
+// clients only send control frames and small messages, anything bigger
+// closes the connection
+#define WS_MAX_CLIENT_FRAME (64 * 1024)
+
+// Sec-WebSocket-Accept for a client's Sec-WebSocket-Key
+std::string WebSocketAccept(const std::string& key);
+
+// header and payload of one final, unmasked frame
+std::string EncodeWebSocketFrame(uint8_t opcode, const std::string& payload);
+
+struct WebSocketFrame {
+    uint8_t opcode = 0;
+    bool isFinal = false;
+    std::string payload;        // unmasked
+};
+
+// Decodes one client frame from the front of data. Returns the bytes it
+// used, 0 if the frame isn't all there yet, -1 if it is malformed, not
+// masked or over WS_MAX_CLIENT_FRAME.
+ptrdiff_t DecodeWebSocketFrame(const char* data, size_t size, WebSocketFrame& frame);
@@ -1,5 +1,12 @@
 #pragma once
 
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
 #define WIN32_LEAN_AND_MEAN             // Exclude rarely-used stuff from Windows headers
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX                        // No min/max macros, they break std::min/std::max
+#endif
 // Windows Header Files
 #include <windows.h>
+#endif
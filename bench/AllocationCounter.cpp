@@ -0,0 +1,56 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> allocations{ 0 };
+static std::atomic<int64_t> liveBytes{ 0 };
+static thread_local uint64_t threadAllocations = 0;
+
+// each block starts with its size, padded to keep the caller's alignment
+static constexpr std::size_t HEADER_BYTES = alignof(std::max_align_t);
+
+uint64_t AllocationCount()
+{
+	return allocations.load(std::memory_order_relaxed);
+}
+
+uint64_t ThreadAllocationCount()
+{
+	return threadAllocations;
+}
+
+int64_t LiveHeapBytes()
+{
+	return liveBytes.load(std::memory_order_relaxed);
+}
+
+// the array and nothrow forms call these, so every allocation is counted once
+void* operator new(std::size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	threadAllocations++;
+
+	void* block = std::malloc(HEADER_BYTES + size);
+	if (!block) throw std::bad_alloc();
+
+	*static_cast<std::size_t*>(block) = size;
+	liveBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+	return static_cast<char*>(block) + HEADER_BYTES;
+}
+
+void operator delete(void* p) noexcept
+{
+	if (!p) return;
+
+	void* block = static_cast<char*>(p) - HEADER_BYTES;
+	liveBytes.fetch_sub(static_cast<int64_t>(*static_cast<std::size_t*>(block)), std::memory_order_relaxed);
+	std::free(block);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	operator delete(p);
+}
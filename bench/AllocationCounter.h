@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts calls to the global operator new and the bytes they hold. The
+// bench executable replaces it, which a plugin DLL can't do without taking
+// over the game's heap.
+
+// every thread since start-up
+uint64_t AllocationCount();
+
+// the calling thread only
+uint64_t ThreadAllocationCount();
+
+// bytes allocated through operator new and not yet freed, every thread
+int64_t LiveHeapBytes();
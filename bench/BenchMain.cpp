@@ -0,0 +1,78 @@
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+#include "MatchLog.h"
+#include "ReplayBenchmark.h"
+
+// statpuller_bench [matches per scenario] [output directory]
+//
+// Hooks and timeouts run on this thread, the one driving the fake host,
+// the same way they run on the game thread in a live match.
+int main(int argc, char** argv)
+{
+	int matchesPerScenario = argc > 1 ? std::atoi(argv[1]) : 20;
+	if (matchesPerScenario < 1) matchesPerScenario = 1;
+
+	std::string outputDirectory = argc > 2 ? argv[2] : (std::filesystem::temp_directory_path() / "statpuller-bench").string();
+	if (outputDirectory.back() != '/' && outputDirectory.back() != static_cast<char>(std::filesystem::path::preferred_separator)) {
+		outputDirectory += static_cast<char>(std::filesystem::path::preferred_separator);
+	}
+
+	// the match log and history carry over between runs otherwise
+	std::error_code ec;
+	std::filesystem::remove_all(outputDirectory, ec);
+	std::filesystem::create_directories(outputDirectory, ec);
+
+	std::printf("%s", FormatReplayBenchmark(RunReplayBenchmark(outputDirectory, matchesPerScenario)).c_str());
+
+	const GoalCaptureResult capture = MeasureGoalCapture(1000, 12);
+	std::printf("Goal capture (%d goals a match): json %.0f ns, %.1f allocations, %lld bytes held; GoalEvent %.0f ns, %.2f allocations, %lld bytes held\n",
+		capture.goalsPerMatch, capture.jsonNs, capture.jsonAllocations, static_cast<long long>(capture.jsonBytes),
+		capture.structNs, capture.structAllocations, static_cast<long long>(capture.structBytes));
+
+	const ExportHandoffResult handoff = MeasureExportHandoff(outputDirectory, 1000);
+	std::printf("Export handoff (%d matches, %d dropped): p50 %.2f us, p99 %.2f us, max %.2f us; written in the hook p50 %.2f us, p99 %.2f us\n",
+		handoff.matches, handoff.dropped, handoff.p50Us, handoff.p99Us, handoff.maxUs, handoff.inlineP50Us, handoff.inlineP99Us);
+
+	// the game thread used to pay for this, now the replay flusher does
+	std::printf("Replay write (%d MB fake replay): %.2f ms, off the game thread\n",
+		BENCH_REPLAY_BYTES / (1024 * 1024), MeasureReplayWriteMs(outputDirectory, BENCH_REPLAY_BYTES, 10));
+
+	std::printf("Log statement: %.1f ns\n", MeasureLogWriteNs(1000));
+
+	const LiveReadResult live = MeasureLiveReads(outputDirectory, 500);
+	std::printf("Live file: %llu writes, %llu reads at %.1f ns, %llu busy, %llu torn\n",
+		static_cast<unsigned long long>(live.writes), static_cast<unsigned long long>(live.reads), live.readNs,
+		static_cast<unsigned long long>(live.busyReads), static_cast<unsigned long long>(live.tornReads));
+
+	const FanoutResult fanout = MeasureServerFanout(outputDirectory, 300, 100);
+	std::printf("Stats server: %d events to %d subscribers, %llu/%llu frames in %.1f ms, publish %.2f us, GET /match %.2f ms\n",
+		fanout.events, fanout.subscribers, static_cast<unsigned long long>(fanout.framesReceived),
+		static_cast<unsigned long long>(fanout.subscribers) * fanout.events, fanout.deliveryMs, fanout.publishUs, fanout.matchRequestMs);
+
+	const HistoryQueryResult store = MeasureHistoryQueries(outputDirectory, 10000);
+	std::printf("History store (%zu matches): append %.1f us, load %.2f ms, last 500 %.3f ms, by MMR %.3f ms, by minute %.3f ms, trend %.3f ms\n",
+		store.matches, store.appendUs, store.loadMs, store.lastMatchesMs, store.winRateByMmrMs, store.goalsByMinuteMs, store.mmrTrendMs);
+
+	const SessionUpdateResult session = MeasureSessionUpdates(outputDirectory, 1000);
+	std::printf("Session (%zu matches): add %.0f ns, save %.1f us, reload %.1f us%s\n",
+		session.matches, session.addNs, session.saveUs, session.loadUs, session.isSame ? "" : ", MISMATCH");
+
+	// compare encodings on the biggest match the replay just exported
+	MatchLogReader history;
+	if (!history.Open(outputDirectory + "match-history.splog") || history.Count() == 0) return 0;
+
+	MatchRecordView largest;
+	history.ForEach([&largest](size_t, const MatchRecordView& record) {
+		if (record.size > largest.size) largest = record;
+	});
+
+	const SummaryTimingResult summary = MeasureSummaryTiming(outputDirectory, MatchLogReader::Parse(largest), 100);
+	std::printf("Summary (%zu goals): in process %.1f us at match end + %.0f ns per goal, from the match file %.1f us%s\n",
+		summary.goals, summary.matchEndUs, summary.perGoalNs, summary.fromFileUs, summary.isSame ? "" : ", MISMATCH");
+
+	std::printf("Export formats:\n%s", FormatEncodingBenchmark(RunEncodingBenchmark(MatchLogReader::Parse(largest), 100)).c_str());
+	return 0;
+}
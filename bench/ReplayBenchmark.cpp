@@ -0,0 +1,907 @@
+#include "ReplayBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <thread>
+
+#include "AllocationCounter.h"
+#include "ExportWorker.h"
+#include "LiveMatchFile.h"
+#include "LiveMatchReader.h"
+#include "HistoryStore.h"
+#include "Logger.h"
+#include "MatchState.h"
+#include "MatchSummary.h"
+#include "PlayerTable.h"
+#include "SessionAggregator.h"
+#include "StatPullerCore.h"
+#include "StatsServer.h"
+
+using Clock = std::chrono::steady_clock;
+
+static double Percentile(std::vector<int64_t>& samples, double fraction)
+{
+	if (samples.empty()) return 0.0;
+
+	const size_t index = std::min(samples.size() - 1, static_cast<size_t>(fraction * samples.size()));
+	std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+	return samples[index] / 1000.0;
+}
+
+// "Function TAGame.GFxHUD_TA.HandleStatTickerMessage" -> "HandleStatTickerMessage"
+static std::string ShortHookName(const std::string& eventName)
+{
+	const size_t dot = eventName.rfind('.');
+	return dot == std::string::npos ? eventName : eventName.substr(dot + 1);
+}
+
+static ScenarioResult RunScenario(const std::string& outputDirectory, MatchScenario scenario, int matches, size_t replayBytes)
+{
+	std::map<std::string, std::vector<int64_t>> samples;
+
+	FakeGameHost host;
+	host.replayBytes = replayBytes;
+	host.onDispatch = [&samples](const std::string& eventName, std::chrono::nanoseconds elapsed) {
+		samples[eventName].push_back(elapsed.count());
+	};
+
+	uint64_t allocations = 0;
+	uint64_t gameThreadAllocations = 0;
+	const Clock::time_point start = Clock::now();
+	{
+		StatPullerCore core(host, outputDirectory);
+		core.Start();
+
+		// up to the export worker draining the last match; building the
+		// scripts allocates too, but that isn't the core's
+		const uint64_t allocationsBefore = AllocationCount();
+		uint64_t scriptAllocations = 0;
+
+		for (int i = 0; i < matches; i++)
+		{
+			const uint64_t scriptStart = ThreadAllocationCount();
+			const std::vector<ScriptStep> steps = BuildScriptedMatch(host, scenario, static_cast<uint32_t>(i + 1));
+			scriptAllocations += ThreadAllocationCount() - scriptStart;
+
+			const uint64_t matchStart = ThreadAllocationCount();
+			host.Run(steps);
+			// let the end-of-match timeouts fire
+			host.Advance(5.0);
+			gameThreadAllocations += ThreadAllocationCount() - matchStart;
+		}
+
+		core.Stop();
+		allocations = AllocationCount() - allocationsBefore - scriptAllocations;
+	}
+	const double totalSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	ScenarioResult result;
+	result.scenario = scenario;
+	result.matches = matches;
+	result.totalSeconds = totalSeconds;
+	result.matchesPerSecond = totalSeconds > 0.0 ? matches / totalSeconds : 0.0;
+	result.allocationsPerMatch = matches ? static_cast<double>(allocations) / matches : 0.0;
+	result.gameThreadAllocationsPerMatch = matches ? static_cast<double>(gameThreadAllocations) / matches : 0.0;
+
+	for (auto& entry : samples)
+	{
+		std::vector<int64_t>& values = entry.second;
+
+		HookTiming timing;
+		timing.name = ShortHookName(entry.first);
+		timing.calls = values.size();
+
+		int64_t total = 0;
+		int64_t max = 0;
+		for (int64_t value : values) {
+			total += value;
+			max = std::max(max, value);
+		}
+		timing.meanUs = values.empty() ? 0.0 : total / 1000.0 / values.size();
+		timing.maxUs = max / 1000.0;
+		timing.p50Us = Percentile(values, 0.50);
+		timing.p99Us = Percentile(values, 0.99);
+
+		result.hookSeconds += total / 1e9;
+		result.hooks.push_back(timing);
+	}
+	return result;
+}
+
+std::vector<ScenarioResult> RunReplayBenchmark(const std::string& outputDirectory, int matchesPerScenario, size_t replayBytes)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(outputDirectory, ec);
+
+	std::vector<ScenarioResult> results;
+	for (MatchScenario scenario : { MatchScenario::Ranked1v1, MatchScenario::Ranked2v2, MatchScenario::Overtime, MatchScenario::EarlyExit }) {
+		results.push_back(RunScenario(outputDirectory, scenario, matchesPerScenario, replayBytes));
+	}
+	return results;
+}
+
+std::string FormatReplayBenchmark(const std::vector<ScenarioResult>& results)
+{
+	std::string report;
+	char line[256];
+
+	for (const ScenarioResult& result : results)
+	{
+		snprintf(line, sizeof(line), "%s: %d matches, %.1f matches/s, %.3f ms in hooks per match, %.0f allocations per match (%.0f on the game thread)\n",
+			ScenarioName(result.scenario), result.matches, result.matchesPerSecond,
+			result.matches ? result.hookSeconds * 1000.0 / result.matches : 0.0,
+			result.allocationsPerMatch, result.gameThreadAllocationsPerMatch);
+		report += line;
+
+		for (const HookTiming& hook : result.hooks)
+		{
+			snprintf(line, sizeof(line), "  %-26s calls %8llu  mean %8.2fus  p50 %8.2fus  p99 %8.2fus  max %8.2fus\n",
+				hook.name.c_str(), static_cast<unsigned long long>(hook.calls),
+				hook.meanUs, hook.p50Us, hook.p99Us, hook.maxUs);
+			report += line;
+		}
+	}
+	return report;
+}
+
+// names long enough to need the heap, like most real ones
+static const char* const GOAL_SCORERS[] = { "SomeoneNamedKai", "xX_AerialGod_Xx", "ceiling shot enjoyer", "Player 4" };
+
+GoalCaptureResult MeasureGoalCapture(int matches, int goalsPerMatch)
+{
+	GoalCaptureResult result;
+	result.matches = matches;
+	result.goalsPerMatch = goalsPerMatch;
+	if (matches < 1 || goalsPerMatch < 1) return result;
+
+	const double goals = static_cast<double>(matches) * goalsPerMatch;
+
+	// before: the scorer's name read and a json object built for every goal
+	std::vector<json> goalEvents;
+	double elapsedNs = 0.0;
+	uint64_t allocationsBefore = ThreadAllocationCount();
+	for (int match = 0; match < matches; match++)
+	{
+		const int64_t bytesBefore = LiveHeapBytes();
+		const Clock::time_point start = Clock::now();
+		for (int i = 0; i < goalsPerMatch; i++)
+		{
+			const std::string scorerName = GOAL_SCORERS[i % 4];
+			json goal;
+			goal["ScorerName"] = scorerName;
+			goal["ScorerTeam"] = i % 2;
+			goal["GoalTimeSeconds"] = 300 - i;
+			goalEvents.push_back(goal);
+		}
+		elapsedNs += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+		result.jsonBytes = LiveHeapBytes() - bytesBefore;
+		goalEvents.clear();
+		goalEvents.shrink_to_fit();
+	}
+	result.jsonNs = elapsedNs / goals;
+	result.jsonAllocations = (ThreadAllocationCount() - allocationsBefore) / goals;
+
+	// now: the scorer interned once per match, a fixed-size record per goal
+	std::unique_ptr<GoalBuffer> goalBuffer(new GoalBuffer());
+	PlayerTable players;
+	elapsedNs = 0.0;
+	allocationsBefore = ThreadAllocationCount();
+	for (int match = 0; match < matches; match++)
+	{
+		const int64_t bytesBefore = LiveHeapBytes();
+		const Clock::time_point start = Clock::now();
+		for (int i = 0; i < goalsPerMatch; i++)
+		{
+			GoalEvent goal{};
+			goal.scorerId = players.Intern(0x1000 + i % 4, [i] { return std::string(GOAL_SCORERS[i % 4]); });
+			goal.team = static_cast<uint8_t>(i % 2);
+			goal.clockSeconds = static_cast<int16_t>(300 - i);
+			goal.tick = static_cast<uint32_t>(i);
+			goalBuffer->Push(goal);
+		}
+		elapsedNs += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+		result.structBytes = static_cast<int64_t>(sizeof(GoalBuffer)) + LiveHeapBytes() - bytesBefore;
+		goalBuffer->Clear();
+		players.Clear();
+	}
+	result.structNs = elapsedNs / goals;
+	result.structAllocations = (ThreadAllocationCount() - allocationsBefore) / goals;
+	return result;
+}
+
+static void FillSyntheticMatch(MatchSnapshot& snapshot, uint32_t seed)
+{
+	snapshot.matchId = seed;
+	snapshot.playlist = 11;
+	snapshot.playerNames = { "Player0", "Player1", "Player2", "Player3" };
+
+	uint32_t state = seed * 2654435761u + 1;
+	const int goals = 2 + (state >> 28);
+	for (int i = 0; i < goals; i++)
+	{
+		state = state * 1664525u + 1013904223u;
+		GoalEvent goal{};
+		goal.scorerId = static_cast<uint16_t>(state % 4);
+		goal.team = static_cast<uint8_t>(goal.scorerId % 2);
+		goal.clockSeconds = static_cast<int16_t>(300 - i * 20);
+		goal.tick = static_cast<uint32_t>(i * 20);
+		goal.elapsedMs = static_cast<uint32_t>(i * 20000);
+		snapshot.goals.Push(goal);
+	}
+}
+
+// stands in for StatPullerCore::ExportMatch: build the document, write it
+static void WriteSyntheticMatch(const MatchSnapshot& snapshot, const std::string& path)
+{
+	json goals = json::array();
+	for (const GoalEvent& goal : snapshot.goals)
+	{
+		goals.push_back({
+			{ "Scorer", snapshot.playerNames[goal.scorerId] },
+			{ "Team", goal.team },
+			{ "GoalTimeSeconds", goal.clockSeconds },
+			{ "MatchTimeMs", goal.elapsedMs },
+		});
+	}
+	const json document = { { "MatchId", snapshot.matchId }, { "Playlist", snapshot.playlist }, { "Goals", std::move(goals) } };
+
+	std::ofstream file(path, std::ios::trunc);
+	file << document.dump(4);
+}
+
+ExportHandoffResult MeasureExportHandoff(const std::string& outputDirectory, int matches)
+{
+	ExportHandoffResult result;
+	result.matches = matches;
+
+	std::error_code ec;
+	std::filesystem::create_directories(outputDirectory, ec);
+	const std::string path = outputDirectory + "export-bench.json";
+
+	std::vector<int64_t> handoff;
+	std::vector<int64_t> inlined;
+	handoff.reserve(matches);
+	inlined.reserve(matches);
+
+	Logger logger;
+	ExportWorker worker(logger);
+	worker.Start([&path](MatchSnapshot& snapshot) {
+		WriteSyntheticMatch(snapshot, path);
+	});
+
+	for (int i = 0; i < matches; i++)
+	{
+		Clock::time_point start = Clock::now();
+		{
+			MatchSnapshot snapshot;
+			FillSyntheticMatch(snapshot, static_cast<uint32_t>(i + 1));
+			if (!worker.Submit(std::move(snapshot))) result.dropped++;
+		}
+		handoff.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+
+		// what OnGameComplete's timeout did before the worker
+		start = Clock::now();
+		{
+			MatchSnapshot snapshot;
+			FillSyntheticMatch(snapshot, static_cast<uint32_t>(i + 1));
+			WriteSyntheticMatch(snapshot, path + ".inline");
+		}
+		inlined.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+	}
+	worker.Stop();
+
+	result.maxUs = handoff.empty() ? 0.0 : *std::max_element(handoff.begin(), handoff.end()) / 1000.0;
+	result.p50Us = Percentile(handoff, 0.50);
+	result.p99Us = Percentile(handoff, 0.99);
+	result.inlineP50Us = Percentile(inlined, 0.50);
+	result.inlineP99Us = Percentile(inlined, 0.99);
+
+	std::filesystem::remove(path, ec);
+	std::filesystem::remove(path + ".inline", ec);
+	return result;
+}
+
+double MeasureReplayWriteMs(const std::string& outputDirectory, size_t replayBytes, int iterations)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(outputDirectory, ec);
+
+	FakeGameHost host;
+	host.replayBytes = replayBytes;
+	const std::string path = outputDirectory + "bench-replay.replay";
+
+	const Clock::time_point start = Clock::now();
+	for (int i = 0; i < iterations; i++) {
+		host.WriteReplay(host.TakeReplay(), path);
+	}
+	const double elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	std::filesystem::remove(path, ec);
+	return iterations > 0 ? elapsedMs / iterations : 0.0;
+}
+
+// iterations has to fit the ring, LOG_RING_BYTES / ~64 bytes per record
+double MeasureLogWriteNs(int iterations)
+{
+	Logger logger;
+	logger.Start(nullptr, "");
+
+	const std::string name = "Player Name";
+
+	// first use allocates the thread's ring and faults its pages in
+	for (int i = 0; i < iterations; i++) {
+		SP_LOG_DEBUG(logger, "warm up {}", i);
+		SP_LOG_INFO(logger, "Goal scored by: {} on team {} at {}", name, i & 1, 300 - i % 300);
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	const Clock::time_point start = Clock::now();
+	for (int i = 0; i < iterations; i++) {
+		SP_LOG_INFO(logger, "Goal scored by: {} on team {} at {}", name, i & 1, 300 - i % 300);
+	}
+	const double elapsedNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+	logger.Stop();
+	return iterations > 0 ? elapsedNs / iterations : 0.0;
+}
+
+// every field the writer touches is derived from one counter, so a
+// snapshot mixing two updates can't pass
+static void FillLiveData(LiveMatchData& live, uint32_t value)
+{
+	live.matchId = value;
+	live.tick = value;
+	live.elapsedMs = value * 7;
+	live.secondsRemaining = static_cast<int16_t>(value);
+	live.playerCount = static_cast<uint8_t>(value);
+	for (LivePlayer& player : live.players) {
+		player.goals = static_cast<uint16_t>(value);
+	}
+	for (LiveGoal& goal : live.goals) {
+		goal.tick = value;
+	}
+}
+
+static bool IsLiveDataConsistent(const LiveMatchData& live)
+{
+	const uint32_t value = live.tick;
+	if (live.matchId != value || live.elapsedMs != value * 7) return false;
+	if (live.secondsRemaining != static_cast<int16_t>(value) || live.playerCount != static_cast<uint8_t>(value)) return false;
+
+	for (const LivePlayer& player : live.players) {
+		if (player.goals != static_cast<uint16_t>(value)) return false;
+	}
+	for (const LiveGoal& goal : live.goals) {
+		if (goal.tick != value) return false;
+	}
+	return true;
+}
+
+LiveReadResult MeasureLiveReads(const std::string& outputDirectory, int milliseconds)
+{
+	LiveReadResult result;
+
+	std::error_code ec;
+	std::filesystem::create_directories(outputDirectory, ec);
+	const std::string path = outputDirectory + "live-match-bench.bin";
+
+	LiveMatchFile writer;
+	LiveMatchReader reader;
+	if (!writer.Open(path) || !reader.Open(path)) return result;
+
+	std::atomic<bool> isRunning{ true };
+	std::thread writerThread([&writer, &isRunning, &result] {
+		uint32_t value = 0;
+		while (isRunning.load(std::memory_order_relaxed))
+		{
+			value++;
+			writer.Update([value](LiveMatchData& live) {
+				FillLiveData(live, value);
+			});
+		}
+		result.writes = value;
+	});
+
+	LiveMatchData snapshot;
+	uint64_t calls = 0;
+	const Clock::time_point start = Clock::now();
+	const Clock::time_point end = start + std::chrono::milliseconds(milliseconds);
+
+	while (Clock::now() < end)
+	{
+		for (int i = 0; i < 256; i++)
+		{
+			calls++;
+			if (!reader.Read(snapshot)) {
+				result.busyReads++;
+			}
+			else if (!IsLiveDataConsistent(snapshot)) {
+				result.tornReads++;
+			}
+			else {
+				result.reads++;
+			}
+		}
+	}
+	const double elapsedNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+	isRunning = false;
+	writerThread.join();
+
+	result.readNs = calls ? elapsedNs / calls : 0.0;
+	reader.Close();
+	writer.Close();
+	std::filesystem::remove(path, ec);
+	return result;
+}
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+// blocking client socket with a receive timeout, so a lost event fails the
+// benchmark instead of hanging it
+static SocketHandle ConnectLoopback(uint16_t port)
+{
+	SocketHandle handle = socket(AF_INET, SOCK_STREAM, 0);
+	if (handle == INVALID_SOCKET_HANDLE) return INVALID_SOCKET_HANDLE;
+
+#ifdef _WIN32
+	const DWORD timeout = 5000;
+#else
+	const timeval timeout = { 5, 0 };
+#endif
+	setsockopt(handle, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons(port);
+	if (connect(handle, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+	{
+		CloseSocket(handle);
+		return INVALID_SOCKET_HANDLE;
+	}
+	return handle;
+}
+
+// sends request and reads until the server closes, or just the headers
+// when it switches to WebSocket
+static std::string HttpRoundTrip(SocketHandle handle, const std::string& request, bool isUpgrade)
+{
+	if (send(handle, request.data(), static_cast<int>(request.size()), 0) != static_cast<int>(request.size())) return std::string();
+
+	std::string response;
+	char chunk[4096];
+	while (true)
+	{
+		const int received = static_cast<int>(recv(handle, chunk, isUpgrade ? 1 : sizeof(chunk), 0));
+		if (received <= 0) break;
+		response.append(chunk, received);
+		if (isUpgrade && response.size() >= 4 && response.compare(response.size() - 4, 4, "\r\n\r\n") == 0) break;
+	}
+	return response;
+}
+
+// counts complete unmasked server frames at the front of buffer and drops them
+static int TakeServerFrames(std::string& buffer)
+{
+	int frames = 0;
+	size_t offset = 0;
+	while (buffer.size() - offset >= 2)
+	{
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(buffer.data() + offset);
+		uint64_t length = bytes[1] & 0x7F;
+		size_t header = 2;
+		if (length == 126)
+		{
+			if (buffer.size() - offset < 4) break;
+			length = (uint64_t(bytes[2]) << 8) | bytes[3];
+			header = 4;
+		}
+		else if (length == 127)
+		{
+			if (buffer.size() - offset < 10) break;
+			length = 0;
+			for (int i = 0; i < 8; i++) {
+				length = (length << 8) | bytes[2 + i];
+			}
+			header = 10;
+		}
+		if (buffer.size() - offset < header + length) break;
+
+		offset += header + static_cast<size_t>(length);
+		frames++;
+	}
+	buffer.erase(0, offset);
+	return frames;
+}
+
+FanoutResult MeasureServerFanout(const std::string& outputDirectory, int subscribers, int events)
+{
+	FanoutResult result;
+	result.events = events;
+
+	StatsServer server;
+	if (!server.Start(0, outputDirectory + "live-match.bin", outputDirectory + "match-history.splog")) return result;
+
+	const std::string upgrade = "GET /events HTTP/1.1\r\nHost: 127.0.0.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+		"Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+
+	std::vector<SocketHandle> clients;
+	for (int i = 0; i < subscribers; i++)
+	{
+		const SocketHandle client = ConnectLoopback(server.Port());
+		if (client == INVALID_SOCKET_HANDLE) break;
+
+		const std::string response = HttpRoundTrip(client, upgrade, true);
+		if (response.compare(0, 12, "HTTP/1.1 101") != 0)
+		{
+			CloseSocket(client);
+			break;
+		}
+		clients.push_back(client);
+	}
+	result.subscribers = static_cast<int>(clients.size());
+
+	// the server counts a subscriber once it has sent the 101
+	while (server.Subscribers() < clients.size()) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	const Clock::time_point start = Clock::now();
+	for (int i = 0; i < events; i++)
+	{
+		server.Publish("goal", {
+			{ "MatchId", 1 },
+			{ "Scorer", "Bench" },
+			{ "Team", i % 2 },
+			{ "ClockSeconds", 300 - i },
+		});
+	}
+	const double publishNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+	result.publishUs = events ? publishNs / events / 1000.0 : 0.0;
+
+	std::string buffer;
+	char chunk[16 * 1024];
+	for (SocketHandle client : clients)
+	{
+		int frames = 0;
+		buffer.clear();
+		while (frames < events)
+		{
+			const int received = static_cast<int>(recv(client, chunk, sizeof(chunk), 0));
+			if (received <= 0) break;
+			buffer.append(chunk, received);
+			frames += TakeServerFrames(buffer);
+		}
+		result.framesReceived += frames;
+	}
+	result.deliveryMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	for (SocketHandle client : clients) {
+		CloseSocket(client);
+	}
+
+	const int requests = 20;
+	const Clock::time_point requestStart = Clock::now();
+	for (int i = 0; i < requests; i++)
+	{
+		const SocketHandle client = ConnectLoopback(server.Port());
+		if (client == INVALID_SOCKET_HANDLE) break;
+		HttpRoundTrip(client, "GET /match HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n", false);
+		CloseSocket(client);
+	}
+	result.matchRequestMs = std::chrono::duration<double, std::milli>(Clock::now() - requestStart).count() / requests;
+
+	server.Stop();
+	return result;
+}
+
+// a season of made up but plausible matches, one every ten minutes or so
+static HistoryRow SyntheticHistoryRow(size_t index, uint32_t& random, int (&mmr)[3])
+{
+	static const int playlists[3] = { 10, 11, 13 };
+
+	auto next = [&random](uint32_t range) {
+		random = random * 1664525u + 1013904223u;
+		return (random >> 8) % range;
+	};
+
+	HistoryRow row{};
+	const int slot = static_cast<int>(next(3));
+	row.matchId = 1700000000000000ull + index * 600000000ull;
+	row.startTimeMs = static_cast<int64_t>(1700000000000ll + index * 600000ll);
+	row.playlist = playlists[slot];
+	row.team = static_cast<uint8_t>(next(2));
+	row.outcome = static_cast<uint8_t>(next(20) == 0 ? MatchOutcome::EarlyExit : MatchOutcome::Completed);
+
+	for (int goals = next(8); goals > 0; goals--)
+	{
+		const bool isFor = next(2) == 0;
+		(isFor ? row.goalsFor : row.goalsAgainst)++;
+		(isFor ? row.goalsForByMinute : row.goalsAgainstByMinute)[next(5)]++;
+	}
+	if (row.goalsFor == row.goalsAgainst)
+	{
+		row.isOvertime = 1;
+		row.goalsFor++;
+		row.goalsForByMinute[5 + next(3)]++;
+	}
+
+	const bool isWin = row.outcome != static_cast<uint8_t>(MatchOutcome::EarlyExit) && row.goalsFor > row.goalsAgainst;
+	row.result = static_cast<uint8_t>(isWin ? HistoryResult::Win : HistoryResult::Loss);
+
+	row.mmrBefore = mmr[slot];
+	mmr[slot] += isWin ? 9 : -9;
+	row.mmrAfter = mmr[slot];
+	return row;
+}
+
+template <typename Fn>
+static double TimeMs(Fn&& fn)
+{
+	const Clock::time_point start = Clock::now();
+	fn();
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+HistoryQueryResult MeasureHistoryQueries(const std::string& outputDirectory, size_t matches)
+{
+	HistoryQueryResult result;
+
+	std::error_code ec;
+	std::filesystem::create_directories(outputDirectory, ec);
+	const std::string path = outputDirectory + "history-bench.spcol";
+	std::filesystem::remove(path, ec);
+	std::filesystem::remove(path + ".tail", ec);
+
+	{
+		HistoryStore store;
+		if (!store.Open(path, true)) return result;
+
+		uint32_t random = 12345;
+		int mmr[3] = { 1100, 1100, 1100 };
+		const double appendMs = TimeMs([&] {
+			for (size_t i = 0; i < matches; i++) {
+				store.Append(SyntheticHistoryRow(i, random, mmr));
+			}
+		});
+		result.appendUs = matches ? appendMs * 1000.0 / matches : 0.0;
+	}
+
+	HistoryStore store;
+	result.loadMs = TimeMs([&] {
+		store.Open(path, false);
+	});
+	result.matches = store.Count();
+
+	HistoryFilter doubles;
+	doubles.playlist = 11;
+
+	result.lastMatchesMs = TimeMs([&] {
+		HistoryFilter filter = doubles;
+		filter.lastMatches = 500;
+		store.Summarize(store.Select(filter));
+	});
+
+	const std::vector<uint32_t> all = store.Select(HistoryFilter());
+	result.winRateByMmrMs = TimeMs([&] {
+		store.WinRateByMmr(all, 50);
+	});
+	result.goalsByMinuteMs = TimeMs([&] {
+		store.GoalsPerMinute(all);
+	});
+	result.mmrTrendMs = TimeMs([&] {
+		store.MmrTrend(store.Select(doubles), 100);
+	});
+
+	// a month from the middle of the season only touches the blocks it overlaps
+	if (!store.Blocks().empty())
+	{
+		HistoryFilter month;
+		month.fromMs = 1700000000000ll + static_cast<int64_t>(matches / 2) * 600000ll;
+		month.toMs = month.fromMs + 30ll * 24 * 3600 * 1000;
+		for (const HistoryBlockStats& block : store.Blocks())
+		{
+			if (block.max[static_cast<int>(HistoryStat::StartTime)] < month.fromMs
+				|| block.min[static_cast<int>(HistoryStat::StartTime)] >= month.toMs) result.blocksSkipped++;
+		}
+	}
+
+	store.Close();
+	std::filesystem::remove(path, ec);
+	std::filesystem::remove(path + ".tail", ec);
+	return result;
+}
+
+SummaryTimingResult MeasureSummaryTiming(const std::string& outputDirectory, const json& document, int iterations)
+{
+	SummaryTimingResult result;
+	if (iterations < 1) iterations = 1;
+
+	// what the core sees during the match, taken back out of the document
+	const MatchSummary reference = SummaryFromDocument(document);
+	const std::vector<std::string> names = document.value("Players", std::vector<std::string>());
+	const json expected = reference.ToJson(names);
+
+	std::vector<GoalEvent> goals;
+	for (const json& goal : expected["Timeline"])
+	{
+		GoalEvent event{};
+		const std::string scorer = goal["Scorer"].get<std::string>();
+		event.scorerId = static_cast<uint16_t>(std::find(names.begin(), names.end(), scorer) - names.begin());
+		event.team = goal["Team"].get<uint8_t>();
+		event.isOvertime = goal["IsOvertime"].get<bool>();
+		event.clockSeconds = goal["GoalTimeSeconds"].get<int16_t>();
+		event.overtimeSeconds = goal["OvertimeSeconds"].get<int16_t>();
+		event.elapsedMs = goal["MatchTimeMs"].get<uint32_t>();
+		goals.push_back(event);
+	}
+	result.goals = goals.size();
+
+	const int localTeam = expected["LocalTeam"].get<int>();
+	MatchOutcome outcome = MatchOutcome::Completed;
+	ParseMatchOutcome(expected["Outcome"].get<std::string>(), outcome);
+
+	double goalNs = 0.0;
+	double endNs = 0.0;
+	json incremental;
+	for (int i = 0; i < iterations; i++)
+	{
+		MatchSummary summary;
+		summary.Begin(reference.MatchId(), document.value("Playlist", -1), document.value("ClockLength", 300), reference.MmrBefore());
+		if (localTeam >= 0) summary.SetLocalTeam(static_cast<uint8_t>(localTeam));
+
+		Clock::time_point start = Clock::now();
+		for (const GoalEvent& goal : goals) {
+			summary.OnGoal(goal);
+		}
+		goalNs += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+		start = Clock::now();
+		summary.End(outcome, expected["DurationMs"].get<uint32_t>());
+		incremental = summary.ToJson(names);
+		endNs += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+	}
+	result.perGoalNs = goals.empty() ? 0.0 : goalNs / iterations / goals.size();
+	result.matchEndUs = endNs / iterations / 1000.0;
+
+	std::error_code ec;
+	std::filesystem::create_directories(outputDirectory, ec);
+	const std::string path = outputDirectory + "summary-bench.json";
+	{
+		std::ofstream file(path, std::ios::trunc);
+		file << document.dump(4);
+	}
+
+	json recomputed;
+	const Clock::time_point start = Clock::now();
+	for (int i = 0; i < iterations; i++)
+	{
+		std::ifstream file(path);
+		const json parsed = json::parse(file, nullptr, false);
+		recomputed = SummaryFromDocument(parsed).ToJson(parsed.value("Players", std::vector<std::string>()));
+	}
+	result.fromFileUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / iterations;
+	std::filesystem::remove(path, ec);
+
+	result.isSame = incremental["Score"] == recomputed["Score"] && incremental["Timeline"] == recomputed["Timeline"]
+		&& incremental["GoalDifferentialByMinute"] == recomputed["GoalDifferentialByMinute"];
+	return result;
+}
+
+SessionUpdateResult MeasureSessionUpdates(const std::string& outputDirectory, size_t matches)
+{
+	SessionUpdateResult result;
+	result.matches = matches;
+
+	std::error_code ec;
+	std::filesystem::create_directories(outputDirectory, ec);
+	const std::string path = outputDirectory + "session-bench.bin";
+	std::filesystem::remove(path, ec);
+
+	// the same made-up matches every run
+	std::vector<MatchSummary> summaries(matches);
+	uint32_t state = 0x5E55u;
+	int mmr = 1000;
+	for (size_t i = 0; i < matches; i++)
+	{
+		MatchSummary& summary = summaries[i];
+		summary.Begin(i + 1, 11, 300, mmr);
+		summary.SetLocalTeam(0);
+
+		state = state * 1664525u + 1013904223u;
+		const int goals = (state >> 24) % 9;
+		for (int goal = 0; goal < goals; goal++)
+		{
+			GoalEvent event{};
+			event.team = static_cast<uint8_t>((state >> goal) & 1);
+			event.clockSeconds = static_cast<int16_t>(300 - goal * 30);
+			event.elapsedMs = static_cast<uint32_t>(goal * 30000);
+			summary.OnGoal(event);
+		}
+		summary.End(MatchOutcome::Completed, 300000 + (state >> 16) % 60000);
+
+		const int after = mmr + static_cast<int>((state >> 8) % 21) - 10;
+		summary.SetMmr(mmr, after);
+		mmr = after;
+	}
+
+	const int64_t firstEndMs = LocalDayStartMs(1700000000000) + 22 * SESSION_HOUR_MS;
+	const auto endTimeMs = [firstEndMs](size_t i) {
+		return firstEndMs + static_cast<int64_t>(i) * 7 * 60 * 1000;
+	};
+
+	SessionAggregator session;
+	session.Load(path, firstEndMs);
+
+	double addNs = 0.0;
+	double saveUs = 0.0;
+	for (size_t i = 0; i < matches; i++)
+	{
+		Clock::time_point start = Clock::now();
+		session.Add(summaries[i], endTimeMs(i));
+		addNs += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+		start = Clock::now();
+		session.Save();
+		saveUs += std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+	}
+	result.addNs = matches ? addNs / matches : 0.0;
+	result.saveUs = matches ? saveUs / matches : 0.0;
+
+	const int64_t nowMs = matches ? endTimeMs(matches - 1) : firstEndMs;
+	SessionAggregator restored;
+	const Clock::time_point start = Clock::now();
+	restored.Load(path, nowMs);
+	result.loadUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+	result.isSame = restored.ToJson(nowMs) == session.ToJson(nowMs);
+	std::filesystem::remove(path, ec);
+	return result;
+}
+
+std::vector<EncodingResult> RunEncodingBenchmark(const json& document, int iterations)
+{
+	std::vector<EncodingResult> results;
+
+	for (int i = 0; i < EXPORT_FORMAT_COUNT; i++)
+	{
+		EncodingResult result;
+		result.format = static_cast<ExportFormat>(i);
+
+		const Clock::time_point start = Clock::now();
+		for (int iteration = 0; iteration < iterations; iteration++) {
+			result.bytes = EncodeMatchDocument(document, result.format).size();
+		}
+		const double elapsedUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+		result.encodeUs = iterations > 0 ? elapsedUs / iterations : 0.0;
+		results.push_back(result);
+	}
+	return results;
+}
+
+std::string FormatEncodingBenchmark(const std::vector<EncodingResult>& results)
+{
+	std::string report;
+	char line[256];
+
+	for (const EncodingResult& result : results)
+	{
+		snprintf(line, sizeof(line), "  %-13s %8zu bytes  encode %9.2fus\n",
+			ExportFormatName(result.format), result.bytes, result.encodeUs);
+		report += line;
+	}
+	return report;
+}
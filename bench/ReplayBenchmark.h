@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ExportFormat.h"
+#include "ScriptedMatches.h"
+
+struct HookTiming {
+    std::string name;
+    uint64_t calls = 0;
+    double meanUs = 0.0;
+    double p50Us = 0.0;
+    double p99Us = 0.0;
+    double maxUs = 0.0;
+};
+
+struct ScenarioResult {
+    MatchScenario scenario = MatchScenario::Ranked1v1;
+    int matches = 0;
+    double hookSeconds = 0.0;       // time spent inside hook callbacks and timeouts
+    double totalSeconds = 0.0;      // wall time including draining the export worker
+    double matchesPerSecond = 0.0;
+    double allocationsPerMatch = 0.0;               // every thread, export worker included
+    double gameThreadAllocationsPerMatch = 0.0;     // hooks and timeouts only
+    std::vector<HookTiming> hooks;
+};
+
+// size of the fake replay the benchmark host writes at match end
+#define BENCH_REPLAY_BYTES (4 * 1024 * 1024)
+
+// Replays scripted matches for every scenario through a FakeGameHost and a
+// real StatPullerCore, writing exports to outputDirectory.
+std::vector<ScenarioResult> RunReplayBenchmark(const std::string& outputDirectory, int matchesPerScenario, size_t replayBytes = BENCH_REPLAY_BYTES);
+
+std::string FormatReplayBenchmark(const std::vector<ScenarioResult>& results);
+
+struct GoalCaptureResult {
+    int matches = 0;
+    int goalsPerMatch = 0;
+    double jsonNs = 0.0;                // per goal, a json object pushed into a std::vector<json>
+    double structNs = 0.0;              // per goal, a GoalEvent into a GoalBuffer with interned names
+    double jsonAllocations = 0.0;       // per goal
+    double structAllocations = 0.0;
+    int64_t jsonBytes = 0;              // held at match end, before the export
+    int64_t structBytes = 0;            // GoalBuffer and player table
+};
+
+// Captures the same goals both ways: as the plugin did before GoalEvent,
+// and as the core does now.
+GoalCaptureResult MeasureGoalCapture(int matches, int goalsPerMatch);
+
+struct ExportHandoffResult {
+    int matches = 0;
+    int dropped = 0;                // export queue full when the match ended
+    double p50Us = 0.0;             // filling the snapshot and ExportWorker::Submit, on the game thread
+    double p99Us = 0.0;
+    double maxUs = 0.0;
+    double inlineP50Us = 0.0;       // building and writing the same match on the game thread instead
+    double inlineP99Us = 0.0;
+};
+
+// Ends synthetic matches back to back into an ExportWorker whose handler
+// serializes and writes each one, timing what the match end hook pays.
+ExportHandoffResult MeasureExportHandoff(const std::string& outputDirectory, int matches);
+
+// Mean time for the fake host to write a replay of replayBytes, i.e. what
+// the game thread blocked on when it exported the replay itself.
+double MeasureReplayWriteMs(const std::string& outputDirectory, size_t replayBytes, int iterations);
+
+// Mean cost on the calling thread of a log statement with a string and two
+// integer arguments, with a drain thread consuming the records.
+double MeasureLogWriteNs(int iterations);
+
+struct LiveReadResult {
+    uint64_t writes = 0;
+    uint64_t reads = 0;             // consistent snapshots returned
+    uint64_t busyReads = 0;         // gave up, writer mid-update every attempt
+    uint64_t tornReads = 0;         // returned but inconsistent, must stay 0
+    double readNs = 0.0;            // mean per Read call
+};
+
+// A writer thread updates live-match.bin as fast as it can while this
+// thread polls it through LiveMatchReader and checks every snapshot.
+LiveReadResult MeasureLiveReads(const std::string& outputDirectory, int milliseconds);
+
+struct FanoutResult {
+    int subscribers = 0;            // connected and upgraded to WebSocket
+    int events = 0;
+    uint64_t framesReceived = 0;    // must come to subscribers * events
+    double publishUs = 0.0;         // mean cost of Publish to the caller
+    double deliveryMs = 0.0;        // first Publish until the last subscriber has every event
+    double matchRequestMs = 0.0;    // mean GET /match round trip
+};
+
+// Starts a StatsServer on a free port, connects subscribers WebSocket
+// clients and publishes events goal events to all of them.
+FanoutResult MeasureServerFanout(const std::string& outputDirectory, int subscribers, int events);
+
+struct HistoryQueryResult {
+    size_t matches = 0;
+    double appendUs = 0.0;          // mean HistoryStore::Append, sealing included
+    double loadMs = 0.0;            // opening the store from disk
+    double lastMatchesMs = 0.0;     // select and summarize the last 500 ranked doubles
+    double winRateByMmrMs = 0.0;    // over every match
+    double goalsByMinuteMs = 0.0;   // over every match
+    double mmrTrendMs = 0.0;        // one playlist, 100 points
+    size_t blocksSkipped = 0;       // by the block stats in a one-month query
+};
+
+// Fills a history store with matches of synthetic data and times the
+// aggregate queries over it.
+HistoryQueryResult MeasureHistoryQueries(const std::string& outputDirectory, size_t matches);
+
+struct SummaryTimingResult {
+    size_t goals = 0;
+    double perGoalNs = 0.0;         // MatchSummary::OnGoal, paid during the match
+    double matchEndUs = 0.0;        // End and ToJson, all match end waits for in process
+    double fromFileUs = 0.0;        // read, parse and recompute from the match file
+    bool isSame = false;            // both ways agree on score, timeline and minutes
+};
+
+// Time to a finished summary at match end: kept up to date in process
+// against recomputed from the exported file, as build_summary.py does
+// (before its interpreter start-up, which comes on top).
+SummaryTimingResult MeasureSummaryTiming(const std::string& outputDirectory, const json& document, int iterations);
+
+struct SessionUpdateResult {
+    size_t matches = 0;
+    double addNs = 0.0;             // mean SessionAggregator::Add, windows included
+    double saveUs = 0.0;            // mean snapshot write, once per match
+    double loadUs = 0.0;            // restoring the snapshot, as on a reload
+    bool isSame = false;            // the restored session reports the same windows
+};
+
+// Adds matches to a session spread over two days, one every few minutes,
+// and reloads it from its snapshot.
+SessionUpdateResult MeasureSessionUpdates(const std::string& outputDirectory, size_t matches);
+
+struct EncodingResult {
+    ExportFormat format = ExportFormat::Json;
+    size_t bytes = 0;
+    double encodeUs = 0.0;      // mean over the iterations
+};
+
+// Encodes the same match document in every export format.
+std::vector<EncodingResult> RunEncodingBenchmark(const json& document, int iterations);
+
+std::string FormatEncodingBenchmark(const std::vector<EncodingResult>& results);
@@ -0,0 +1,73 @@
+"""Long-lived post-processing worker for the Stat Puller plugin.
+
+Copy this file next to clip.py and build_summary.py (PYTHON_SCRIPT_PATH).
+The plugin starts it once with pythonw.exe and writes requests to its
+stdin, each framed as a 4 byte little-endian length followed by a JSON
+body: {"script": "clip.py", "args": {...}}.
+
+Requested scripts run in this interpreter as __main__, so imports stay
+warm between goals. "args" is passed to the script as a JSON string in
+sys.argv[1]. The worker exits when the plugin closes the pipe.
+"""
+
+import json
+import os
+import runpy
+import struct
+import sys
+import traceback
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+LOG_PATH = os.path.join(SCRIPT_DIR, "postprocess_worker.log")
+
+
+def log(message):
+    with open(LOG_PATH, "a", encoding="utf-8") as f:
+        f.write(message + "\n")
+
+
+def read_exact(stream, size):
+    data = b""
+    while len(data) < size:
+        chunk = stream.read(size - len(data))
+        if not chunk:
+            return None
+        data += chunk
+    return data
+
+
+def run_request(request):
+    script = os.path.join(SCRIPT_DIR, os.path.basename(request["script"]))
+    saved_argv = sys.argv
+    sys.argv = [script, json.dumps(request.get("args", {}))]
+    try:
+        runpy.run_path(script, run_name="__main__")
+    except SystemExit:
+        pass
+    except Exception:
+        log(traceback.format_exc())
+    finally:
+        sys.argv = saved_argv
+
+
+def main():
+    # pythonw leaves sys.stdin unset in some setups, the pipe is still fd 0
+    stream = sys.stdin.buffer if sys.stdin else os.fdopen(0, "rb")
+    while True:
+        header = read_exact(stream, 4)
+        if header is None:
+            return
+        (size,) = struct.unpack("<I", header)
+        body = read_exact(stream, size)
+        if body is None:
+            return
+        try:
+            request = json.loads(body.decode("utf-8"))
+        except ValueError:
+            log("bad request: %r" % body[:200])
+            continue
+        run_request(request)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+// Just enough of a test framework to keep the tests free of dependencies.
+// TEST registers a case under a suite, CHECK and CHECK_EQ record a failure
+// and carry on, REQUIRE stops the case.
+
+using TestFn = void (*)();
+
+bool RegisterTest(const char* suite, const char* name, TestFn fn);
+void ReportFailure(const char* file, int line, const std::string& message);
+
+// empty directory for the running test, with a trailing separator
+std::string TestDirectory();
+
+struct TestAbort {};
+
+#define TEST(suite, name) \
+    static void suite##_##name(); \
+    static const bool suite##_##name##_registered = RegisterTest(#suite, #name, suite##_##name); \
+    static void suite##_##name()
+
+#define CHECK(condition) \
+    do { if (!(condition)) ReportFailure(__FILE__, __LINE__, "CHECK(" #condition ")"); } while (0)
+
+#define CHECK_EQ(actual, expected) \
+    do { \
+        const auto& checkActual = (actual); \
+        const auto& checkExpected = (expected); \
+        if (!(checkActual == checkExpected)) { \
+            std::ostringstream checkMessage; \
+            checkMessage << #actual " == " #expected ", got " << checkActual << " and " << checkExpected; \
+            ReportFailure(__FILE__, __LINE__, checkMessage.str()); \
+        } \
+    } while (0)
+
+#define REQUIRE(condition) \
+    do { if (!(condition)) { ReportFailure(__FILE__, __LINE__, "REQUIRE(" #condition ")"); throw TestAbort(); } } while (0)
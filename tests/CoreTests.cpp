@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <string>
+
+#include "Check.h"
+#include "ClipQueue.h"
+#include "FakeGameHost.h"
+#include "HookNames.h"
+#include "ScriptedMatches.h"
+#include "StatPullerConfig.h"
+#include "StatPullerCore.h"
+
+static json ReadDocument(const std::string& path)
+{
+	std::ifstream file(path);
+	return json::parse(file, nullptr, false);
+}
+
+static size_t CountTickers(FakeGameHost& host, const std::vector<ScriptStep>& steps, const std::string& statEvent)
+{
+	size_t count = 0;
+	for (const ScriptStep& step : steps) {
+		if (step.kind == ScriptStep::Kind::StatTicker && host.GetStatEventName(step.ticker.statEvent) == statEvent) count++;
+	}
+	return count;
+}
+
+TEST(StatPullerCore, ExportsScriptedMatch)
+{
+	const std::string directory = TestDirectory();
+
+	FakeGameHost host;
+	StatPullerCore core(host, directory);
+	core.Start();
+
+	const std::vector<ScriptStep> steps = BuildScriptedMatch(host, MatchScenario::Ranked2v2, 7);
+	const float mmrBefore = host.mmr[11];
+	host.Run(steps);
+	core.Stop();
+
+	const json document = ReadDocument(directory + "last-match-stats.json");
+	REQUIRE(!document.is_discarded());
+	CHECK_EQ(document["Version"], STAT_PULLER_VERSION);
+	CHECK_EQ(document["Playlist"], 11);
+	CHECK_EQ(document["TeamSize"], 2);
+	CHECK_EQ(document["Outcome"], "completed");
+	CHECK_EQ(document["Players"].size(), 4u);
+	CHECK_EQ(document["Goals"].size(), CountTickers(host, steps, "Goal"));
+	CHECK_EQ(document["MMR_Before"].get<float>(), mmrBefore);
+	CHECK_EQ(document["MMR_After"].get<float>(), host.mmr[11]);
+	CHECK(document["MMR_Settled"].get<bool>());
+}
+
+// seconds into the script of the first step firing the hook, -1 if none
+static double HookTime(const std::vector<ScriptStep>& steps, const std::string& eventName)
+{
+	for (const ScriptStep& step : steps) {
+		if (step.kind == ScriptStep::Kind::Hook && step.eventName == eventName) return step.time;
+	}
+	return -1.0;
+}
+
+TEST(StatPullerCore, TimesMatchOnHostClock)
+{
+	const std::string directory = TestDirectory();
+
+	FakeGameHost host;
+	host.Advance(5.0);
+	StatPullerCore core(host, directory);
+	core.Start();
+
+	const double scriptStart = host.Now();
+	const std::vector<ScriptStep> steps = BuildScriptedMatch(host, MatchScenario::Ranked2v2, 7);
+	host.Run(steps);
+	core.Stop();
+
+	const json document = ReadDocument(directory + "last-match-stats.json");
+	REQUIRE(!document.is_discarded());
+
+	const double started = scriptStart + HookTime(steps, HOOK_ALL_TEAMS_CREATED);
+	const double ended = scriptStart + HookTime(steps, HOOK_MATCH_ENDED);
+	const int64_t durationMs = static_cast<int64_t>((ended - started) * 1000.0 + 0.5);
+	CHECK_EQ(document["MatchStartWallClockMs"].get<int64_t>(), host.wallClockStartMs + static_cast<int64_t>(started * 1000.0));
+	CHECK_EQ(document["Summary"]["DurationMs"].get<int64_t>(), durationMs);
+
+	// one match in the session so far
+	const json& session = document["Session"]["Today"];
+	CHECK_EQ(session["Matches"].get<int>(), 1);
+	const double goalsFor = session["GoalsFor"].get<double>();
+	CHECK(goalsFor > 0.0);
+	const double perMinute = session["GoalsForPerMinute"].get<double>();
+	CHECK(perMinute > goalsFor / (durationMs / 60000.0) - 1e-6);
+	CHECK(perMinute < goalsFor / (durationMs / 60000.0) + 1e-6);
+}
+
+TEST(StatPullerCore, ExportsEarlyExit)
+{
+	const std::string directory = TestDirectory();
+
+	FakeGameHost host;
+	StatPullerCore core(host, directory);
+	core.Start();
+	host.Run(BuildScriptedMatch(host, MatchScenario::EarlyExit, 3));
+	// the match ends with Destroyed, the last step; let the export timeout run
+	host.Advance(1.0);
+	core.Stop();
+
+	const json document = ReadDocument(directory + "last-match-stats.json");
+	REQUIRE(!document.is_discarded());
+	CHECK_EQ(document["Outcome"], "early-exit");
+}
+
+TEST(StatPullerCore, NumbersEachExport)
+{
+	const std::string directory = TestDirectory();
+
+	FakeGameHost host;
+	StatPullerCore core(host, directory);
+	core.Start();
+	for (uint32_t seed = 1; seed <= 3; seed++) {
+		host.Run(BuildScriptedMatch(host, MatchScenario::Ranked1v1, seed));
+	}
+	core.Stop();
+
+	const json document = ReadDocument(directory + "last-match-stats.json");
+	REQUIRE(!document.is_discarded());
+	CHECK_EQ(document["Sequence"], 3);
+	CHECK_EQ(document["Playlist"], 10);
+}
+
+TEST(StatPullerCore, WritesReplayOffGameThread)
+{
+	const std::string directory = TestDirectory();
+	const std::string replayPath = directory + "last-match-replay.replay";
+
+	FakeGameHost host;
+	host.replayBytes = 1 << 20;
+
+	std::promise<void> started;
+	std::promise<void> release;
+	std::shared_future<void> isReleased = release.get_future().share();
+	host.onWriteReplay = [&started, isReleased] {
+		started.set_value();
+		// bounded, so a write on the game thread fails the test instead of hanging it
+		isReleased.wait_for(std::chrono::seconds(10));
+	};
+
+	StatPullerCore core(host, directory);
+	core.Start();
+
+	// the capture timeout fires within the match script or the advance after it
+	host.Run(BuildScriptedMatch(host, MatchScenario::Ranked1v1, 3));
+	host.Advance(5.0);
+
+	// the game thread is back while the write is still held up
+	REQUIRE(started.get_future().wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+	CHECK(!std::filesystem::exists(replayPath));
+	CHECK_EQ(host.replaysExported.load(), 0u);
+
+	release.set_value();
+	core.Stop();
+
+	CHECK_EQ(host.replaysExported.load(), 1u);
+	std::error_code ec;
+	CHECK_EQ(std::filesystem::file_size(replayPath, ec), static_cast<uintmax_t>(host.replayBytes));
+}
+
+TEST(StatPullerCore, ClipsLastGoalAfterDelay)
+{
+	const std::string directory = TestDirectory();
+
+	FakeGameHost host;
+	StatPullerCore core(host, directory);
+	core.Start();
+
+	// up to the match end, which comes with the local overtime winner
+	std::vector<ScriptStep> steps = BuildScriptedMatch(host, MatchScenario::Overtime, 5);
+	const double ended = HookTime(steps, HOOK_MATCH_ENDED);
+	REQUIRE(ended > 0.0);
+	steps.erase(std::remove_if(steps.begin(), steps.end(), [ended](const ScriptStep& step) {
+		return step.time > ended;
+	}), steps.end());
+
+	auto clipRequests = [&host] {
+		std::vector<json> requests;
+		std::lock_guard<std::mutex> lock(host.mutex);
+		for (size_t i = 0; i < host.scriptsRun.size(); i++) {
+			if (host.scriptsRun[i] == "clip.py") requests.push_back(host.scriptArgs[i]);
+		}
+		return requests;
+	};
+
+	host.Run(steps);
+	const size_t atMatchEnd = clipRequests().size();
+
+	// not before the winner has CLIP_DELAY of footage
+	host.Advance(CLIP_DELAY - 0.5);
+	CHECK_EQ(clipRequests().size(), atMatchEnd);
+	host.Advance(1.0);
+	const std::vector<json> requests = clipRequests();
+	core.Stop();
+
+	REQUIRE(requests.size() == atMatchEnd + 1);
+	const json& lastGoal = requests.back()["Goals"].back();
+	CHECK(lastGoal["IsOvertime"].get<bool>());
+	CHECK(lastGoal["AgeSeconds"].get<float>() >= CLIP_DELAY);
+}
@@ -0,0 +1,110 @@
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Check.h"
+#include "ExportWorker.h"
+
+static MatchSnapshot SnapshotWithId(uint64_t matchId)
+{
+	MatchSnapshot snapshot;
+	snapshot.matchId = matchId;
+	return snapshot;
+}
+
+TEST(ExportWorker, ExportsInOrder)
+{
+	std::vector<uint64_t> exported;
+
+	Logger logger;
+	ExportWorker worker(logger);
+	worker.Start([&exported](MatchSnapshot& snapshot) {
+		exported.push_back(snapshot.matchId);
+	});
+	for (uint64_t id = 1; id <= 5; id++)
+	{
+		CHECK(worker.Submit(SnapshotWithId(id)));
+		// one at a time, well under the queue's capacity
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	worker.Stop();
+
+	CHECK_EQ(exported.size(), 5u);
+	for (size_t i = 0; i < exported.size(); i++) {
+		CHECK_EQ(exported[i], i + 1);
+	}
+}
+
+TEST(ExportWorker, StopFinishesQueuedMatches)
+{
+	std::atomic<int> exported{ 0 };
+
+	Logger logger;
+	ExportWorker worker(logger, 8);
+	worker.Start([&exported](MatchSnapshot&) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		exported++;
+	});
+	for (uint64_t id = 1; id <= 8; id++) {
+		worker.Submit(SnapshotWithId(id));
+	}
+	worker.Stop();
+
+	CHECK_EQ(exported.load(), 8);
+}
+
+TEST(ExportWorker, RejectsWhenFull)
+{
+	std::promise<void> release;
+	std::shared_future<void> released = release.get_future().share();
+	std::promise<void> started;
+
+	Logger logger;
+	ExportWorker worker(logger, 2);
+	worker.Start([&](MatchSnapshot& snapshot) {
+		if (snapshot.matchId == 1) {
+			started.set_value();
+			released.wait();
+		}
+	});
+
+	// the worker holds the first match, the queue takes two more
+	REQUIRE(worker.Submit(SnapshotWithId(1)));
+	started.get_future().wait();
+	CHECK(worker.Submit(SnapshotWithId(2)));
+	CHECK(worker.Submit(SnapshotWithId(3)));
+	CHECK(!worker.Submit(SnapshotWithId(4)));
+
+	release.set_value();
+	worker.Stop();
+	CHECK(!worker.Submit(SnapshotWithId(5)));
+}
+
+TEST(ExportWorker, SurvivesThrowingHandler)
+{
+	std::vector<std::string> lines;
+	std::vector<uint64_t> exported;
+
+	Logger logger;
+	logger.Start([&lines](const std::string& line) { lines.push_back(line); }, "");
+	{
+		ExportWorker worker(logger);
+		worker.Start([&exported](MatchSnapshot& snapshot) {
+			if (snapshot.matchId == 1) throw std::runtime_error("bad player name");
+			exported.push_back(snapshot.matchId);
+		});
+		CHECK(worker.Submit(SnapshotWithId(1)));
+		CHECK(worker.Submit(SnapshotWithId(2)));
+		worker.Stop();
+	}
+	logger.Stop();
+
+	REQUIRE(exported.size() == 1u);
+	CHECK_EQ(exported[0], 2u);
+	REQUIRE(lines.size() == 1u);
+	CHECK_EQ(lines[0], std::string("StatPuller: ERROR: Could not export match 1: bad player name"));
+}
@@ -0,0 +1,306 @@
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "HistoryStore.h"
+#include "MatchState.h"
+#include "MatchSummary.h"
+
+#define HISTORY_TAIL_RECORD_BYTES (8 + sizeof(HistoryRow))
+
+// one match a minute; the second block is all ranked standard
+static HistoryRow SyntheticRow(size_t index)
+{
+	HistoryRow row{};
+	row.matchId = index + 1;
+	row.startTimeMs = 1000000 + static_cast<int64_t>(index) * 60000;
+	row.playlist = index / HISTORY_BLOCK_ROWS == 1 ? 13 : (index % 2 ? 11 : 10);
+	row.mmrBefore = 1000 + static_cast<int32_t>(index % 100);
+	row.mmrAfter = row.mmrBefore + 9;
+	row.team = 0;
+	row.goalsFor = static_cast<uint16_t>(index % 3 == 0 ? 3 : 1);
+	row.goalsAgainst = 2;
+	row.result = static_cast<uint8_t>(row.goalsFor > row.goalsAgainst ? HistoryResult::Win : HistoryResult::Loss);
+	row.outcome = static_cast<uint8_t>(index % 10 == 9 ? MatchOutcome::EarlyExit : MatchOutcome::Completed);
+	row.goalsForByMinute[0] = static_cast<uint8_t>(row.goalsFor);
+	row.goalsAgainstByMinute[4] = static_cast<uint8_t>(row.goalsAgainst);
+	return row;
+}
+
+static void AppendRows(HistoryStore& store, size_t from, size_t to)
+{
+	for (size_t i = from; i < to; i++) {
+		REQUIRE(store.Append(SyntheticRow(i)));
+	}
+}
+
+static std::vector<char> ReadFile(const std::string& path)
+{
+	std::ifstream in(path, std::ios::binary);
+	return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static void WriteFile(const std::string& path, const std::vector<char>& data)
+{
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out.write(data.data(), data.size());
+}
+
+TEST(HistoryStore, ReloadsSealedBlocksAndTail)
+{
+	const std::string path = TestDirectory() + "history.bin";
+	const size_t rows = 2 * HISTORY_BLOCK_ROWS + 10;
+	{
+		HistoryStore store;
+		REQUIRE(store.Open(path, true));
+		AppendRows(store, 0, rows);
+	}
+
+	HistoryStore store;
+	REQUIRE(store.Open(path, false));
+	CHECK_EQ(store.Count(), rows);
+	REQUIRE(store.Blocks().size() == 3u);
+	CHECK_EQ(store.Blocks()[0].rows, static_cast<uint32_t>(HISTORY_BLOCK_ROWS));
+	CHECK_EQ(store.Blocks()[2].rows, 10u);
+
+	// read-only never appends
+	CHECK(!store.Append(SyntheticRow(rows)));
+
+	const std::vector<uint32_t> all = store.Select(HistoryFilter());
+	REQUIRE(all.size() == rows);
+	CHECK_EQ(all.front(), 0u);
+	CHECK_EQ(all.back(), static_cast<uint32_t>(rows - 1));
+}
+
+TEST(HistoryStore, FiltersUseBlockRanges)
+{
+	const std::string path = TestDirectory() + "history.bin";
+	HistoryStore store;
+	REQUIRE(store.Open(path, true));
+	AppendRows(store, 0, 3 * HISTORY_BLOCK_ROWS);
+
+	const int playlist = static_cast<int>(HistoryStat::Playlist);
+	CHECK_EQ(store.Blocks()[1].min[playlist], 13);
+	CHECK_EQ(store.Blocks()[1].max[playlist], 13);
+	CHECK_EQ(store.Blocks()[0].max[playlist], 11);
+
+	HistoryFilter ranked;
+	ranked.playlist = 13;
+	const std::vector<uint32_t> rankedRows = store.Select(ranked);
+	REQUIRE(rankedRows.size() == static_cast<size_t>(HISTORY_BLOCK_ROWS));
+	CHECK_EQ(rankedRows.front(), static_cast<uint32_t>(HISTORY_BLOCK_ROWS));
+
+	// a time window inside the last block, newest 5 of it
+	HistoryFilter window;
+	window.fromMs = SyntheticRow(2 * HISTORY_BLOCK_ROWS + 100).startTimeMs;
+	window.toMs = SyntheticRow(2 * HISTORY_BLOCK_ROWS + 200).startTimeMs;
+	window.lastMatches = 5;
+	const std::vector<uint32_t> windowRows = store.Select(window);
+	REQUIRE(windowRows.size() == 5u);
+	CHECK_EQ(windowRows.front(), static_cast<uint32_t>(2 * HISTORY_BLOCK_ROWS + 195));
+	CHECK_EQ(windowRows.back(), static_cast<uint32_t>(2 * HISTORY_BLOCK_ROWS + 199));
+
+	HistoryFilter mmr;
+	mmr.minMmr = 1090;
+	mmr.maxMmr = 1099;
+	mmr.isCompletedOnly = true;
+	std::vector<uint32_t> expected;
+	for (size_t i = 0; i < 3 * HISTORY_BLOCK_ROWS; i++)
+	{
+		const HistoryRow row = SyntheticRow(i);
+		if (row.mmrBefore >= 1090 && row.outcome == static_cast<uint8_t>(MatchOutcome::Completed)) {
+			expected.push_back(static_cast<uint32_t>(i));
+		}
+	}
+	CHECK(!expected.empty());
+	CHECK(store.Select(mmr) == expected);
+}
+
+TEST(HistoryStore, Aggregates)
+{
+	const std::string path = TestDirectory() + "history.bin";
+	HistoryStore store;
+	REQUIRE(store.Open(path, true));
+	AppendRows(store, 0, 9);
+
+	// rows 0, 3 and 6 are wins, the rest losses
+	const std::vector<uint32_t> rows = store.Select(HistoryFilter());
+	const HistorySummary summary = store.Summarize(rows);
+	CHECK_EQ(summary.matches, 9u);
+	CHECK_EQ(summary.wins, 3u);
+	CHECK_EQ(summary.losses, 6u);
+	CHECK_EQ(summary.goalsFor, 15u);
+	CHECK_EQ(summary.goalsAgainst, 18u);
+	CHECK_EQ(summary.firstMmr, 1000);
+	CHECK_EQ(summary.lastMmr, 1017);
+	CHECK_EQ(summary.longestWinStreak, 1);
+	CHECK_EQ(summary.longestLossStreak, 2);
+	CHECK_EQ(summary.currentStreak, -2);
+
+	const std::vector<MmrBucket> buckets = store.WinRateByMmr(rows, 5);
+	REQUIRE(buckets.size() == 2u);
+	CHECK_EQ(buckets[0].mmr, 1000);
+	CHECK_EQ(buckets[0].matches, 5u);
+	CHECK_EQ(buckets[0].wins, 2u);
+	CHECK_EQ(buckets[1].matches, 4u);
+
+	const std::vector<MmrPoint> trend = store.MmrTrend(rows, 3);
+	REQUIRE(trend.size() == 3u);
+	CHECK_EQ(trend[0].mmr, 1010);
+	CHECK_EQ(trend[2].startTimeMs, SyntheticRow(8).startTimeMs);
+
+	const GoalsByMinute goals = store.GoalsPerMinute(rows);
+	CHECK_EQ(goals.goalsFor[0], 15u);
+	CHECK_EQ(goals.goalsAgainst[4], 18u);
+	CHECK_EQ(goals.goalsFor[4], 0u);
+}
+
+TEST(HistoryStore, DropsTornTailRecord)
+{
+	const std::string path = TestDirectory() + "history.bin";
+	{
+		HistoryStore store;
+		REQUIRE(store.Open(path, true));
+		AppendRows(store, 0, 20);
+	}
+
+	// the last append only got half way
+	std::vector<char> tail = ReadFile(path + ".tail");
+	REQUIRE(tail.size() == 20 * HISTORY_TAIL_RECORD_BYTES);
+	tail.resize(tail.size() - HISTORY_TAIL_RECORD_BYTES / 2);
+	WriteFile(path + ".tail", tail);
+
+	HistoryStore store;
+	REQUIRE(store.Open(path, true));
+	CHECK_EQ(store.Count(), 19u);
+	CHECK_EQ(ReadFile(path + ".tail").size(), 19 * HISTORY_TAIL_RECORD_BYTES);
+
+	AppendRows(store, 19, 25);
+	store.Close();
+	REQUIRE(store.Open(path, false));
+	CHECK_EQ(store.Count(), 25u);
+}
+
+TEST(HistoryStore, RecoversInterruptedSeal)
+{
+	const std::string path = TestDirectory() + "history.bin";
+	std::vector<char> fullTail;
+	{
+		HistoryStore store;
+		REQUIRE(store.Open(path, true));
+		AppendRows(store, 0, HISTORY_BLOCK_ROWS - 1);
+		fullTail = ReadFile(path + ".tail");
+
+		// the record that fills the block, as Append writes it
+		const uint64_t index = HISTORY_BLOCK_ROWS - 1;
+		const HistoryRow row = SyntheticRow(index);
+		const char* indexBytes = reinterpret_cast<const char*>(&index);
+		const char* rowBytes = reinterpret_cast<const char*>(&row);
+		fullTail.insert(fullTail.end(), indexBytes, indexBytes + sizeof(index));
+		fullTail.insert(fullTail.end(), rowBytes, rowBytes + sizeof(row));
+
+		AppendRows(store, HISTORY_BLOCK_ROWS - 1, HISTORY_BLOCK_ROWS);
+	}
+	const std::vector<char> sealed = ReadFile(path);
+	REQUIRE(sealed.size() > 100);
+
+	// block on disk but the tail never emptied: its copies are skipped
+	WriteFile(path + ".tail", fullTail);
+	{
+		HistoryStore store;
+		REQUIRE(store.Open(path, true));
+		CHECK_EQ(store.Count(), static_cast<size_t>(HISTORY_BLOCK_ROWS));
+		CHECK_EQ(ReadFile(path + ".tail").size(), 0u);
+	}
+
+	// block cut short: dropped, then sealed again from the tail
+	std::vector<char> torn = sealed;
+	torn.resize(torn.size() - 100);
+	WriteFile(path, torn);
+	WriteFile(path + ".tail", fullTail);
+	{
+		HistoryStore store;
+		REQUIRE(store.Open(path, true));
+		CHECK_EQ(store.Count(), static_cast<size_t>(HISTORY_BLOCK_ROWS));
+	}
+	CHECK(ReadFile(path) == sealed);
+
+	// a corrupt block body fails its checksum and isn't loaded
+	std::vector<char> corrupt = sealed;
+	corrupt.back() ^= 0x55;
+	WriteFile(path, corrupt);
+	HistoryStore store;
+	REQUIRE(store.Open(path, false));
+	CHECK_EQ(store.Count(), 0u);
+}
+
+static json MatchDocument()
+{
+	json document;
+	document["MatchId"] = 7;
+	document["MatchStartWallClockMs"] = 1767225600000LL;
+	document["Playlist"] = 11;
+	document["ClockLength"] = 300;
+	document["MMR_Before"] = 1000;
+	document["MMR_After"] = 1009;
+	document["Outcome"] = "completed";
+	document["Players"] = { "Blue", "Orange" };
+	document["PlayerStats"] = { { "Player", { 0, 1 } }, { "Team", { 0, 1 } }, { "IsLocal", { false, true } } };
+	document["Goals"] = {
+		{ { "ScorerName", "Blue" }, { "ScorerTeam", 0 }, { "GoalTimeSeconds", 250 }, { "IsOvertime", false } },
+		{ { "ScorerName", "Orange" }, { "ScorerTeam", 1 }, { "GoalTimeSeconds", 100 }, { "IsOvertime", false } },
+		{ { "ScorerName", "Orange" }, { "ScorerTeam", 1 }, { "OvertimeSeconds", 30 }, { "IsOvertime", true } },
+	};
+	return document;
+}
+
+TEST(HistoryStore, RowFromDocumentMatchesSummary)
+{
+	json document = MatchDocument();
+	HistoryRow row;
+	REQUIRE(HistoryRowFromDocument(document, row));
+	CHECK_EQ(row.matchId, 7u);
+	CHECK_EQ(row.team, 1);
+	CHECK_EQ(row.goalsFor, 2);
+	CHECK_EQ(row.goalsAgainst, 1);
+	CHECK_EQ(row.goalsForByMinute[5], 1);
+	CHECK_EQ(row.isOvertime, 1);
+	CHECK_EQ(row.result, static_cast<uint8_t>(HistoryResult::Win));
+	CHECK_EQ(row.result, static_cast<uint8_t>(SummaryFromDocument(document).Result()));
+
+	// leaving is a loss in both, whatever the score
+	document["Outcome"] = "early-exit";
+	REQUIRE(HistoryRowFromDocument(document, row));
+	CHECK_EQ(row.result, static_cast<uint8_t>(HistoryResult::Loss));
+	CHECK_EQ(row.result, static_cast<uint8_t>(SummaryFromDocument(document).Result()));
+}
+
+TEST(HistoryStore, RowFromMalformedDocument)
+{
+	HistoryRow row;
+	CHECK(!HistoryRowFromDocument(json(), row));
+	CHECK(!HistoryRowFromDocument(json::array(), row));
+
+	json document = MatchDocument();
+	document["MatchId"] = nullptr;
+	CHECK(!HistoryRowFromDocument(document, row));
+
+	// an older or damaged record: nulls and wrong types read as unknown
+	document = MatchDocument();
+	document["MatchStartWallClockMs"] = nullptr;
+	document["Playlist"] = "ranked";
+	document["MMR_After"] = nullptr;
+	document["PlayerStats"]["IsLocal"] = { nullptr, true };
+	document["PlayerStats"]["Team"] = { 0, nullptr };
+	document["Goals"][0]["ScorerTeam"] = nullptr;
+	document["Events"] = { { "Type", nullptr }, { "Receiver", { "x" } }, { "MatchTimeMs", { nullptr } } };
+	REQUIRE(HistoryRowFromDocument(document, row));
+	CHECK_EQ(row.matchId, 7u);
+	CHECK_EQ(row.startTimeMs, 0);
+	CHECK_EQ(row.playlist, -1);
+	CHECK_EQ(row.mmrAfter, -1);
+	CHECK_EQ(row.team, 0xFF);
+	CHECK_EQ(row.result, static_cast<uint8_t>(HistoryResult::Unknown));
+}
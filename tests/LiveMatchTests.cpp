@@ -0,0 +1,116 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "Check.h"
+#include "LiveMatchFile.h"
+#include "LiveMatchReader.h"
+
+// every field the writer touches comes from one counter, so a snapshot
+// mixing two updates can't pass
+static void FillLiveData(LiveMatchData& live, uint32_t value)
+{
+	live.matchId = value;
+	live.tick = value;
+	live.elapsedMs = value * 7;
+	live.secondsRemaining = static_cast<int16_t>(value);
+	live.playerCount = static_cast<uint8_t>(value);
+	for (LivePlayer& player : live.players) {
+		player.goals = static_cast<uint16_t>(value);
+	}
+	for (LiveGoal& goal : live.goals) {
+		goal.tick = value;
+	}
+}
+
+static bool IsLiveDataConsistent(const LiveMatchData& live)
+{
+	const uint32_t value = live.tick;
+	if (live.matchId != value || live.elapsedMs != value * 7) return false;
+	if (live.secondsRemaining != static_cast<int16_t>(value) || live.playerCount != static_cast<uint8_t>(value)) return false;
+
+	for (const LivePlayer& player : live.players) {
+		if (player.goals != static_cast<uint16_t>(value)) return false;
+	}
+	for (const LiveGoal& goal : live.goals) {
+		if (goal.tick != value) return false;
+	}
+	return true;
+}
+
+TEST(LiveMatch, ReaderSeesWriterUpdates)
+{
+	const std::string path = TestDirectory() + "live-match.bin";
+
+	LiveMatchFile writer;
+	REQUIRE(writer.Open(path));
+	LiveMatchReader reader;
+	REQUIRE(reader.Open(path));
+
+	writer.Update([](LiveMatchData& live) {
+		live.matchId = 42;
+		CopyLiveName(live.players[0].name, "Player");
+	});
+
+	LiveMatchData data;
+	uint64_t sequence = 0;
+	REQUIRE(reader.Read(data, 64, &sequence));
+	CHECK_EQ(data.matchId, 42u);
+	CHECK_EQ(data.mmrBefore, -1);
+	CHECK_EQ(data.updates, 1u);
+	CHECK_EQ(std::string(data.players[0].name), std::string("Player"));
+	CHECK_EQ(sequence % 2, 0u);
+}
+
+TEST(LiveMatch, NoTornReadsUnderConcurrentWrites)
+{
+	const std::string path = TestDirectory() + "live-match.bin";
+
+	LiveMatchFile writer;
+	REQUIRE(writer.Open(path));
+	LiveMatchReader reader;
+	REQUIRE(reader.Open(path));
+
+	std::atomic<bool> isRunning{ true };
+	std::thread writerThread([&writer, &isRunning] {
+		uint32_t value = 0;
+		while (isRunning.load(std::memory_order_relaxed))
+		{
+			value++;
+			writer.Update([value](LiveMatchData& live) {
+				FillLiveData(live, value);
+			});
+		}
+	});
+
+	uint64_t reads = 0;
+	uint64_t torn = 0;
+	uint32_t lastSeen = 0;
+	bool isMonotonic = true;
+	LiveMatchData snapshot;
+
+	const auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+	while (std::chrono::steady_clock::now() < end)
+	{
+		if (!reader.Read(snapshot)) continue;
+
+		if (!IsLiveDataConsistent(snapshot)) {
+			torn++;
+		}
+		else {
+			reads++;
+			if (snapshot.tick < lastSeen) isMonotonic = false;
+			lastSeen = snapshot.tick;
+		}
+	}
+
+	isRunning = false;
+	writerThread.join();
+
+	CHECK_EQ(torn, 0u);
+	CHECK(reads > 0);
+	CHECK(lastSeen > 0);
+	CHECK(isMonotonic);
+}
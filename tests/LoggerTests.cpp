@@ -0,0 +1,86 @@
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Check.h"
+#include "Logger.h"
+
+TEST(Logger, ReusesRingsOfExitedThreads)
+{
+	std::mutex linesMutex;
+	std::vector<std::string> lines;
+	auto lineCount = [&] {
+		std::lock_guard<std::mutex> lock(linesMutex);
+		return lines.size();
+	};
+
+	Logger logger;
+	logger.Start([&](const std::string& line) {
+		std::lock_guard<std::mutex> lock(linesMutex);
+		lines.push_back(line);
+	}, "");
+
+	// like the stats server thread, recreated on every port change
+	for (int i = 0; i < 20; i++)
+	{
+		std::thread([&logger, i] {
+			SP_LOG_INFO(logger, "thread {}", i);
+		}).join();
+
+		// a ring is only handed out again once it's drained
+		for (int wait = 0; wait < 200 && lineCount() < static_cast<size_t>(i + 1); wait++) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+	}
+	CHECK_EQ(logger.RingCount(), 1u);
+
+	// two threads logging at once need two rings
+	std::promise<void> bothLogged;
+	std::shared_future<void> released = bothLogged.get_future().share();
+	std::promise<void> firstLogged;
+	std::thread first([&] {
+		SP_LOG_INFO(logger, "first");
+		firstLogged.set_value();
+		released.wait();
+	});
+	firstLogged.get_future().wait();
+	std::thread second([&] {
+		SP_LOG_INFO(logger, "second");
+	});
+	second.join();
+	bothLogged.set_value();
+	first.join();
+	logger.Stop();
+
+	CHECK_EQ(logger.RingCount(), 2u);
+	REQUIRE(lines.size() == 22u);
+	CHECK_EQ(lines[0], std::string("StatPuller: thread 0"));
+	CHECK_EQ(lines[19], std::string("StatPuller: thread 19"));
+}
+
+TEST(Logger, ThreadOutlivesLogger)
+{
+	std::unique_ptr<Logger> logger(new Logger());
+	std::promise<void> logged;
+	std::promise<void> release;
+
+	// the thread exits after the logger is gone and still hands its ring
+	// back; the sanitizer builds catch a ring freed under it
+	std::thread thread([&] {
+		SP_LOG_INFO(*logger, "before");
+		logged.set_value();
+		release.get_future().wait();
+	});
+	logged.get_future().wait();
+	logger.reset();
+	release.set_value();
+	thread.join();
+
+	Logger next;
+	SP_LOG_INFO(next, "after");
+	CHECK_EQ(next.RingCount(), 1u);
+}
@@ -0,0 +1,52 @@
+#include <memory>
+#include <string>
+
+#include "Check.h"
+#include "MatchEvents.h"
+#include "PlayerTable.h"
+
+TEST(MatchEvents, GoalBufferDropsPastCapacity)
+{
+	std::unique_ptr<GoalBuffer> goals(new GoalBuffer());
+	for (int i = 0; i < MAX_GOAL_EVENTS + 3; i++)
+	{
+		GoalEvent goal{};
+		goal.tick = static_cast<uint32_t>(i);
+		CHECK_EQ(goals->Push(goal), i < MAX_GOAL_EVENTS);
+	}
+	CHECK_EQ(goals->Size(), static_cast<size_t>(MAX_GOAL_EVENTS));
+	CHECK_EQ(goals->Dropped(), 3u);
+	// the first ones are kept, in order
+	CHECK_EQ(goals->begin()[0].tick, 0u);
+	CHECK_EQ(goals->begin()[MAX_GOAL_EVENTS - 1].tick, static_cast<uint32_t>(MAX_GOAL_EVENTS - 1));
+
+	goals->Clear();
+	CHECK_EQ(goals->Size(), 0u);
+	CHECK_EQ(goals->Dropped(), 0u);
+}
+
+TEST(MatchEvents, PlayerTableResolvesEachNameOnce)
+{
+	PlayerTable players;
+	int resolved = 0;
+	auto intern = [&](uintptr_t key, const char* name) {
+		return players.Intern(key, [&] {
+			resolved++;
+			return std::string(name);
+		});
+	};
+
+	const uint16_t first = intern(0x10, "First");
+	const uint16_t second = intern(0x20, "Second");
+	CHECK_EQ(intern(0x10, "ignored"), first);
+	CHECK_EQ(intern(0x20, "ignored"), second);
+	CHECK(first != second);
+	CHECK_EQ(resolved, 2);
+	CHECK_EQ(players.Name(first), std::string("First"));
+	CHECK_EQ(players.Name(second), std::string("Second"));
+
+	players.Clear();
+	CHECK(players.Names().empty());
+	CHECK_EQ(intern(0x20, "Again"), 0);
+	CHECK_EQ(resolved, 3);
+}
@@ -0,0 +1,215 @@
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "MatchLog.h"
+
+static std::vector<uint8_t> Payload(size_t index)
+{
+	return json::to_cbor(json{ { "MatchId", index } });
+}
+
+static size_t MatchIdAt(const MatchLogReader& log, size_t index)
+{
+	const json document = MatchLogReader::Parse(log.Get(index));
+	return document.is_discarded() ? SIZE_MAX : document["MatchId"].get<size_t>();
+}
+
+static void AppendMatches(const std::string& path, size_t from, size_t to)
+{
+	MatchLogWriter writer;
+	REQUIRE(writer.Open(path));
+	for (size_t i = from; i < to; i++) {
+		REQUIRE(writer.Append(Payload(i)));
+	}
+}
+
+static std::vector<char> ReadFile(const std::string& path)
+{
+	std::ifstream in(path, std::ios::binary);
+	return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static void WriteFile(const std::string& path, const std::vector<char>& data)
+{
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out.write(data.data(), data.size());
+}
+
+static void PutU64(std::vector<char>& data, size_t at, uint64_t value)
+{
+	for (int i = 0; i < 8; i++) data[at + i] = static_cast<char>(value >> (8 * i));
+}
+
+TEST(MatchLog, ReadsFromIndex)
+{
+	const std::string path = TestDirectory() + "matches.splog";
+	const size_t count = 3 * MATCH_INDEX_INTERVAL + 5;
+	AppendMatches(path, 0, count);
+
+	MatchLogReader log;
+	REQUIRE(log.Open(path));
+	REQUIRE(log.Count() == count);
+	CHECK(log.LastIndex() != 0u);
+	for (size_t i = 0; i < count; i++) {
+		CHECK_EQ(MatchIdAt(log, i), i);
+	}
+
+	// records, index entries and one trailer, no footer copies left behind
+	size_t bytes = 16 + 16;
+	for (size_t i = 0; i < count; i++) bytes += 8 + Payload(i).size();
+	bytes += 3 * (8 + 8 + 8 * MATCH_INDEX_INTERVAL);
+	CHECK_EQ(ReadFile(path).size(), bytes);
+}
+
+TEST(MatchLog, ReopensAndAppends)
+{
+	const std::string path = TestDirectory() + "matches.splog";
+	AppendMatches(path, 0, MATCH_INDEX_INTERVAL - 3);
+	AppendMatches(path, MATCH_INDEX_INTERVAL - 3, MATCH_INDEX_INTERVAL + 10);
+
+	MatchLogReader log;
+	REQUIRE(log.Open(path));
+	REQUIRE(log.Count() == MATCH_INDEX_INTERVAL + 10u);
+	CHECK_EQ(MatchIdAt(log, MATCH_INDEX_INTERVAL - 3), static_cast<size_t>(MATCH_INDEX_INTERVAL - 3));
+	CHECK_EQ(MatchIdAt(log, MATCH_INDEX_INTERVAL + 9), static_cast<size_t>(MATCH_INDEX_INTERVAL + 9));
+}
+
+TEST(MatchLog, RecoversTornAppend)
+{
+	const std::string path = TestDirectory() + "matches.splog";
+	AppendMatches(path, 0, 70);
+
+	// a crash half way through the next record, after its header went over the trailer
+	std::vector<char> data = ReadFile(path);
+	const std::vector<uint8_t> next = Payload(70);
+	data.resize(data.size() - 16);
+	const size_t recordAt = data.size();
+	data.resize(recordAt + 8 + next.size() / 2, '\0');
+	data[recordAt] = static_cast<char>(next.size());
+	WriteFile(path, data);
+
+	{
+		MatchLogReader log;
+		REQUIRE(log.Open(path));
+		CHECK_EQ(log.Count(), 70u);
+		CHECK_EQ(log.DataEnd(), static_cast<uint64_t>(recordAt));
+	}
+
+	AppendMatches(path, 70, 72);
+	MatchLogReader log;
+	REQUIRE(log.Open(path));
+	REQUIRE(log.Count() == 72u);
+	CHECK_EQ(MatchIdAt(log, 71), 71u);
+}
+
+TEST(MatchLog, DistrustsBadTrailer)
+{
+	const std::string path = TestDirectory() + "matches.splog";
+	AppendMatches(path, 0, MATCH_INDEX_INTERVAL + 2);
+	const std::vector<char> intact = ReadFile(path);
+
+	// last index pointing into the middle of a record
+	std::vector<char> data = intact;
+	PutU64(data, data.size() - 16, 100);
+	WriteFile(path, data);
+	{
+		MatchLogReader log;
+		REQUIRE(log.Open(path));
+		CHECK_EQ(log.Count(), MATCH_INDEX_INTERVAL + 2u);
+	}
+
+	// a count that doesn't match the records
+	data = intact;
+	data[data.size() - 8] = 1;
+	WriteFile(path, data);
+	{
+		MatchLogReader log;
+		REQUIRE(log.Open(path));
+		CHECK_EQ(log.Count(), MATCH_INDEX_INTERVAL + 2u);
+	}
+
+	// an offset in the index entry past the end of the file, the records
+	// after the index are still found
+	MatchLogReader intactLog;
+	WriteFile(path, intact);
+	REQUIRE(intactLog.Open(path));
+	const size_t indexAt = static_cast<size_t>(intactLog.LastIndex());
+	intactLog.Close();
+
+	data = intact;
+	PutU64(data, indexAt + 8 + 8 + 8 * 5, 1u << 30);
+	WriteFile(path, data);
+	MatchLogReader log;
+	REQUIRE(log.Open(path));
+	REQUIRE(log.Count() == MATCH_INDEX_INTERVAL + 2u);
+	CHECK_EQ(MatchIdAt(log, 5), 5u);
+}
+
+TEST(MatchLog, SkipsCorruptRecord)
+{
+	const std::string path = TestDirectory() + "matches.splog";
+	AppendMatches(path, 0, MATCH_INDEX_INTERVAL + 2);
+
+	MatchLogReader intactLog;
+	REQUIRE(intactLog.Open(path));
+	const size_t payloadAt = static_cast<size_t>(intactLog.Offsets()[3]) + 8;
+	intactLog.Close();
+
+	std::vector<char> data = ReadFile(path);
+	data[payloadAt + 1] ^= 0x20;
+	WriteFile(path, data);
+
+	MatchLogReader log;
+	REQUIRE(log.Open(path));
+	CHECK(log.Get(3).data == nullptr);
+	CHECK_EQ(MatchIdAt(log, 3), SIZE_MAX);
+	CHECK_EQ(MatchIdAt(log, 4), 4u);
+	CHECK_EQ(log.Count(), MATCH_INDEX_INTERVAL + 2u);
+}
+
+TEST(MatchLog, UpgradesFooterLog)
+{
+	const std::string path = TestDirectory() + "matches.splog";
+
+	// version 1: the same records, then every offset and a trailer
+	std::vector<uint8_t> data = { 'S', 'P', 'M', 'L', 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+	std::vector<uint64_t> offsets;
+	for (size_t i = 0; i < 3; i++)
+	{
+		MatchLogWriter one;
+		const std::string single = TestDirectory() + "single.splog";
+		REQUIRE(one.Open(single));
+		REQUIRE(one.Append(Payload(i)));
+		one.Close();
+
+		const std::vector<char> record = ReadFile(single);
+		offsets.push_back(data.size());
+		data.insert(data.end(), record.begin() + 16, record.end() - 16);
+	}
+	const uint64_t footerAt = data.size();
+	for (uint64_t offset : offsets) {
+		for (int i = 0; i < 8; i++) data.push_back(static_cast<uint8_t>(offset >> (8 * i)));
+	}
+	for (int i = 0; i < 8; i++) data.push_back(static_cast<uint8_t>(footerAt >> (8 * i)));
+	data.insert(data.end(), { 3, 0, 0, 0, 'S', 'P', 'M', 'I' });
+	WriteFile(path, std::vector<char>(data.begin(), data.end()));
+
+	{
+		MatchLogReader log;
+		REQUIRE(log.Open(path));
+		REQUIRE(log.Count() == 3u);
+		CHECK_EQ(MatchIdAt(log, 2), 2u);
+	}
+
+	AppendMatches(path, 3, MATCH_INDEX_INTERVAL + 1);
+	MatchLogReader log;
+	REQUIRE(log.Open(path));
+	REQUIRE(log.Count() == MATCH_INDEX_INTERVAL + 1u);
+	CHECK(log.LastIndex() != 0u);
+	CHECK_EQ(MatchIdAt(log, 0), 0u);
+	CHECK_EQ(MatchIdAt(log, MATCH_INDEX_INTERVAL), static_cast<size_t>(MATCH_INDEX_INTERVAL));
+}
@@ -0,0 +1,115 @@
+#include <chrono>
+#include <future>
+#include <memory>
+
+#include "Check.h"
+#include "FakeGameHost.h"
+#include "MmrTracker.h"
+
+#define RANKED_DOUBLES 11
+
+static bool IsReady(const std::shared_future<MmrResult>& result)
+{
+	return result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+TEST(MmrTracker, SettlesByPolling)
+{
+	FakeGameHost host;
+	host.mmr[RANKED_DOUBLES] = 1000.0f;
+
+	MmrTracker tracker(host);
+	tracker.Start();
+	tracker.BeginMatch(RANKED_DOUBLES);
+
+	// the service moves without a notification
+	const std::shared_future<MmrResult> result = tracker.EndMatch();
+	host.mmr[RANKED_DOUBLES] = 1012.0f;
+	CHECK(!IsReady(result));
+	host.Advance(30.0);
+
+	REQUIRE(IsReady(result));
+	CHECK_EQ(result.get().before, 1000.0f);
+	CHECK_EQ(result.get().after, 1012.0f);
+	CHECK(result.get().isSettled);
+}
+
+TEST(MmrTracker, SettlesUnchangedOnNotification)
+{
+	FakeGameHost host;
+	host.mmr[RANKED_DOUBLES] = 1000.0f;
+
+	MmrTracker tracker(host);
+	tracker.Start();
+	tracker.BeginMatch(RANKED_DOUBLES);
+
+	// a forfeit the server awards nothing for
+	const std::shared_future<MmrResult> result = tracker.EndMatch();
+	host.Advance(1.0);
+	CHECK(!IsReady(result));
+	host.SetMMR(RANKED_DOUBLES, 1000.0f);
+
+	REQUIRE(IsReady(result));
+	CHECK_EQ(result.get().after, 1000.0f);
+	CHECK(result.get().isSettled);
+}
+
+TEST(MmrTracker, SettlesUnchangedByPolling)
+{
+	FakeGameHost host;
+	host.mmr[RANKED_DOUBLES] = 1000.0f;
+
+	MmrTracker tracker(host);
+	tracker.Start();
+	tracker.BeginMatch(RANKED_DOUBLES);
+
+	// no notification and no change, polls at 0.5, 1.5 and 3.5 seconds
+	const std::shared_future<MmrResult> result = tracker.EndMatch();
+	host.Advance(3.0);
+	CHECK(!IsReady(result));
+	host.Advance(1.0);
+
+	REQUIRE(IsReady(result));
+	CHECK_EQ(result.get().before, 1000.0f);
+	CHECK_EQ(result.get().after, 1000.0f);
+	CHECK(result.get().isSettled);
+}
+
+TEST(MmrTracker, IgnoresCallbacksAfterStop)
+{
+	FakeGameHost host;
+	host.mmr[RANKED_DOUBLES] = 1000.0f;
+
+	MmrTracker tracker(host);
+	tracker.Start();
+	tracker.BeginMatch(RANKED_DOUBLES);
+	const std::shared_future<MmrResult> result = tracker.EndMatch();
+
+	tracker.Stop();
+	REQUIRE(IsReady(result));
+	CHECK(!result.get().isSettled);
+
+	// neither the queued poll nor the notification refreshes the cache
+	host.mmr[RANKED_DOUBLES] = 1012.0f;
+	host.Advance(30.0);
+	host.SetMMR(RANKED_DOUBLES, 1020.0f);
+	CHECK_EQ(tracker.Cached(RANKED_DOUBLES), 1000.0f);
+}
+
+TEST(MmrTracker, OutlivedByHostCallbacks)
+{
+	FakeGameHost host;
+	host.mmr[RANKED_DOUBLES] = 1000.0f;
+
+	std::unique_ptr<MmrTracker> tracker(new MmrTracker(host));
+	tracker->Start();
+	tracker->BeginMatch(RANKED_DOUBLES);
+	tracker->EndMatch();
+
+	// unloaded mid-poll without a Stop; the callbacks left behind would
+	// touch freed memory, which the sanitizer builds catch
+	tracker.reset();
+	host.Advance(30.0);
+	host.SetMMR(RANKED_DOUBLES, 1020.0f);
+	CHECK_EQ(host.mmr[RANKED_DOUBLES], 1020.0f);
+}
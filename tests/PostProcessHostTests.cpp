@@ -0,0 +1,133 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Check.h"
+#include "PostProcessHost.h"
+
+using Clock = std::chrono::steady_clock;
+
+static std::string ReadFile(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// splits the worker's stdin back into request bodies
+static std::vector<json> ParseFrames(const std::string& data)
+{
+	std::vector<json> requests;
+	size_t offset = 0;
+	while (offset + 4 <= data.size())
+	{
+		const unsigned char* header = reinterpret_cast<const unsigned char*>(data.data() + offset);
+		const uint32_t size = header[0] | header[1] << 8 | header[2] << 16 | static_cast<uint32_t>(header[3]) << 24;
+		if (offset + 4 + size > data.size()) break;
+
+		requests.push_back(json::parse(data.substr(offset + 4, size)));
+		offset += 4 + size;
+	}
+	return requests;
+}
+
+template <typename Fn>
+static bool WaitFor(Fn&& condition, std::chrono::milliseconds timeout)
+{
+	const Clock::time_point deadline = Clock::now() + timeout;
+	while (!condition())
+	{
+		if (Clock::now() > deadline) return false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return true;
+}
+
+#ifndef _WIN32
+
+TEST(PostProcessHost, FramesRequests)
+{
+	const std::string directory = TestDirectory();
+
+	// stub worker that keeps everything it's sent
+	PostProcessHost host(directory, [](std::string) {}, "cat > requests.bin");
+	host.Start();
+	CHECK(host.Send("clip.py", { { "goals", 2 } }));
+	CHECK(host.Send("build_summary.py"));
+	host.Stop();
+
+	// cat exits once its stdin is closed
+	std::vector<json> requests;
+	WaitFor([&] {
+		requests = ParseFrames(ReadFile(directory + "requests.bin"));
+		return requests.size() == 2;
+	}, std::chrono::seconds(5));
+
+	REQUIRE(requests.size() == 2);
+	CHECK_EQ(requests[0]["script"], "clip.py");
+	CHECK_EQ(requests[0]["args"]["goals"], 2);
+	CHECK_EQ(requests[1]["script"], "build_summary.py");
+	CHECK(requests[1]["args"].empty());
+	CHECK_EQ(host.Launches(), 1u);
+}
+
+TEST(PostProcessHost, RunsScriptsInWorker)
+{
+	const std::string directory = TestDirectory();
+	std::filesystem::copy_file(STATPULLER_SCRIPTS_DIR "/postprocess_worker.py", directory + "postprocess_worker.py");
+	{
+		std::ofstream script(directory + "record.py");
+		script << "import sys\nwith open('recorded.txt', 'a') as f:\n    f.write(sys.argv[1] + '\\n')\n";
+	}
+
+	// the real worker, with python3 standing in for pythonw.exe
+	PostProcessHost host(directory, [](std::string) {});
+	host.Start();
+	for (int i = 0; i < 3; i++) {
+		CHECK(host.Send("record.py", { { "goal", i } }));
+	}
+	host.Stop();
+
+	std::string recorded;
+	WaitFor([&] {
+		recorded = ReadFile(directory + "recorded.txt");
+		return recorded == "{\"goal\": 0}\n{\"goal\": 1}\n{\"goal\": 2}\n";
+	}, std::chrono::seconds(10));
+	CHECK_EQ(recorded, "{\"goal\": 0}\n{\"goal\": 1}\n{\"goal\": 2}\n");
+}
+
+TEST(PostProcessHost, HungWorkerNeverBlocksSend)
+{
+	const std::string directory = TestDirectory();
+
+	// never reads its stdin, so the pipe fills up and the writer blocks;
+	// the last one outlives the test, so it lets go of the test's output
+	PostProcessHost host(directory, [](std::string) {}, "exec sleep 10 > /dev/null 2>&1");
+	host.SetWriteTimeout(std::chrono::milliseconds(200));
+	host.Start();
+
+	const json args = { { "padding", std::string(4096, 'x') } };
+	Clock::duration slowest{};
+	int queued = 0;
+	const Clock::time_point deadline = Clock::now() + std::chrono::seconds(1);
+	while (Clock::now() < deadline)
+	{
+		const Clock::time_point start = Clock::now();
+		if (host.Send("clip.py", args)) queued++;
+		slowest = std::max(slowest, Clock::now() - start);
+	}
+
+	CHECK(queued > 0);
+	CHECK(slowest < std::chrono::milliseconds(50));
+	// the stuck worker is killed and a new one launched
+	CHECK(WaitFor([&] { return host.Launches() >= 2; }, std::chrono::seconds(5)));
+
+	const Clock::time_point stopStart = Clock::now();
+	host.Stop();
+	CHECK(Clock::now() - stopStart < std::chrono::milliseconds(POST_PROCESS_STOP_WAIT_MS + 1000));
+}
+
+#endif
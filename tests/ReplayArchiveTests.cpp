@@ -0,0 +1,172 @@
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "ReplayArchive.h"
+
+#define DAY_MS (24 * 60 * 60 * 1000LL)
+
+// compresses well, like a real replay; seed makes the content distinct
+static std::vector<uint8_t> SyntheticReplay(uint32_t seed, size_t size = 64 * 1024)
+{
+	std::vector<uint8_t> data(size);
+	for (size_t i = 0; i < size; i++) {
+		data[i] = static_cast<uint8_t>((i / 64) * 7 + seed);
+	}
+	return data;
+}
+
+static std::string WriteReplay(const std::string& directory, const std::vector<uint8_t>& data)
+{
+	const std::string path = directory + "export.replay";
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out.write(reinterpret_cast<const char*>(data.data()), data.size());
+	return path;
+}
+
+static bool Archive(ReplayArchive& archive, const std::string& directory, uint64_t matchId, int64_t startMs, const std::vector<uint8_t>& data)
+{
+	ReplayArchiveEntry entry;
+	entry.matchId = matchId;
+	entry.startWallClockMs = startMs;
+	return archive.Add(WriteReplay(directory, data), entry);
+}
+
+TEST(ReplayArchive, StoresEachReplayOnce)
+{
+	const std::string directory = TestDirectory();
+	const std::string archiveDirectory = directory + "replays/";
+	const std::vector<uint8_t> replay = SyntheticReplay(1);
+
+	ReplayArchive archive;
+	REQUIRE(archive.Open(archiveDirectory));
+	REQUIRE(Archive(archive, directory, 1, DAY_MS, replay));
+	REQUIRE(Archive(archive, directory, 2, 2 * DAY_MS, replay));
+
+	const ReplayArchiveEntry* second = archive.FindMatch(2);
+	REQUIRE(second != nullptr);
+	CHECK_EQ(archive.PathFor(*second), archive.PathFor(*archive.FindMatch(1)));
+	CHECK_EQ(archive.StoredBytes(), second->storedBytes);
+#ifdef STATPULLER_WITH_ZSTD
+	CHECK(second->compression == ReplayCompression::Zstd);
+	CHECK(second->storedBytes < replay.size() / 4);
+#else
+	CHECK(second->compression == ReplayCompression::None);
+#endif
+
+	ReplayArchive reopened;
+	REQUIRE(reopened.Open(archiveDirectory));
+	REQUIRE(reopened.Entries().size() == 2u);
+	std::vector<uint8_t> read;
+	REQUIRE(reopened.ReadReplay(*reopened.FindMatch(2), read));
+	CHECK(read == replay);
+}
+
+TEST(ReplayArchive, PrunesOldestPastSizeLimit)
+{
+	const std::string directory = TestDirectory();
+	const std::string archiveDirectory = directory + "replays/";
+
+	ReplayArchive archive;
+	REQUIRE(archive.Open(archiveDirectory));
+	for (uint32_t i = 0; i < 4; i++) {
+		REQUIRE(Archive(archive, directory, i + 1, (i + 1) * DAY_MS, SyntheticReplay(i)));
+	}
+	const std::string oldestPath = archive.PathFor(*archive.FindMatch(1));
+	CHECK(std::filesystem::exists(oldestPath));
+
+	// room for the newest two
+	ReplayRetention retention;
+	retention.maxStoredBytes = archive.Entries()[2].storedBytes + archive.Entries()[3].storedBytes;
+	CHECK_EQ(archive.Prune(retention, 10 * DAY_MS), 2u);
+	CHECK_EQ(archive.Prune(retention, 10 * DAY_MS), 0u);
+	CHECK(archive.FindMatch(1) == nullptr);
+	CHECK(archive.FindMatch(3) != nullptr);
+	CHECK(!std::filesystem::exists(oldestPath));
+	CHECK(archive.StoredBytes() <= retention.maxStoredBytes);
+
+	ReplayArchive reopened;
+	REQUIRE(reopened.Open(archiveDirectory));
+	REQUIRE(reopened.Entries().size() == 2u);
+	CHECK_EQ(reopened.Entries()[0].matchId, 3u);
+
+	// still appends after the rewrite
+	REQUIRE(Archive(reopened, directory, 5, 5 * DAY_MS, SyntheticReplay(5)));
+	ReplayArchive again;
+	REQUIRE(again.Open(archiveDirectory));
+	CHECK_EQ(again.Entries().size(), 3u);
+}
+
+TEST(ReplayArchive, PrunesPastAgeLimitKeepingSharedReplays)
+{
+	const std::string directory = TestDirectory();
+	const std::string archiveDirectory = directory + "replays/";
+	const std::vector<uint8_t> shared = SyntheticReplay(7);
+
+	ReplayArchive archive;
+	REQUIRE(archive.Open(archiveDirectory));
+	REQUIRE(Archive(archive, directory, 1, 1 * DAY_MS, SyntheticReplay(1)));
+	REQUIRE(Archive(archive, directory, 2, 2 * DAY_MS, shared));
+	REQUIRE(Archive(archive, directory, 3, 30 * DAY_MS, shared));
+	// no start time, only dropped for space
+	REQUIRE(Archive(archive, directory, 4, 0, SyntheticReplay(4)));
+
+	ReplayRetention retention;
+	retention.maxAgeMs = 7 * DAY_MS;
+	CHECK_EQ(archive.Prune(retention, 31 * DAY_MS), 2u);
+	REQUIRE(archive.Entries().size() == 2u);
+	CHECK(archive.FindMatch(4) != nullptr);
+
+	// match 2's replay is still match 3's
+	std::vector<uint8_t> read;
+	REQUIRE(archive.ReadReplay(*archive.FindMatch(3), read));
+	CHECK(read == shared);
+
+	// nothing else is too old
+	CHECK_EQ(archive.Prune(retention, 32 * DAY_MS), 0u);
+}
+
+TEST(ReplayArchive, NeverSharesOnHashAlone)
+{
+	const std::string directory = TestDirectory();
+	const std::string archiveDirectory = directory + "replays/";
+	const std::vector<uint8_t> replay = SyntheticReplay(3);
+
+	ReplayArchive archive;
+	REQUIRE(archive.Open(archiveDirectory));
+	REQUIRE(Archive(archive, directory, 1, DAY_MS, replay));
+	const std::string firstPath = archive.PathFor(*archive.FindMatch(1));
+	CHECK(firstPath.find("-" + std::to_string(replay.size())) != std::string::npos);
+
+	// stand in for a different replay with the same hash and size: the
+	// stored bytes no longer match what is archived next
+	std::vector<char> other(static_cast<size_t>(archive.FindMatch(1)->storedBytes), 'x');
+	{
+		std::ofstream out(firstPath, std::ios::binary | std::ios::trunc);
+		out.write(other.data(), other.size());
+	}
+
+	REQUIRE(Archive(archive, directory, 2, 2 * DAY_MS, replay));
+	const ReplayArchiveEntry* second = archive.FindMatch(2);
+	REQUIRE(second != nullptr);
+	CHECK_EQ(second->contentHash, archive.FindMatch(1)->contentHash);
+	CHECK_EQ(second->slot, 1);
+	CHECK(archive.PathFor(*second) != firstPath);
+
+	// the first file is left alone, the second holds the replay
+	std::ifstream first(firstPath, std::ios::binary);
+	CHECK(std::vector<char>(std::istreambuf_iterator<char>(first), std::istreambuf_iterator<char>()) == other);
+	std::vector<uint8_t> read;
+	REQUIRE(archive.ReadReplay(*second, read));
+	CHECK(read == replay);
+
+	// a third copy shares the second's file, and it survives a reopen
+	REQUIRE(Archive(archive, directory, 3, 3 * DAY_MS, replay));
+	CHECK_EQ(archive.PathFor(*archive.FindMatch(3)), archive.PathFor(*second));
+	ReplayArchive reopened;
+	REQUIRE(reopened.Open(archiveDirectory));
+	CHECK_EQ(reopened.FindMatch(3)->slot, 1);
+}
@@ -0,0 +1,96 @@
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "SessionAggregator.h"
+
+// noon, so the matches below stay on the same local day
+#define SESSION_TEST_START_MS 1767268800000LL
+#define MATCH_MS (6 * 60 * 1000)
+
+static MatchSummary FinishedMatch(uint64_t matchId, uint16_t goalsFor, uint16_t goalsAgainst)
+{
+	MatchSummary summary;
+	summary.Begin(matchId, 11, 300, 1000);
+	summary.SetLocalTeam(0);
+	for (uint16_t team = 0; team < 2; team++)
+	{
+		for (uint16_t i = 0; i < (team == 0 ? goalsFor : goalsAgainst); i++)
+		{
+			GoalEvent goal{};
+			goal.team = static_cast<uint8_t>(team);
+			goal.clockSeconds = static_cast<int16_t>(250 - 10 * i);
+			summary.OnGoal(goal);
+		}
+	}
+	summary.End(MatchOutcome::Completed, MATCH_MS);
+	summary.SetMmr(1000, goalsFor > goalsAgainst ? 1009 : 991);
+	return summary;
+}
+
+static void PlaySession(SessionAggregator& session)
+{
+	session.Add(FinishedMatch(1, 3, 1), SESSION_TEST_START_MS + 1 * MATCH_MS);
+	session.Add(FinishedMatch(2, 0, 2), SESSION_TEST_START_MS + 2 * MATCH_MS);
+	session.Add(FinishedMatch(3, 4, 2), SESSION_TEST_START_MS + 3 * MATCH_MS);
+}
+
+TEST(SessionAggregator, ReloadsSnapshot)
+{
+	const std::string path = TestDirectory() + "session.bin";
+	const int64_t nowMs = SESSION_TEST_START_MS + 4 * MATCH_MS;
+
+	SessionAggregator session;
+	session.Load(path, SESSION_TEST_START_MS);
+	PlaySession(session);
+	REQUIRE(session.Save());
+
+	SessionAggregator reloaded;
+	REQUIRE(reloaded.Load(path, nowMs));
+	CHECK_EQ(reloaded.ToJson(nowMs), session.ToJson(nowMs));
+	CHECK_EQ(reloaded.Today().matches, 3u);
+	CHECK_EQ(reloaded.Today().goalsFor, 7u);
+	CHECK_EQ(reloaded.Today().playedMs, static_cast<uint64_t>(3 * MATCH_MS));
+	CHECK_EQ(reloaded.CurrentStreak(), 1);
+}
+
+TEST(SessionAggregator, IgnoresCorruptSnapshot)
+{
+	const std::string path = TestDirectory() + "session.bin";
+	const int64_t nowMs = SESSION_TEST_START_MS + 4 * MATCH_MS;
+	{
+		SessionAggregator session;
+		session.Load(path, SESSION_TEST_START_MS);
+		PlaySession(session);
+		REQUIRE(session.Save());
+	}
+
+	std::vector<char> snapshot;
+	{
+		std::ifstream in(path, std::ios::binary);
+		snapshot.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+	REQUIRE(snapshot.size() == 16 + 24 + 3 * sizeof(SessionEntry));
+
+	// a goal count in the last entry, then the file cut short
+	std::vector<char> corrupt = snapshot;
+	corrupt[corrupt.size() - sizeof(SessionEntry) + 16] ^= 0x7F;
+	std::ofstream(path, std::ios::binary | std::ios::trunc).write(corrupt.data(), corrupt.size());
+
+	SessionAggregator reloaded;
+	CHECK(!reloaded.Load(path, nowMs));
+	CHECK_EQ(reloaded.Today().matches, 0u);
+
+	std::ofstream(path, std::ios::binary | std::ios::trunc).write(snapshot.data(), snapshot.size() - 1);
+	SessionAggregator truncated;
+	CHECK(!truncated.Load(path, nowMs));
+	CHECK_EQ(truncated.Today().matches, 0u);
+
+	// still saves over it
+	PlaySession(truncated);
+	REQUIRE(truncated.Save());
+	SessionAggregator again;
+	CHECK(again.Load(path, nowMs));
+}
@@ -0,0 +1,57 @@
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "Check.h"
+#include "StatsServer.h"
+
+TEST(StatsServer, WontShareItsPort)
+{
+	const std::string directory = TestDirectory();
+
+	StatsServer first;
+	REQUIRE(first.Start(0, directory + "live-match.bin", directory + "match-history.splog"));
+	REQUIRE(first.Port() != 0);
+
+	// a second listener on the same port must fail rather than steal it
+	StatsServer second;
+	CHECK(!second.Start(first.Port(), directory + "live-match.bin", directory + "match-history.splog"));
+
+	// and the port can be taken again right after a stop
+	const uint16_t port = first.Port();
+	first.Stop();
+	CHECK(second.Start(port, directory + "live-match.bin", directory + "match-history.splog"));
+}
+
+TEST(StatsServer, PublishesWhileRestarting)
+{
+	const std::string directory = TestDirectory();
+
+	StatsServer server;
+	REQUIRE(server.Start(0, directory + "live-match.bin", directory + "match-history.splog"));
+
+	// the export worker publishing while a port change restarts the
+	// server on the game thread; the thread sanitizer build checks the
+	// waker isn't used while it's being closed
+	std::atomic<bool> isPublishing{ true };
+	std::thread publisher([&] {
+		uint32_t count = 0;
+		while (isPublishing.load(std::memory_order_relaxed))
+		{
+			server.Publish("goal", { { "Count", count++ } });
+			server.PublishMatch({ { "MatchId", count } });
+		}
+	});
+
+	for (int i = 0; i < 20; i++)
+	{
+		server.Stop();
+		CHECK(!server.IsRunning());
+		CHECK(server.Start(0, directory + "live-match.bin", directory + "match-history.splog"));
+	}
+
+	isPublishing = false;
+	publisher.join();
+	CHECK(server.IsRunning());
+	server.Stop();
+}
@@ -0,0 +1,78 @@
+#include "Check.h"
+
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <vector>
+
+namespace {
+
+struct TestCase {
+	const char* suite;
+	const char* name;
+	TestFn fn;
+};
+
+std::vector<TestCase>& Tests()
+{
+	static std::vector<TestCase> tests;
+	return tests;
+}
+
+const TestCase* current = nullptr;
+int failures = 0;
+
+}
+
+bool RegisterTest(const char* suite, const char* name, TestFn fn)
+{
+	Tests().push_back({ suite, name, fn });
+	return true;
+}
+
+void ReportFailure(const char* file, int line, const std::string& message)
+{
+	std::fprintf(stderr, "%s:%d: %s.%s: %s\n", file, line, current->suite, current->name, message.c_str());
+	failures++;
+}
+
+std::string TestDirectory()
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "statpuller-tests"
+		/ (std::string(current->suite) + "." + current->name);
+
+	std::filesystem::remove_all(path);
+	std::filesystem::create_directories(path);
+	return path.string() + static_cast<char>(std::filesystem::path::preferred_separator);
+}
+
+// statpuller_tests [suite], runs every suite without one
+int main(int argc, char** argv)
+{
+	const char* suite = argc > 1 ? argv[1] : nullptr;
+
+	int ran = 0;
+	for (const TestCase& test : Tests())
+	{
+		if (suite && std::strcmp(suite, test.suite) != 0) continue;
+
+		current = &test;
+		const int failuresBefore = failures;
+		try {
+			test.fn();
+		}
+		catch (const TestAbort&) {
+		}
+		catch (const std::exception& e) {
+			ReportFailure(__FILE__, __LINE__, std::string("threw ") + e.what());
+		}
+		std::printf("[%s] %s.%s\n", failures == failuresBefore ? "  OK  " : " FAIL ", test.suite, test.name);
+		ran++;
+	}
+
+	if (ran == 0) {
+		std::fprintf(stderr, "no tests in suite %s\n", suite ? suite : "(all)");
+		return 1;
+	}
+	return failures == 0 ? 0 : 1;
+}